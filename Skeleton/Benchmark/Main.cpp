@@ -0,0 +1,592 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "skeleton.h"
+
+// Describes a procedurally generated benchmark scene and how long to measure it
+struct benchmarkConfig_t
+{
+  uint32_t objectCount = 256;    // Renderables in the scene
+  uint32_t meshCount = 8;        // Unique sphere meshes, each more detailed than the last
+  uint32_t programCount = 2;     // Unique shader/pipeline combinations, at most 6
+  uint32_t textureCount = 4;     // Unique procedural textures, 0 uses the default test images
+  uint32_t textureSize = 256;    // Width and height of each procedural texture
+  uint32_t warmupFrames = 120;   // Frames rendered before measuring begins
+  uint32_t measuredFrames = 1000;
+  uint32_t seed = 1;             // Seeds object placement so runs are repeatable
+  const char* outputPath = "benchmark.json";
+};
+
+// Shader and pipeline combinations available to benchmark scenes
+// Each shader has a bindless counterpart used when the global set is enabled
+static const struct {
+  const char* shader;
+  const char* bindlessShader;
+  uint64_t settings;
+} programVariants[] = {
+  { "default", "default_bindless", Skl_Cull_Mode_Front },
+  { "blue", "blue_bindless", Skl_Cull_Mode_Back },
+  { "default", "default_bindless", Skl_Cull_Mode_Back },
+  { "blue", "blue_bindless", Skl_Cull_Mode_Front },
+  { "default", "default_bindless", Skl_Cull_Mode_None },
+  { "blue", "blue_bindless", Skl_Cull_Mode_None }
+};
+static const uint32_t programVariantCount = sizeof(programVariants) / sizeof(programVariants[0]);
+
+class benchmarkApp : public Application
+{
+public:
+  benchmarkConfig_t config;
+
+  // Measurements
+  std::vector<float> frameTimes;  // Milliseconds between consecutive frames
+  std::vector<float> gpuTimes;    // Milliseconds the GPU spent on each frame
+  std::vector<float> latencies;   // Milliseconds from sampling input to presenting each frame
+  std::map<std::string, std::vector<float>> gpuScopeTimes;  // Milliseconds of each GPU scope
+  std::vector<sklGpuScopeTime_t> lastGpuScopes;             // Scopes of the final measured frame
+  double sceneLoadMs = 0.0;       // Time spent generating and uploading the scene
+  double startupMs = 0.0;         // Time from Run until the first frame
+  double cpuTimePerFrameMs = 0.0; // Process CPU time (all threads) per measured frame
+  sklMemoryStats_t memoryStats = {};  // Tracked GPU and host memory at the final measured frame
+  uint32_t swapchainImageCount = 0;   // Images presented from, or offscreen targets when headless
+
+  std::chrono::steady_clock::time_point runStart;
+
+private:
+  std::vector<glm::mat4> objectTransforms;
+  std::vector<std::string> textureNames;  // Textures reference their names, never reallocated
+  float orbitRadius = 10.f;
+  float orbitHeight = 3.f;
+
+  uint32_t frameIndex = 0;
+  std::chrono::steady_clock::time_point previousFrame;
+  double cpuTimeAtMeasureStart = 0.0;
+
+public:
+  void Start()
+  {
+    auto loadStart = std::chrono::steady_clock::now();
+
+    renderer->CreateModelBuffers();
+    std::mt19937 random(config.seed);
+
+    // Meshes
+    //=================================================
+    std::vector<mesh_t> meshes;
+    for (uint32_t i = 0; i < config.meshCount; i++)
+    {
+      uint32_t segments = std::min(8u + 8u * i, 256u);
+      meshes.push_back(CreateSphere(segments, segments / 2));
+    }
+
+    // Textures
+    //=================================================
+    std::vector<uint32_t> textures;
+    textureNames.reserve(config.textureCount);
+    for (uint32_t i = 0; i < config.textureCount; i++)
+    {
+      textureNames.push_back("benchmark_texture_" + std::to_string(i));
+      std::vector<uint8_t> pixels = CreateCheckerPixels(i, config.textureSize);
+      textures.push_back(TextureManager::CreateTexture(textureNames.back().c_str(), pixels.data(),
+                                                       config.textureSize, config.textureSize,
+                                                       renderer->bufferManager));
+    }
+
+    // Shader programs
+    //=================================================
+    std::vector<uint32_t> programs;
+    for (uint32_t i = 0; i < config.programCount; i++)
+    {
+      programs.push_back(GetShaderProgram(vulkanContext.bindless ?
+                                              programVariants[i].bindlessShader :
+                                              programVariants[i].shader,
+                                          Skl_Shader_Vert_Stage | Skl_Shader_Frag_Stage,
+                                          programVariants[i].settings));
+    }
+
+    // Objects, placed on a jittered grid centered on the origin
+    //=================================================
+    uint32_t gridSide = static_cast<uint32_t>(std::ceil(std::cbrt(float(config.objectCount))));
+    float spacing = 2.5f;
+    float gridExtent = gridSide * spacing;
+    std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+    std::uniform_real_distribution<float> angle(0.f, glm::two_pi<float>());
+    std::uniform_real_distribution<float> scale(0.5f, 1.f);
+
+    for (uint32_t i = 0; i < config.objectCount; i++)
+    {
+      glm::vec3 cell(i % gridSide, (i / gridSide) % gridSide, i / (gridSide * gridSide));
+      glm::vec3 position = (cell - glm::vec3((gridSide - 1) * 0.5f)) * spacing;
+      position += glm::vec3(jitter(random), jitter(random), jitter(random));
+
+      glm::mat4 transform = glm::translate(glm::mat4(1.f), position);
+      transform = glm::rotate(transform, angle(random), glm::vec3(0.f, 1.f, 0.f));
+      transform = glm::scale(transform, glm::vec3(scale(random)));
+      objectTransforms.push_back(transform);
+
+      std::vector<uint32_t> objectTextures;
+      if (config.textureCount > 0)
+      {
+        objectTextures.push_back(textures[i % config.textureCount]);
+        objectTextures.push_back(textures[(i + 1) % config.textureCount]);
+      }
+      CreateObject(meshes[i % config.meshCount], programs[i % config.programCount],
+                   objectTextures);
+    }
+
+    // Camera
+    //=================================================
+    orbitRadius = gridExtent + 4.f;
+    orbitHeight = gridExtent * 0.25f;
+    renderer->cam.SetRenderDistances(0.1f, orbitRadius * 2.f + gridExtent);
+    renderer->cam.UpdateProjection(
+        vulkanContext.renderExtent.width / float(vulkanContext.renderExtent.height));
+    FixedLoop();
+
+    // Commands are recorded every frame, wait here so the scene's load includes compilation
+    for (shaderProgram_t& program : vulkanContext.shaderPrograms)
+    {
+      program.GetPipeline(vulkanContext.shaders[program.vertIdx].module,
+                          vulkanContext.shaders[program.fragIdx].module);
+    }
+
+    sceneLoadMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - loadStart).count();
+  }
+
+  // Flies the camera along a fixed orbit, driven only by the simulation step count
+  void FixedLoop()
+  {
+    float orbitAngle = sklTime.fixedStepCount * sklTime.fixedDeltaTime * 0.3f;
+    Camera& cam = renderer->cam;
+    cam.position = glm::vec3(glm::cos(orbitAngle) * orbitRadius,
+                             orbitHeight * glm::sin(orbitAngle * 2.f),
+                             glm::sin(orbitAngle) * orbitRadius);
+
+    // Face the origin
+    glm::vec3 toCenter = glm::normalize(-cam.position);
+    cam.yaw = glm::degrees(std::atan2(toCenter.z, toCenter.x));
+    cam.pitch = glm::degrees(std::asin(toCenter.y));
+  }
+
+  void CoreLoop()
+  {
+    auto now = std::chrono::steady_clock::now();
+
+    if (frameIndex == 0)
+    {
+      startupMs = std::chrono::duration<double, std::milli>(now - runStart).count();
+    }
+    if (frameIndex == config.warmupFrames)
+    {
+      cpuTimeAtMeasureStart = GetProcessCpuTimeMs();
+    }
+
+    if (frameIndex > config.warmupFrames)
+    {
+      frameTimes.push_back(std::chrono::duration<float, std::milli>(now - previousFrame).count());
+      gpuTimes.push_back(renderer->gpuFrameTime);
+      latencies.push_back(renderer->inputLatency);
+
+      // Rendering of the previous frame has finished, so its results are stable here
+      lastGpuScopes = renderer->gpuProfiler->GetScopeTimes();
+      for (const auto& scope : lastGpuScopes)
+      {
+        gpuScopeTimes[scope.name].push_back(scope.ms);
+      }
+
+      if (frameIndex == config.warmupFrames + config.measuredFrames)
+      {
+        memoryStats = SklMemoryTracker::GetStats();
+        swapchainImageCount = static_cast<uint32_t>(renderer->backend->swapchainImages.size());
+      }
+    }
+    previousFrame = now;
+    frameIndex++;
+
+    // Model matrices are pushed with each draw, bindless objects read theirs from a buffer
+    for (uint32_t i = 0; i < vulkanContext.renderables.size(); i++)
+    {
+      sklRenderable_t& renderable = vulkanContext.renderables[i];
+      renderable.drawConstants.model = objectTransforms[i] * mvp.model;
+      if (!renderable.buffers.empty())
+      {
+        MVPMatrices objectMvp = mvp;
+        objectMvp.model = renderable.drawConstants.model;
+        renderer->bufferManager->FillBuffer(renderable.buffers[0]->memory, &objectMvp,
+                                            sizeof(objectMvp));
+      }
+    }
+  }
+
+  // Records the CPU time of the measured frames, called once the application has stopped
+  void FinishMeasuring()
+  {
+    if (!frameTimes.empty())
+    {
+      cpuTimePerFrameMs = (GetProcessCpuTimeMs() - cpuTimeAtMeasureStart) / frameTimes.size();
+    }
+  }
+
+  // Total time every thread of the process has spent on the CPU
+  static double GetProcessCpuTimeMs()
+  {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    ULARGE_INTEGER kernelTime = { kernel.dwLowDateTime, kernel.dwHighDateTime };
+    ULARGE_INTEGER userTime = { user.dwLowDateTime, user.dwHighDateTime };
+    return (kernelTime.QuadPart + userTime.QuadPart) / 10000.0;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+#endif
+  }
+
+  // Largest amount of memory the process has had resident
+  static uint64_t GetPeakResidentBytes()
+  {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters = {};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+  }
+
+private:
+  // Builds a UV sphere of radius 1
+  mesh_t CreateSphere(uint32_t _segments, uint32_t _rings)
+  {
+    std::vector<vertex_t> vertices;
+    std::vector<uint32_t> indices;
+
+    for (uint32_t ring = 0; ring <= _rings; ring++)
+    {
+      float v = ring / float(_rings);
+      float phi = v * glm::pi<float>();
+      for (uint32_t segment = 0; segment <= _segments; segment++)
+      {
+        float u = segment / float(_segments);
+        float theta = u * glm::two_pi<float>();
+
+        vertex_t vert;
+        vert.normal = { glm::sin(phi) * glm::cos(theta), glm::cos(phi),
+                        glm::sin(phi) * glm::sin(theta) };
+        vert.position = vert.normal;
+        vert.uv = { u, v };
+        vertices.push_back(vert);
+      }
+    }
+
+    uint32_t rowSize = _segments + 1;
+    for (uint32_t ring = 0; ring < _rings; ring++)
+    {
+      for (uint32_t segment = 0; segment < _segments; segment++)
+      {
+        uint32_t a = ring * rowSize + segment;
+        uint32_t b = a + rowSize;
+        indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+      }
+    }
+
+    return CreateMesh(vertices, indices);
+  }
+
+  // Builds an RGBA checkerboard with a color unique to the index
+  static std::vector<uint8_t> CreateCheckerPixels(uint32_t _index, uint32_t _size)
+  {
+    std::vector<uint8_t> pixels(static_cast<size_t>(_size) * _size * 4);
+    uint8_t r = static_cast<uint8_t>(64 + (_index * 97) % 192);
+    uint8_t g = static_cast<uint8_t>(64 + (_index * 57) % 192);
+    uint8_t b = static_cast<uint8_t>(64 + (_index * 23) % 192);
+    uint32_t checkSize = std::max(_size / 8, 1u);
+
+    for (uint32_t y = 0; y < _size; y++)
+    {
+      for (uint32_t x = 0; x < _size; x++)
+      {
+        bool dark = ((x / checkSize) + (y / checkSize)) % 2 == 0;
+        uint8_t* pixel = &pixels[(static_cast<size_t>(y) * _size + x) * 4];
+        pixel[0] = dark ? r / 2 : r;
+        pixel[1] = dark ? g / 2 : g;
+        pixel[2] = dark ? b / 2 : b;
+        pixel[3] = 255;
+      }
+    }
+    return pixels;
+  }
+
+};
+
+// Summary statistics of a set of samples
+struct benchmarkSummary_t
+{
+  double mean, min, max, p50, p95, p99;
+};
+
+// Sorts a copy of the samples and computes their percentiles (nearest-rank)
+static benchmarkSummary_t Summarize(std::vector<float> _samples)
+{
+  benchmarkSummary_t summary = {};
+  if (_samples.empty())
+    return summary;
+
+  std::sort(_samples.begin(), _samples.end());
+  auto percentile = [&](double _p)
+  {
+    size_t rank = static_cast<size_t>(std::ceil(_p / 100.0 * _samples.size()));
+    return static_cast<double>(_samples[std::max<size_t>(rank, 1) - 1]);
+  };
+
+  double sum = 0.0;
+  for (float sample : _samples)
+  {
+    sum += sample;
+  }
+
+  summary.mean = sum / _samples.size();
+  summary.min = _samples.front();
+  summary.max = _samples.back();
+  summary.p50 = percentile(50.0);
+  summary.p95 = percentile(95.0);
+  summary.p99 = percentile(99.0);
+  return summary;
+}
+
+static void WriteSummary(std::ofstream& _out, const char* _name, const benchmarkSummary_t& _s,
+                         bool _last = false, const char* _indent = "    ")
+{
+  _out << _indent << "\"" << _name << "\": { \"mean\": " << _s.mean << ", \"min\": " << _s.min
+       << ", \"max\": " << _s.max << ", \"p50\": " << _s.p50 << ", \"p95\": " << _s.p95
+       << ", \"p99\": " << _s.p99 << " }" << (_last ? "\n" : ",\n");
+}
+
+// Writes the configuration, environment, and results of a run as JSON
+static bool WriteResults(benchmarkApp& _app)
+{
+  std::ofstream out(_app.config.outputPath);
+  if (!out)
+  {
+    std::cout << "Failed to open \"" << _app.config.outputPath << "\"\n";
+    return false;
+  }
+
+  const VkPhysicalDeviceProperties& gpu = vulkanContext.gpu.properties;
+  const benchmarkConfig_t& config = _app.config;
+  const sklPresentPolicy_t& present = _app.settings.presentPolicy;
+  out.precision(6);
+  out << std::fixed;
+
+  out << "{\n";
+  out << "  \"config\": {\n";
+  out << "    \"objects\": " << config.objectCount << ",\n";
+  out << "    \"meshes\": " << config.meshCount << ",\n";
+  out << "    \"programs\": " << config.programCount << ",\n";
+  out << "    \"textures\": " << config.textureCount << ",\n";
+  out << "    \"textureSize\": " << config.textureSize << ",\n";
+  out << "    \"warmupFrames\": " << config.warmupFrames << ",\n";
+  out << "    \"measuredFrames\": " << config.measuredFrames << ",\n";
+  out << "    \"seed\": " << config.seed << ",\n";
+  out << "    \"width\": " << vulkanContext.renderExtent.width << ",\n";
+  out << "    \"height\": " << vulkanContext.renderExtent.height << ",\n";
+  out << "    \"headless\": " << (_app.settings.headless ? "true" : "false") << ",\n";
+  out << "    \"presentMode\": \"" << SklPresentModeName(present.mode) << "\",\n";
+  out << "    \"swapchainImages\": " << _app.swapchainImageCount << ",\n";
+  out << "    \"framesInFlight\": " << present.framesInFlight << ",\n";
+  out << "    \"lowLatency\": " << (present.lowLatency ? "true" : "false") << ",\n";
+  out << "    \"bindless\": " << (vulkanContext.bindless ? "true" : "false") << "\n";
+  out << "  },\n";
+  out << "  \"device\": {\n";
+  out << "    \"name\": \"" << gpu.deviceName << "\",\n";
+  out << "    \"vendorId\": " << gpu.vendorID << ",\n";
+  out << "    \"driverVersion\": " << gpu.driverVersion << ",\n";
+  out << "    \"apiVersion\": " << gpu.apiVersion << "\n";
+  out << "  },\n";
+  sklPipelineCacheStats_t pipelines = SklPipelineCache::GetStats();
+  sklDescriptorCacheStats_t descriptors = SklDescriptorCache::GetStats();
+  out << "  \"load\": {\n";
+  out << "    \"sceneMs\": " << _app.sceneLoadMs << ",\n";
+  out << "    \"startupMs\": " << _app.startupMs << ",\n";
+  out << "    \"pipelineCache\": \"" << (pipelines.warm ? "warm" : "cold") << "\",\n";
+  out << "    \"pipelines\": " << pipelines.pipelineCount << ",\n";
+  out << "    \"pipelineMs\": " << pipelines.totalMs << ",\n";
+  out << "    \"setLayouts\": " << descriptors.setLayouts << ",\n";
+  out << "    \"pipelineLayouts\": " << descriptors.pipelineLayouts << ",\n";
+  out << "    \"descriptorSets\": " << descriptors.sets << ",\n";
+  out << "    \"descriptorSetRequests\": " << descriptors.setRequests << "\n";
+  out << "  },\n";
+  out << "  \"frames\": {\n";
+  out << "    \"count\": " << _app.frameTimes.size() << ",\n";
+  WriteSummary(out, "frameMs", Summarize(_app.frameTimes));
+  WriteSummary(out, "gpuMs", Summarize(_app.gpuTimes));
+  WriteSummary(out, "latencyMs", Summarize(_app.latencies));
+  out << "    \"cpuMsPerFrame\": " << _app.cpuTimePerFrameMs << "\n";
+  out << "  },\n";
+
+  // Per-scope GPU timings, with the last frame's pipeline statistics when collected
+  out << "  \"gpuScopes\": {\n";
+  for (size_t i = 0; i < _app.lastGpuScopes.size(); i++)
+  {
+    const sklGpuScopeTime_t& scope = _app.lastGpuScopes[i];
+    bool last = i + 1 == _app.lastGpuScopes.size();
+    out << "    \"" << scope.name << "\": {\n";
+    out << "      \"depth\": " << scope.depth << ",\n";
+    WriteSummary(out, "ms", Summarize(_app.gpuScopeTimes[scope.name]), !scope.hasStatistics,
+                 "      ");
+    if (scope.hasStatistics)
+    {
+      const sklGpuPipelineStats_t& stats = scope.statistics;
+      out << "      \"statistics\": { \"inputVertices\": " << stats.inputVertices
+          << ", \"inputPrimitives\": " << stats.inputPrimitives
+          << ", \"vertexInvocations\": " << stats.vertexInvocations
+          << ", \"clippedPrimitives\": " << stats.clippedPrimitives
+          << ", \"fragmentInvocations\": " << stats.fragmentInvocations << " }\n";
+    }
+    out << "    }" << (last ? "\n" : ",\n");
+  }
+  out << "  },\n";
+  out << "  \"memory\": {\n";
+  out << "    \"peakResidentBytes\": " << benchmarkApp::GetPeakResidentBytes() << ",\n";
+  out << "    \"driverBudget\": " << (_app.memoryStats.driverBudget ? "true" : "false")
+      << ",\n";
+  out << "    \"heaps\": [\n";
+  for (size_t i = 0; i < _app.memoryStats.heaps.size(); i++)
+  {
+    const sklMemoryHeapStats_t& heap = _app.memoryStats.heaps[i];
+    out << "      { \"deviceLocal\": " << (heap.deviceLocal ? "true" : "false")
+        << ", \"sizeBytes\": " << heap.size << ", \"budgetBytes\": " << heap.budget
+        << ", \"currentBytes\": " << heap.current << ", \"peakBytes\": " << heap.peak << " }"
+        << (i + 1 == _app.memoryStats.heaps.size() ? "\n" : ",\n");
+  }
+  out << "    ],\n";
+  out << "    \"categories\": {\n";
+  for (uint32_t i = 0; i < Skl_Memory_Category_Count; i++)
+  {
+    const sklMemoryCategoryStats_t& category = _app.memoryStats.categories[i];
+    out << "      \"" << SklMemoryTracker::GetCategoryName(static_cast<sklMemoryCategory>(i))
+        << "\": { \"currentBytes\": " << category.current << ", \"peakBytes\": "
+        << category.peak << " }" << (i + 1 == Skl_Memory_Category_Count ? "\n" : ",\n");
+  }
+  out << "    }\n";
+  out << "  }\n";
+  out << "}\n";
+
+  std::cout << "Wrote benchmark results to \"" << config.outputPath << "\"\n";
+  return out.good();
+}
+
+int main(int argc, char* argv[])
+{
+  benchmarkApp app;
+  benchmarkConfig_t& config = app.config;
+
+  // --objects N --meshes N --programs N --textures N --texture-size N
+  // --warmup N --frames N --seed N --output path.json --headless --width N --height N
+  // --pipeline-stats --profile path.json --pipeline-cache path.bin|none --pipeline-workers N
+  // --present fifo|fifo-relaxed|mailbox|immediate --swapchain-images N --frames-in-flight N
+  // --low-latency --bindless
+  for (int i = 1; i < argc; i++)
+  {
+    bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--headless") == 0)
+      app.settings.headless = true;
+    else if (std::strcmp(argv[i], "--pipeline-stats") == 0)
+      app.settings.gpuPipelineStatistics = true;
+    else if (std::strcmp(argv[i], "--profile") == 0 && hasValue)
+      app.settings.profilePath = argv[++i];
+    else if (std::strcmp(argv[i], "--pipeline-cache") == 0 && hasValue)
+    {
+      i++;
+      app.settings.pipelineCachePath = std::strcmp(argv[i], "none") == 0 ? nullptr : argv[i];
+    }
+    else if (std::strcmp(argv[i], "--pipeline-workers") == 0 && hasValue)
+      app.settings.pipelineWorkers = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--present") == 0 && hasValue)
+    {
+      i++;
+      if (!SklPresentModeFromName(argv[i], app.settings.presentPolicy.mode))
+        std::cout << "Unknown present mode \"" << argv[i] << "\"\n";
+    }
+    else if (std::strcmp(argv[i], "--swapchain-images") == 0 && hasValue)
+      app.settings.presentPolicy.swapchainImageCount = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && hasValue)
+      app.settings.presentPolicy.framesInFlight = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--low-latency") == 0)
+      app.settings.presentPolicy.lowLatency = true;
+    else if (std::strcmp(argv[i], "--bindless") == 0)
+      app.settings.bindless = true;
+    else if (std::strcmp(argv[i], "--objects") == 0 && hasValue)
+      config.objectCount = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--meshes") == 0 && hasValue)
+      config.meshCount = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--programs") == 0 && hasValue)
+      config.programCount = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--textures") == 0 && hasValue)
+      config.textureCount = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--texture-size") == 0 && hasValue)
+      config.textureSize = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue)
+      config.warmupFrames = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--frames") == 0 && hasValue)
+      config.measuredFrames = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+      config.seed = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--output") == 0 && hasValue)
+      config.outputPath = argv[++i];
+    else if (std::strcmp(argv[i], "--width") == 0 && hasValue)
+      app.settings.width = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--height") == 0 && hasValue)
+      app.settings.height = std::strtoul(argv[++i], nullptr, 10);
+    else
+      std::cout << "Unknown argument \"" << argv[i] << "\"\n";
+  }
+
+  config.objectCount = std::max(config.objectCount, 1u);
+  config.meshCount = glm::clamp(config.meshCount, 1u, config.objectCount);
+  config.programCount = glm::clamp(config.programCount, 1u, programVariantCount);
+  config.textureSize = std::max(config.textureSize, 1u);
+
+  // One extra frame, the first has no previous frame to measure against
+  app.settings.frameLimit = config.warmupFrames + config.measuredFrames + 1;
+  app.settings.maxRenderables = config.objectCount;
+
+  int result = 0;
+  try
+  {
+    app.runStart = std::chrono::steady_clock::now();
+    app.Run();
+    app.FinishMeasuring();
+    result = WriteResults(app) ? 0 : 1;
+  }
+  catch (const char* e)
+  {
+    SklLogger::Flush();
+    std::cout << "Caught: " << e << "\n";
+    result = 1;
+  }
+
+  return result;
+}
@@ -1,5 +1,7 @@
 
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 
 #include "skeleton.h"
 
@@ -8,6 +10,11 @@
 class sandboxApp : public Application
 {
 public:
+  // Added to every program's pipeline settings
+  uint64_t debugSettings = 0;
+  // The default images in swapped order, shown by the middle sphere every other second
+  std::vector<uint32_t> swappedTextures;
+
   void Start()
   {
     renderer->cam.yaw = -90.f;
@@ -17,22 +24,48 @@ public:
 
     renderer->CreateModelBuffers();
 
-    uint32_t i = GetShaderProgram("default", Skl_Shader_Vert_Stage | Skl_Shader_Frag_Stage,
-                                  Skl_Cull_Mode_Front);
-    uint32_t j = GetShaderProgram("blue", Skl_Shader_Vert_Stage | Skl_Shader_Frag_Stage,
-                                  Skl_Cull_Mode_Back);
+    // Bindless rendering needs shaders that index the global set
+    bool bindless = vulkanContext.bindless;
+    uint32_t i = GetShaderProgram(bindless ? "default_bindless" : "default",
+                                  Skl_Shader_Vert_Stage | Skl_Shader_Frag_Stage,
+                                  Skl_Cull_Mode_Front | debugSettings);
+    uint32_t j = GetShaderProgram(bindless ? "blue_bindless" : "blue",
+                                  Skl_Shader_Vert_Stage | Skl_Shader_Frag_Stage,
+                                  Skl_Cull_Mode_Back | debugSettings);
     CreateObject("./res/models/SphereSmooth.obj", j);
     CreateObject("./res/models/SphereSmooth.obj", i);
     CreateObject("./res/models/Cube.obj", i);
 
-    renderer->RecordCommandBuffers();
+    if (!bindless)
+    {
+      // The cube draws a variant of the default shader with its texture split compiled out
+      sklRenderable_t& cube = vulkanContext.renderables.back();
+      cube.shaderFeatures &= ~GetShaderFeature(i, "SPLIT_TEXTURES");
+      PrewarmShaderVariants(i, { cube.shaderFeatures });
+
+      swappedTextures = {
+          TextureManager::CreateTexture("res/AltImage.png", renderer->bufferManager),
+          TextureManager::CreateTexture("res/TestImage.png", renderer->bufferManager) };
+    }
   }
 
   void CoreLoop()
   {
-    for (const auto& r : vulkanContext.renderables)
+    for (auto& r : vulkanContext.renderables)
+    {
+      // Pushed with the draw, only bindless objects keep their matrices in a buffer
+      r.drawConstants.model = mvp.model;
+      if (!r.buffers.empty())
+      {
+        renderer->bufferManager->CopyBuffer(renderer->mvpBuffer, r.buffers[0]->buffer,
+                                            sizeof(mvp));
+      }
+    }
+
+    // Swapping through a set that lasts one frame leaves the sphere's own set untouched
+    if (!swappedTextures.empty() && static_cast<uint32_t>(sklTime.totalTime) % 2 == 1)
     {
-      renderer->bufferManager->CopyBuffer(renderer->mvpBuffer, r.buffers[0]->buffer, sizeof(mvp));
+      renderer->SetFrameTextures(vulkanContext.renderables[1], swappedTextures);
     }
   }
 
@@ -40,17 +73,91 @@ public:
 
 int main(int argc, char* argv[])
 {
+  sandboxApp app;
+
+  // --headless : Render offscreen without a window
+  // --frames N : Close after N frames
+  // --capture path.png : Write the final headless frame to a file
+  // --profile path.json : Write a CPU and GPU profile of the whole run to a file
+  // --memory-stats N : Print memory usage every N seconds
+  // --present fifo|fifo-relaxed|mailbox|immediate : How frames are queued for display
+  // --swapchain-images N : Images in the swapchain, 0 for the surface's minimum plus one
+  // --frames-in-flight N : Frames the CPU may queue ahead of the GPU
+  // --low-latency : Wait for the previous frame before sampling input
+  // --bindless : Index textures and object data from one global set when supported
+  // --hot-reload : Recompile and swap in shaders as they are edited in res/Shaders
+  // --wireframe : Draw triangle outlines
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::strcmp(argv[i], "--headless") == 0)
+    {
+      app.settings.headless = true;
+    }
+    else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+    {
+      app.settings.frameLimit = std::strtoull(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+    {
+      app.settings.capturePath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+    {
+      app.settings.profilePath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--memory-stats") == 0 && i + 1 < argc)
+    {
+      app.settings.memoryStatsInterval = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--present") == 0 && i + 1 < argc)
+    {
+      i++;
+      if (!SklPresentModeFromName(argv[i], app.settings.presentPolicy.mode))
+      {
+        std::cout << "Unknown present mode \"" << argv[i] << "\"\n";
+      }
+    }
+    else if (std::strcmp(argv[i], "--swapchain-images") == 0 && i + 1 < argc)
+    {
+      app.settings.presentPolicy.swapchainImageCount = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+    {
+      app.settings.presentPolicy.framesInFlight = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--low-latency") == 0)
+    {
+      app.settings.presentPolicy.lowLatency = true;
+    }
+    else if (std::strcmp(argv[i], "--bindless") == 0)
+    {
+      app.settings.bindless = true;
+    }
+    else if (std::strcmp(argv[i], "--hot-reload") == 0)
+    {
+      app.settings.shaderHotReload = true;
+    }
+    else if (std::strcmp(argv[i], "--wireframe") == 0)
+    {
+      app.debugSettings |= Skl_Polygon_Mode_Line;
+    }
+  }
+
   try
   {
-    sandboxApp app;
     app.Run();
   }
   catch (const char* e)
   {
+    SklLogger::Flush();
     std::cout << "Caught: " << e << "\n";
   }
 
-  system("PAUSE");
+  // Headless runs are unattended
+  if (!app.settings.headless)
+  {
+    system("PAUSE");
+  }
   return 0;
 }
 
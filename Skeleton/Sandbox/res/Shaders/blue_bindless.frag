@@ -0,0 +1,24 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Every texture in the global set
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+
+// Indices into the global set, pushed in declaration order
+// Each name ends in what it indexes, "Buffer" for the buffer array and "Texture" for textures
+layout(push_constant) uniform Indices {
+	uint objectBuffer;
+	uint baseTexture;
+} draw;
+
+layout(location = 0) in vec3 normal;
+layout(location = 1) in vec2 uv;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	vec4 ts = texture(textures[draw.baseTexture], uv);
+	outColor = ts * vec4(0.0, 0.0, 1.0, 1.0);
+}
+
@@ -9,8 +9,16 @@ layout(location = 1) in vec2 uv;
 
 layout(location = 0) out vec4 outColor;
 
+// Shows alt across half of the surface, variants without it only sample tex
+layout(constant_id = 0) const bool SPLIT_TEXTURES = true;
+
 void main() {
 	vec4 A = texture(tex, uv);
+	if (!SPLIT_TEXTURES) {
+		outColor = A;
+		return;
+	}
+
 	vec4 B = texture(alt, uv);
 	float x = round(uv.x);
 	outColor = (A * x) + (B * (1 - x));
@@ -7,6 +7,12 @@ layout(binding = 0) uniform MVPMatrices {
 	mat4 proj;
 } mvp;
 
+// Per-draw data, replaces the model matrix above
+layout(push_constant) uniform DrawConstants {
+	mat4 model;
+	uint materialIndex;
+} draw;
+
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec2 uv;
 layout(location = 2) in vec3 normal;
@@ -15,7 +21,7 @@ layout(location = 0) out vec3 outNormal;
 layout(location = 1) out vec2 outUV;
 
 void main() {
-	gl_Position = mvp.proj * mvp.view * mvp.model * vec4(position, 1.0);
+	gl_Position = mvp.proj * mvp.view * draw.model * vec4(position, 1.0);
 	outNormal = normal;
 	outUV = uv;
 }
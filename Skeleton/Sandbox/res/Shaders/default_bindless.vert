@@ -0,0 +1,37 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+struct MVPMatrices {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+};
+
+// Every object's matrices, indexed by the draw's object buffer
+layout(set = 0, binding = 1) readonly buffer ObjectBuffers {
+	MVPMatrices mvp;
+} objects[];
+
+// Indices into the global set, pushed in declaration order
+// Each name ends in what it indexes, "Buffer" for the buffer array and "Texture" for textures
+layout(push_constant) uniform Indices {
+	uint objectBuffer;
+	uint baseTexture;
+	uint altTexture;
+} draw;
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 uv;
+layout(location = 2) in vec3 normal;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec2 outUV;
+
+void main() {
+	MVPMatrices mvp = objects[draw.objectBuffer].mvp;
+	gl_Position = mvp.proj * mvp.view * mvp.model * vec4(position, 1.0);
+	outNormal = normal;
+	outUV = uv;
+}
+
@@ -5,6 +5,15 @@
 #include "skeleton/core/debug_tools.h"
 #include "skeleton/core/application.h"
 #include "skeleton/renderer/renderer.h"
+#include "skeleton/renderer/memory_tracker.h"
+#include "skeleton/renderer/pipeline_cache.h"
+#include "skeleton/renderer/pipeline_builder.h"
+#include "skeleton/renderer/descriptor_allocator.h"
+#include "skeleton/renderer/descriptor_cache.h"
+#include "skeleton/renderer/bindless.h"
+#include "skeleton/renderer/shader_reflection.h"
+#include "skeleton/renderer/shader_hot_reload.h"
+#include "skeleton/renderer/shader_module_cache.h"
 
 #endif // !SKELETON_H
 
@@ -8,23 +8,47 @@
 #include "skeleton/core/debug_tools.h"
 #include "skeleton/core/time.h"
 #include "skeleton/core/file_system.h"
+#include "skeleton/core/profiler.h"
+#include "skeleton/renderer/memory_tracker.h"
+#include "skeleton/renderer/shader_hot_reload.h"
+
+SKL_ApplicationTimeData sklTime = {};
 
 void Application::Run()
 {
+  SklProfiler::SetThreadName("Main");
+  if (settings.profilePath != nullptr)
+  {
+    SklProfiler::StartCapture();
+  }
+
   Init();
   MainLoop();
+
+  if (settings.profilePath != nullptr)
+  {
+    SklProfiler::StopCapture(settings.profilePath);
+  }
+
   Cleanup();
 }
 
 void Application::CreateObject(const char* _meshDirectory, uint32_t _shaderProgramIndex)
 {
-  mesh_t m = CreateMesh(_meshDirectory);
+  CreateObject(CreateMesh(_meshDirectory), _shaderProgramIndex);
+}
 
+void Application::CreateObject(const mesh_t& _mesh, uint32_t _shaderProgramIndex,
+                               const std::vector<uint32_t>& _textures /*= {}*/)
+{
   // Creates a renderable from mesh & ShaderProgram
-  vulkanContext.renderables.push_back({m, _shaderProgramIndex});
+  vulkanContext.renderables.push_back({_mesh, _shaderProgramIndex});
+  vulkanContext.renderables.back().shaderFeatures =
+      vulkanContext.shaderPrograms[_shaderProgramIndex].defaultFeatures;
 
   renderer->CreateDescriptorSet(vulkanContext.shaderPrograms[_shaderProgramIndex],
-                                vulkanContext.renderables[vulkanContext.renderables.size() - 1]);
+                                vulkanContext.renderables[vulkanContext.renderables.size() - 1],
+                                _textures);
 }
 
 mesh_t Application::CreateMesh(const char* _directory)
@@ -32,36 +56,64 @@ mesh_t Application::CreateMesh(const char* _directory)
   return LoadMesh(_directory, renderer->bufferManager);
 }
 
+mesh_t Application::CreateMesh(const std::vector<vertex_t>& _vertices,
+                               const std::vector<uint32_t>& _indices)
+{
+  mesh_t mesh = {};
+  mesh.verticies = _vertices;
+  mesh.indices = _indices;
+  UploadMesh(mesh, renderer->bufferManager);
+  return mesh;
+}
+
 void Application::Init()
 {
   SKL_PRINT("Application", "Init =================================================");
 
   // Create SDL window
   //=================================================
-  if (SDL_Init(SDL_INIT_VIDEO) < 0)
+  // Headless runs never touch SDL, so they work without a display
+  std::vector<const char*> sdlExtensions;
+  if (!settings.headless)
   {
-    SKL_LOG("SDL ERROR", "%s", SDL_GetError());
-    throw "SDL failure";
-  }
-
-  uint32_t sdlFlags = SDL_WINDOW_SHOWN | SDL_WINDOW_VULKAN | SDL_WINDOW_INPUT_FOCUS |
-                      SDL_WINDOW_RESIZABLE;
-  window = SDL_CreateWindow("Skeleton Application", SDL_WINDOWPOS_UNDEFINED,
-                            SDL_WINDOWPOS_UNDEFINED, 800, 600, sdlFlags);
-  SDL_SetRelativeMouseMode(SDL_TRUE);
-  SDL_SetWindowGrab(window, SDL_TRUE);
+    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    {
+      SKL_LOG("SDL ERROR", "%s", SDL_GetError());
+      throw "SDL failure";
+    }
 
-  // Get instance extensions required by SDL
-  uint32_t sdlExtensionCount;
-  SDL_Vulkan_GetInstanceExtensions(window, &sdlExtensionCount, nullptr);
-  std::vector<const char*> sdlExtensions(sdlExtensionCount);
-  SDL_Vulkan_GetInstanceExtensions(window, &sdlExtensionCount, sdlExtensions.data());
+    uint32_t sdlFlags = SDL_WINDOW_SHOWN | SDL_WINDOW_VULKAN | SDL_WINDOW_INPUT_FOCUS |
+                        SDL_WINDOW_RESIZABLE;
+    window = SDL_CreateWindow("Skeleton Application", SDL_WINDOWPOS_UNDEFINED,
+                              SDL_WINDOWPOS_UNDEFINED, settings.width, settings.height,
+                              sdlFlags);
+    SDL_SetRelativeMouseMode(SDL_TRUE);
+    SDL_SetWindowGrab(window, SDL_TRUE);
+
+    // Get instance extensions required by SDL
+    uint32_t sdlExtensionCount;
+    SDL_Vulkan_GetInstanceExtensions(window, &sdlExtensionCount, nullptr);
+    sdlExtensions.resize(sdlExtensionCount);
+    SDL_Vulkan_GetInstanceExtensions(window, &sdlExtensionCount, sdlExtensions.data());
+  }
 
   // Create Renderer
   //=================================================
-  renderer = new Renderer(sdlExtensions, window);
+  renderer = new Renderer(sdlExtensions, window, { settings.width, settings.height });
+  renderer->backend->maxRenderables = settings.maxRenderables;
+  renderer->gpuPipelineStatistics = settings.gpuPipelineStatistics;
+  renderer->pipelineCachePath = settings.pipelineCachePath;
+  renderer->pipelineWorkerCount = settings.pipelineWorkers;
+  vulkanContext.extendedDynamicState &= settings.extendedDynamicState;
+  vulkanContext.bindless &= settings.bindless;
+  renderer->SetPresentPolicy(settings.presentPolicy);
   renderer->CreateRenderer();
 
+  if (settings.shaderHotReload)
+  {
+    SklShaderHotReload::Initialize();
+  }
+
   Start();
 }
 
@@ -70,111 +122,291 @@ void Application::Cleanup()
   SKL_PRINT("Application", "Cleanup =================================================");
 
   delete(renderer);
-  SDL_DestroyWindow(window);
+  if (window != nullptr)
+  {
+    SDL_DestroyWindow(window);
+  }
 }
 
 void Application::MainLoop()
 {
   SKL_PRINT("Application", "MainLoop =================================================");
 
-  SDL_Event e;
   auto startTime = std::chrono::high_resolution_clock::now();
   auto prevTime = startTime;
 
   float camSpeed = 2.f;
   float mouseSensativity = 0.1f;
 
-  uint32_t FPSCap = -1;
   uint32_t FPSPrintIndex = 0;
   float deltaSum = 0.001f;
   uint32_t deltaCount = 1;
+  float latencySum = 0.f;
 
   char titleBuffer[255];
   int titleBufferSize = 0;
 
-  while (!appShouldClose)
+  // Frame task graph
+  //=================================================
+  // Frame N+1's input and simulation overlap with frame N's recording and submission
+  SklTaskGraph frameGraph(MAX_FLIGHT_IMAGE_COUNT);
+
+  sklTaskResource inputResource = frameGraph.AddResource("Input");
+  sklTaskResource sceneResource = frameGraph.AddResource("Scene");
+  sklTaskResource mvpResource = frameGraph.AddResource("MVP Buffer");
+  sklTaskResource deviceResource = frameGraph.AddResource("Device");
+
+  // When each in-flight frame's input was sampled, handed to the renderer to measure latency
+  std::vector<std::chrono::steady_clock::time_point> inputTimes(MAX_FLIGHT_IMAGE_COUNT * 2);
+  // Each in-flight frame's time, published to sklTime by Simulate so CoreLoop never sees the
+  //   values of a frame whose input is already being gathered
+  std::vector<SKL_ApplicationTimeData> frameTimes(MAX_FLIGHT_IMAGE_COUNT * 2);
+  uint32_t frameCount = 0;
+
+  // Polls SDL events and samples time, must run on the thread that created the window
+  frameGraph.AddTask("Input", {}, { inputResource }, [&](uint64_t _frame)
   {
-    auto curTime = std::chrono::high_resolution_clock::now();
-    sklTime.totalTime = std::chrono::duration<float, std::chrono::seconds::period>
-        (curTime - startTime).count();
-    sklTime.deltaTime = std::chrono::duration<float, std::chrono::seconds::period>
-        (curTime - prevTime).count();
-
     // FPS cap
-    while (FPSCap != -1 && sklTime.deltaTime < (1.f / FPSCap))
+    framePacer.Wait();
+
+    // Sampling input only once the previous frame is done keeps it from queueing behind others
+    if (renderer->GetPresentPolicy().lowLatency)
     {
-      curTime = std::chrono::high_resolution_clock::now();
-      sklTime.totalTime = std::chrono::duration<float, std::chrono::seconds::period>
-          (curTime - startTime).count();
-      sklTime.deltaTime = std::chrono::duration<float, std::chrono::seconds::period>
-          (curTime - prevTime).count();
+      renderer->WaitForFrame(_frame);
     }
+    inputTimes[_frame % inputTimes.size()] = std::chrono::steady_clock::now();
+
+    auto curTime = std::chrono::high_resolution_clock::now();
+    SKL_ApplicationTimeData& frameTime = frameTimes[_frame % frameTimes.size()];
+    frameTime.totalTime = std::chrono::duration<float, std::chrono::seconds::period>
+        (curTime - startTime).count();
+    frameTime.deltaTime = std::chrono::duration<float, std::chrono::seconds::period>
+        (curTime - prevTime).count();
 
     // Poll and handle SDL events
-    while (SDL_PollEvent(&e) != 0)
+    SDL_Event e;
+    frameInput.mouseDelta = glm::vec2(0.f);
+    while (!settings.headless && SDL_PollEvent(&e) != 0)
     {
       if (e.type == SDL_QUIT || (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE))
       {
         appShouldClose = true;
       }
+      if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F8)
+      {
+        frameGraph.PrintCriticalPath();
+      }
+      // Toggles a profile capture, written when the capture ends
+      if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F9)
+      {
+        if (SklProfiler::IsCapturing())
+        {
+          SklProfiler::StopCapture("profile_capture.json");
+        }
+        else
+        {
+          SklProfiler::StartCapture();
+        }
+      }
+      if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+      {
+        renderer->RecreateRenderer();
+      }
       if (e.type == SDL_MOUSEMOTION)
       {
-        renderer->cam.yaw += e.motion.xrel * mouseSensativity;
-        renderer->cam.pitch -= e.motion.yrel * mouseSensativity;
-        renderer->cam.pitch = glm::clamp(renderer->cam.pitch, -89.f, 89.f);
+        frameInput.mouseDelta.x += e.motion.xrel;
+        frameInput.mouseDelta.y += e.motion.yrel;
       }
     }
 
-    int keyCount = 0;
-    const Uint8* keyboardState = SDL_GetKeyboardState(&keyCount);
-
-    // TODO : Create a proper input system and move this to Main's Application
-    if (keyboardState[SDL_SCANCODE_W])
-      renderer->cam.position += renderer->cam.GetForward() * camSpeed * sklTime.deltaTime;
-    if (keyboardState[SDL_SCANCODE_S])
-      renderer->cam.position -= renderer->cam.GetForward() * camSpeed * sklTime.deltaTime;
-    if (keyboardState[SDL_SCANCODE_D])
-      renderer->cam.position += renderer->cam.GetRight() * camSpeed * sklTime.deltaTime;
-    if (keyboardState[SDL_SCANCODE_A])
-      renderer->cam.position -= renderer->cam.GetRight() * camSpeed * sklTime.deltaTime;
-    if (keyboardState[SDL_SCANCODE_E] || keyboardState[SDL_SCANCODE_LSHIFT])
-      renderer->cam.position += glm::vec3(0.f, 1.f, 0.f) * camSpeed * sklTime.deltaTime;
-    if (keyboardState[SDL_SCANCODE_Q] || keyboardState[SDL_SCANCODE_LCTRL])
-      renderer->cam.position -= glm::vec3(0.f, 1.f, 0.f) * camSpeed * sklTime.deltaTime;
-
-    mvp.model = glm::rotate(glm::mat4(1.f), sklTime.totalTime, glm::vec3(0.f, 1.f, 0.f));
-    mvp.view = renderer->cam.GetViewMatrix();
-    mvp.proj = renderer->cam.projectionMatrix;
-    mvp.proj[1][1] *= -1;
-
-    renderer->bufferManager->FillBuffer(renderer->mvpMemory, &mvp, sizeof(mvp));
-
-    CoreLoop();
-    renderer->RenderFrame();
+    if (settings.headless)
+    {
+      frameInput.keyboard.assign(SDL_NUM_SCANCODES, 0);
+    }
+    else
+    {
+      int keyCount = 0;
+      const Uint8* keyboardState = SDL_GetKeyboardState(&keyCount);
+      frameInput.keyboard.assign(keyboardState, keyboardState + keyCount);
+    }
 
     // Print FPS information once per second
-    if (sklTime.totalTime < FPSPrintIndex)
+    if (frameTime.totalTime < FPSPrintIndex)
     {
-      deltaSum += sklTime.deltaTime;
+      deltaSum += frameTime.deltaTime;
+      latencySum += renderer->inputLatency.load();
       deltaCount++;
     }
     else
     {
       float avgFPS = deltaSum / deltaCount;
 
-      SKL_PRINT_SLIM("%6.0f sec, %4.2f ms average, Frame# %6u, %4.2f FPS", sklTime.totalTime,
-                     avgFPS * 1000.f, sklTime.frameCount, 1.f / avgFPS);
+      SKL_PRINT_SLIM("%6.0f sec, %4.2f ms average, Frame# %6u, %4.2f FPS", frameTime.totalTime,
+                     avgFPS * 1000.f, frameCount, 1.f / avgFPS);
       titleBufferSize = sprintf_s(titleBuffer, 255, "Skeleton :==: %4.2f ms :==: %4.2f FPS",
                                   avgFPS * 1000.0f, 1.0f / avgFPS);
-      SDL_SetWindowTitle(window, titleBuffer);
+      if (window != nullptr)
+      {
+        SDL_SetWindowTitle(window, titleBuffer);
+      }
+
+      if (deltaCount > 0)
+      {
+        // The policy in effect, after clamping and unsupported mode fallbacks
+        sklPresentPolicy_t policy = renderer->backend->presentPolicy;
+        SKL_PRINT_SLIM("\tLatency: %4.2f ms input to present, %s, %u frames in flight%s",
+                       latencySum / deltaCount, SklPresentModeName(policy.mode),
+                       policy.framesInFlight, policy.lowLatency ? ", low latency" : "");
+      }
+
+      if (framePacer.GetTargetFrameTime() > 0.0)
+      {
+        sklFramePacerStats_t paceStats = framePacer.GetStats();
+        SKL_PRINT_SLIM("\tPacing: %4.2f ms target, %4.3f ms jitter, %4.3f ms max error, "
+                       "%4.0f us spin margin", paceStats.targetMs, paceStats.jitterMs,
+                       paceStats.maxErrorMs, paceStats.spinMarginUs);
+        framePacer.ResetStats();
+      }
+
+      if (settings.memoryStatsInterval != 0 && FPSPrintIndex % settings.memoryStatsInterval == 0)
+      {
+        SklMemoryTracker::PrintStats();
+      }
 
       FPSPrintIndex++;
       deltaSum = 0;
+      latencySum = 0;
       deltaCount = 0;
     }
 
     prevTime = curTime;
-    sklTime.frameCount++;
+    frameCount++;
+    frameTime.frameCount = frameCount;
+
+    if (settings.frameLimit != 0 && frameCount >= settings.frameLimit)
+    {
+      appShouldClose = true;
+    }
+  }, true);
+
+  // Simulation state, advanced only in fixed steps
+  float simulationAccumulator = 0.f;
+  glm::vec2 pendingLook(0.f);
+  Camera previousCam = renderer->cam;
+  float projectionAspect = renderer->aspectRatio;
+
+  // Advances the simulation by exactly one fixed step
+  auto simulateStep = [&]()
+  {
+    Camera& cam = renderer->cam;
+    previousCam = cam;
+    float step = sklTime.fixedDeltaTime;
+
+    // Mouse motion is applied once, on the first step that follows it
+    cam.yaw += pendingLook.x * mouseSensativity;
+    cam.pitch -= pendingLook.y * mouseSensativity;
+    cam.pitch = glm::clamp(cam.pitch, -89.f, 89.f);
+    pendingLook = glm::vec2(0.f);
+    cam.UpdateVectors();
+
+    // TODO : Create a proper input system and move this to Main's Application
+    const std::vector<Uint8>& keys = frameInput.keyboard;
+    if (keys[SDL_SCANCODE_W])
+      cam.position += cam.GetForward() * camSpeed * step;
+    if (keys[SDL_SCANCODE_S])
+      cam.position -= cam.GetForward() * camSpeed * step;
+    if (keys[SDL_SCANCODE_D])
+      cam.position += cam.GetRight() * camSpeed * step;
+    if (keys[SDL_SCANCODE_A])
+      cam.position -= cam.GetRight() * camSpeed * step;
+    if (keys[SDL_SCANCODE_E] || keys[SDL_SCANCODE_LSHIFT])
+      cam.position += glm::vec3(0.f, 1.f, 0.f) * camSpeed * step;
+    if (keys[SDL_SCANCODE_Q] || keys[SDL_SCANCODE_LCTRL])
+      cam.position -= glm::vec3(0.f, 1.f, 0.f) * camSpeed * step;
+
+    FixedLoop();
+
+    sklTime.simulationTime += step;
+    sklTime.fixedStepCount++;
+  };
+
+  // Steps the simulation to catch up with real time, then interpolates the render state
+  frameGraph.AddTask("Simulate", { inputResource }, { sceneResource }, [&](uint64_t _frame)
+  {
+    const SKL_ApplicationTimeData& frameTime = frameTimes[_frame % frameTimes.size()];
+    sklTime.totalTime = frameTime.totalTime;
+    sklTime.deltaTime = frameTime.deltaTime;
+    sklTime.frameCount = frameTime.frameCount;
+
+    pendingLook += frameInput.mouseDelta;
+
+    // Follow the swapchain's shape after a resize
+    if (renderer->aspectRatio != projectionAspect)
+    {
+      projectionAspect = renderer->aspectRatio;
+      renderer->cam.UpdateProjection(projectionAspect);
+      previousCam.projectionMatrix = renderer->cam.projectionMatrix;
+    }
+
+    // Clamping the frame's time bounds the catch-up steps, dropping time after long stalls
+    float step = sklTime.fixedDeltaTime;
+    simulationAccumulator += glm::min(sklTime.deltaTime, step * maxFixedStepsPerFrame);
+    while (simulationAccumulator >= step)
+    {
+      simulateStep();
+      simulationAccumulator -= step;
+    }
+    sklTime.interpolationAlpha = simulationAccumulator / step;
+
+    // Render between the previous and current simulation states
+    float alpha = sklTime.interpolationAlpha;
+    Camera renderCam = renderer->cam;
+    renderCam.position = glm::mix(previousCam.position, renderer->cam.position, alpha);
+    renderCam.pitch = glm::mix(previousCam.pitch, renderer->cam.pitch, alpha);
+    renderCam.yaw = glm::mix(previousCam.yaw, renderer->cam.yaw, alpha);
+    float renderTime = static_cast<float>(sklTime.simulationTime - step * (1.f - alpha));
+
+    mvp.model = glm::rotate(glm::mat4(1.f), renderTime, glm::vec3(0.f, 1.f, 0.f));
+    mvp.view = renderCam.GetViewMatrix();
+    mvp.proj = renderCam.projectionMatrix;
+    mvp.proj[1][1] *= -1;
+  });
+
+  // Copies the matrices into the host-visible MVP buffer
+  frameGraph.AddTask("Upload", { sceneResource }, { mvpResource }, [&](uint64_t _frame)
+  {
+    renderer->bufferManager->FillBuffer(renderer->mvpMemory, &mvp, sizeof(mvp));
+  });
+
+  // User defined per-frame work, may submit GPU work of its own
+  // The frame is begun first so anything it allocates for the frame lives until it's rendered
+  frameGraph.AddTask("CoreLoop", { sceneResource, mvpResource }, { deviceResource },
+                     [&](uint64_t _frame)
+  {
+    renderer->BeginFrame();
+    CoreLoop();
+  });
+
+  // Waits for the frame's fence, then submits and presents
+  frameGraph.AddTask("Render", {}, { deviceResource }, [&](uint64_t _frame)
+  {
+    renderer->RenderFrame(inputTimes[_frame % inputTimes.size()]);
+  });
+
+  // Run
+  //=================================================
+  uint64_t frame = 0;
+  while (!appShouldClose)
+  {
+    frameGraph.Kick(frame);
+    frameGraph.RunMainThreadTasks(frame);
+    frame++;
   }
-}
 
+  frameGraph.WaitIdle();
+
+  if (settings.capturePath != nullptr)
+  {
+    renderer->CaptureFrame(settings.capturePath);
+  }
+}
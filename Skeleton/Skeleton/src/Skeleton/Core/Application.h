@@ -6,6 +6,28 @@
 #include "sdl/SDL_vulkan.h"
 
 #include "skeleton/renderer/renderer.h"
+#include "skeleton/core/task_graph.h"
+#include "skeleton/core/frame_pacer.h"
+
+// Options applied when the application initializes
+struct sklApplicationSettings_t
+{
+  bool headless = false;              // Render offscreen without creating a window or polling SDL
+  uint32_t width = 800;               // Size of the window or offscreen images
+  uint32_t height = 600;
+  uint64_t frameLimit = 0;            // Closes the application after this many frames, 0 for none
+  const char* capturePath = nullptr;  // Writes the final headless frame to this .png file
+  uint32_t maxRenderables = 64;       // Objects the first descriptor pool is sized for
+  bool gpuPipelineStatistics = false; // Gather pipeline statistics alongside GPU scope timings
+  const char* profilePath = nullptr;  // Writes a CPU and GPU profile of the whole run to this .json
+  uint32_t memoryStatsInterval = 0;   // Seconds between memory usage prints, 0 for none
+  const char* pipelineCachePath = "pipeline_cache.bin";  // Compiled pipelines, null for none
+  uint32_t pipelineWorkers = 0;       // Threads compiling pipelines, 0 for one per spare core
+  bool extendedDynamicState = true;   // Set cull and depth state per draw when supported
+  bool bindless = false;              // Index resources from one global set, needs bindless shaders
+  bool shaderHotReload = false;       // Recompile and swap in shaders as they are edited
+  sklPresentPolicy_t presentPolicy;   // Present mode, image counts, and input latency trade-off
+};
 
 // Abstract class to handle project-independent boilerplate
 // Bridge for all Game/Engine communication
@@ -14,11 +36,17 @@ class Application
   //////////////////////////////////////////////////////////////////////////
   // Variables
   //////////////////////////////////////////////////////////////////////////
+public:
+  // Must be set before calling Run
+  sklApplicationSettings_t settings;
+
 protected:
-  SDL_Window* window;
+  SDL_Window* window = nullptr;
   bool appShouldClose = false;
 
   Renderer* renderer;
+  // Limits the frame rate, uncapped unless a target is set
+  SklFramePacer framePacer;
   // InputManager
   // AudioManager
 
@@ -30,6 +58,15 @@ protected:
     glm::mat4 proj;
   } mvp;
 
+  // Input gathered on the main thread for use by the simulation task
+  struct sklFrameInput_t {
+    std::vector<Uint8> keyboard;  // Snapshot of SDL's keyboard state
+    glm::vec2 mouseDelta;         // Relative mouse motion since the last frame
+  } frameInput;
+
+  // Maximum simulation steps taken in one frame before dropping time
+  uint32_t maxFixedStepsPerFrame = 5;
+
   //////////////////////////////////////////////////////////////////////////
   // Functions
   //////////////////////////////////////////////////////////////////////////
@@ -42,12 +79,22 @@ protected:
   // (Pure) User defined function called once at the end of Init
   virtual void Start() = 0;
   // (Pure) User defined function called once per frame before rendering
+  // The renderer's frame has begun, so per-frame allocations made here last until it's rendered
   virtual void CoreLoop() = 0;
+  // User defined function called once per simulation step, sklTime.fixedDeltaTime apart
+  // Should depend only on input and simulation state to remain deterministic
+  virtual void FixedLoop() {}
 
   // Creates and binds a renderable in the renderer
   void CreateObject(const char* _meshDirectory, uint32_t _shaderProgramIndex);
+  // Binds a renderable using an existing mesh
+  // Image bindings use _textures in order, or the default test images when none are given
+  void CreateObject(const mesh_t& _mesh, uint32_t _shaderProgramIndex,
+                    const std::vector<uint32_t>& _textures = {});
   // Loads an obj file and creates a renderable mesh
   mesh_t CreateMesh(const char* _directory);
+  // Creates a renderable mesh from vertex and index arrays
+  mesh_t CreateMesh(const std::vector<vertex_t>& _vertices, const std::vector<uint32_t>& _indices);
   // Binds a renderable in the renderer
   //sklRenderable_t CreateRenderable(mesh_t _mesh, uint32_t _shaderIndex);
 
@@ -56,7 +103,7 @@ private:
   void Init();
   // Destroys all member components, frees all allocated memory
   void Cleanup();
-  // Handles user input, time, and calls user defined CoreLoop function
+  // Builds the frame task graph and runs it until the application should close
   void MainLoop();
 
 }; // class Application
@@ -25,12 +25,17 @@ private:
   // Functions
   //=================================================
 public:
-  glm::mat4 GetViewMatrix()
+  // Recalculates the forward vector from pitch and yaw
+  void UpdateVectors()
   {
     forward.x = (float)(glm::cos(glm::radians(yaw)) * glm::cos(glm::radians(pitch)));
     forward.y = (float)glm::sin(glm::radians(pitch));
     forward.z = (float)(glm::sin(glm::radians(yaw)) * glm::cos(glm::radians(pitch)));
+  }
 
+  glm::mat4 GetViewMatrix()
+  {
+    UpdateVectors();
     return glm::lookAt(position, position + forward, { 0.f, 1.f, 0.f });
   }
 
@@ -41,6 +46,13 @@ public:
     return projectionMatrix;
   }
 
+  // Sets the view frustum's cull distances, applied by the next UpdateProjection
+  void SetRenderDistances(float _min, float _max)
+  {
+    minRenderDist = _min;
+    maxRenderDist = _max;
+  }
+
   glm::vec3 GetForward() { return forward; }
   glm::vec3 GetRight() { return glm::normalize(glm::cross(forward, { 0.f, 1.f, 0.f })); }
 
@@ -4,12 +4,21 @@
 
 // TODO : Move to a managed class/struct
 // Stores all application time information
-static struct SKL_ApplicationTimeData
+struct SKL_ApplicationTimeData
 {
   float totalTime;      // In seconds
   float deltaTime;      // In seconds
   uint32_t frameCount;  //Number of frames rendered
-} sklTime;
+
+  float fixedDeltaTime = 1.f / 60.f;  // Duration of one simulation step in seconds
+  double simulationTime;              // Simulated seconds, advances only in fixed steps
+  uint64_t fixedStepCount;            // Number of simulation steps taken
+  float interpolationAlpha;           // How far rendering is between the last two steps [0, 1)
+};
+
+// Shared by every translation unit, defined in application.cpp
+// Updated by the simulation task once per frame, safe to read from FixedLoop and CoreLoop
+extern SKL_ApplicationTimeData sklTime;
 
 #endif // !SKELETON_CORE_TIME_H
 
@@ -6,7 +6,7 @@
 
 #include "vulkan/vulkan.h"
 
-// TODO : Replace this file with a more permanent debug/logging system
+#include "skeleton/core/logger.h"
 
 #define SKL_DEBUG "SKL_DEBUG"
 #define SKL_ERROR "SKL_ERROR"
@@ -64,41 +64,65 @@ inline const char* VulkanResultToString(VkResult _result)
   #undef ETS
 }
 
-#define SKL_PRINT(category, message, ...)  \
-{                                          \
-  printf(":-skl-: %-15s :--: ", category);         \
-  printf(message, __VA_ARGS__);            \
-  printf("\n");                            \
+// Queues a message for the logger's writer thread
+// Each statement owns a static site holding its constant data and filter state
+#define SKL_LOG_WRITE(level, style, category, message, ...)                                  \
+{                                                                                           \
+  static sklLogSite_t sklLogSite(level, style, category, message, __FILE__, __LINE__);      \
+  if (SklLogger::IsEnabled(sklLogSite))                                                     \
+  {                                                                                         \
+    SklLogger::Write(sklLogSite, __VA_ARGS__);                                              \
+  }                                                                                         \
 }
 
-#define SKL_PRINT_SIMPLE(message, ...)            \
-{                                                 \
-  SKL_PRINT(__FUNCTION__, message, __VA_ARGS__);  \
-}
-
-#define SKL_PRINT_SLIM(message, ...)  \
-{                                     \
-  printf(message, __VA_ARGS__);       \
-  printf("\n");                       \
-}
+#if SKL_LOG_LEVEL <= SKL_LOG_LEVEL_DEBUG
+#define SKL_PRINT_DEBUG(category, message, ...)                                           \
+  SKL_LOG_WRITE(SKL_LOG_LEVEL_DEBUG, Skl_Log_Style_Category, category, message, __VA_ARGS__)
 
-#define SKL_LOG(category, message, ...)                \
-{                                                      \
-  SKL_PRINT(category, message, __VA_ARGS__);           \
-  SKL_PRINT_SLIM("\t%s :--: %d", __FILE__, __LINE__);  \
+#define SKL_PRINT_SIMPLE(message, ...)                \
+{                                                     \
+  SKL_PRINT_DEBUG(__FUNCTION__, message, __VA_ARGS__); \
 }
+#else
+#define SKL_PRINT_DEBUG(category, message, ...) {}
+#define SKL_PRINT_SIMPLE(message, ...) {}
+#endif // SKL_LOG_LEVEL <= SKL_LOG_LEVEL_DEBUG
+
+#if SKL_LOG_LEVEL <= SKL_LOG_LEVEL_INFO
+#define SKL_PRINT(category, message, ...)                                                 \
+  SKL_LOG_WRITE(SKL_LOG_LEVEL_INFO, Skl_Log_Style_Category, category, message, __VA_ARGS__)
+
+#define SKL_PRINT_SLIM(message, ...)                                                      \
+  SKL_LOG_WRITE(SKL_LOG_LEVEL_INFO, Skl_Log_Style_Slim, "", message, __VA_ARGS__)
+#else
+#define SKL_PRINT(category, message, ...) {}
+#define SKL_PRINT_SLIM(message, ...) {}
+#endif // SKL_LOG_LEVEL <= SKL_LOG_LEVEL_INFO
+
+#if SKL_LOG_LEVEL <= SKL_LOG_LEVEL_WARNING
+#define SKL_PRINT_WARNING(category, message, ...)                                         \
+  SKL_LOG_WRITE(SKL_LOG_LEVEL_WARNING, Skl_Log_Style_Category, category, message, __VA_ARGS__)
+#else
+#define SKL_PRINT_WARNING(category, message, ...) {}
+#endif // SKL_LOG_LEVEL <= SKL_LOG_LEVEL_WARNING
+
+// Errors are never compiled out
+#define SKL_LOG(category, message, ...)                                                   \
+  SKL_LOG_WRITE(SKL_LOG_LEVEL_ERROR, Skl_Log_Style_Located, category, message, __VA_ARGS__)
 
 #define SKL_PRINT_ERROR(message, ...)           \
 {                                               \
   SKL_LOG(__FUNCTION__, message, __VA_ARGS__);  \
 }
 
+// Flushes the logger before throwing so the message is written before any handler runs
 #define SKL_ASSERT_VK(vkFunction, errorMessage, ...)    \
 {                                                       \
   VkResult vkAssertResult = vkFunction;                 \
   if (vkAssertResult != VK_SUCCESS)                     \
   {                                                     \
-    SKL_PRINT(SKL_ERROR_VK, errorMessage, __VA_ARGS__); \
+    SKL_LOG(SKL_ERROR_VK, errorMessage, __VA_ARGS__);   \
+    SklLogger::Flush();                                 \
     throw VulkanResultToString(vkAssertResult);         \
   }                                                     \
 }
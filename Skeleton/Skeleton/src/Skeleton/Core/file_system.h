@@ -5,6 +5,7 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <algorithm>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
@@ -13,6 +14,7 @@
 
 #include "skeleton/core/debug_tools.h"
 #include "skeleton/core/time.h"
+#include "skeleton/core/profiler.h"
 #include "skeleton/renderer/render_backend.h"
 
 // Loads a file's binary as a char array
@@ -51,9 +53,124 @@ inline void DestroyImageFile(void* _data)
   stbi_image_free(_data);
 }
 
+// Writes 8-bit RGBA pixels to a .png file
+// Image data is stored uncompressed, trading file size for having no dependencies
+inline bool WritePngFile(const char* _directory, uint32_t _width, uint32_t _height,
+                         const void* _rgba)
+{
+  std::ofstream outFile(_directory, std::ios::binary);
+  if (!outFile)
+  {
+    SKL_LOG(SKL_ERROR, "Failed to open file \"%s\"", _directory);
+    return false;
+  }
+
+  uint32_t crcTable[256];
+  for (uint32_t i = 0; i < 256; i++)
+  {
+    uint32_t c = i;
+    for (uint32_t k = 0; k < 8; k++)
+    {
+      c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    }
+    crcTable[i] = c;
+  }
+
+  auto PushU32 = [](std::vector<uint8_t>& _out, uint32_t _value)
+  {
+    _out.push_back(static_cast<uint8_t>(_value >> 24));
+    _out.push_back(static_cast<uint8_t>(_value >> 16));
+    _out.push_back(static_cast<uint8_t>(_value >> 8));
+    _out.push_back(static_cast<uint8_t>(_value));
+  };
+
+  auto WriteChunk = [&](const char* _type, const std::vector<uint8_t>& _data)
+  {
+    std::vector<uint8_t> chunk;
+    PushU32(chunk, static_cast<uint32_t>(_data.size()));
+    chunk.insert(chunk.end(), _type, _type + 4);
+    chunk.insert(chunk.end(), _data.begin(), _data.end());
+
+    // CRC covers the type and data
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 4; i < chunk.size(); i++)
+    {
+      crc = crcTable[(crc ^ chunk[i]) & 0xFF] ^ (crc >> 8);
+    }
+    PushU32(chunk, crc ^ 0xFFFFFFFFu);
+
+    outFile.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+  };
+
+  const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  outFile.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+  // Header : 8-bit depth, RGBA, no interlacing
+  std::vector<uint8_t> header;
+  PushU32(header, _width);
+  PushU32(header, _height);
+  header.insert(header.end(), { 8, 6, 0, 0, 0 });
+  WriteChunk("IHDR", header);
+
+  // Scanlines, each prefixed with filter type 0
+  const uint8_t* pixels = static_cast<const uint8_t*>(_rgba);
+  size_t rowSize = static_cast<size_t>(_width) * 4;
+  std::vector<uint8_t> raw;
+  raw.reserve((rowSize + 1) * _height);
+  for (uint32_t y = 0; y < _height; y++)
+  {
+    raw.push_back(0);
+    raw.insert(raw.end(), pixels + y * rowSize, pixels + (y + 1) * rowSize);
+  }
+
+  // Zlib stream of stored deflate blocks
+  std::vector<uint8_t> compressed = { 0x78, 0x01 };
+  size_t offset = 0;
+  do
+  {
+    size_t blockSize = std::min<size_t>(raw.size() - offset, 65535);
+    bool last = offset + blockSize == raw.size();
+    compressed.push_back(last ? 1 : 0);
+    compressed.push_back(static_cast<uint8_t>(blockSize));
+    compressed.push_back(static_cast<uint8_t>(blockSize >> 8));
+    compressed.push_back(static_cast<uint8_t>(~blockSize));
+    compressed.push_back(static_cast<uint8_t>(~blockSize >> 8));
+    compressed.insert(compressed.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+    offset += blockSize;
+  } while (offset < raw.size());
+
+  uint32_t adlerA = 1, adlerB = 0;
+  for (uint8_t byte : raw)
+  {
+    adlerA = (adlerA + byte) % 65521;
+    adlerB = (adlerB + adlerA) % 65521;
+  }
+  PushU32(compressed, (adlerB << 16) | adlerA);
+
+  WriteChunk("IDAT", compressed);
+  WriteChunk("IEND", {});
+
+  return outFile.good();
+}
+
+// Creates a mesh's vertex and index buffers from its arrays
+inline void UploadMesh(mesh_t& _mesh, BufferManager* _bufferManager)
+{
+  _mesh.vertexBufferIndex = _bufferManager->CreateAndFillBuffer(_mesh.verticies.data(),
+      _mesh.verticies.size() * sizeof(_mesh.verticies[0]), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+  _mesh.indexBufferIndex = _bufferManager->CreateAndFillBuffer(_mesh.indices.data(),
+      _mesh.indices.size() * sizeof(_mesh.indices[0]), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+  _mesh.vertexBuffer = _bufferManager->GetBuffer(_mesh.vertexBufferIndex);
+  _mesh.indexBuffer = _bufferManager->GetBuffer(_mesh.indexBufferIndex);
+}
+
 // Loads a .obj file and converts it to a skl_Mesh
 inline mesh_t LoadMesh(const char* _directory, BufferManager* _bufferManager)
 {
+  SKL_PROFILE_FUNCTION();
+
   tinyobj::attrib_t attrib;
   std::vector<tinyobj::shape_t> shapes;
   std::vector<tinyobj::material_t> materials;
@@ -101,14 +218,7 @@ inline mesh_t LoadMesh(const char* _directory, BufferManager* _bufferManager)
     }
   }
 
-  mesh.vertexBufferIndex = _bufferManager->CreateAndFillBuffer(mesh.verticies.data(),
-      mesh.verticies.size() * sizeof(mesh.verticies[0]), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-
-  mesh.indexBufferIndex = _bufferManager->CreateAndFillBuffer(mesh.indices.data(),
-      mesh.indices.size() * sizeof(mesh.indices[0]), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-
-  mesh.vertexBuffer = _bufferManager->GetBuffer(mesh.vertexBufferIndex);
-  mesh.indexBuffer = _bufferManager->GetBuffer(mesh.indexBufferIndex);
+  UploadMesh(mesh, _bufferManager);
 
   SKL_PRINT("Mesh", "%zd unique verts -- %u, %u", mesh.verticies.size(), mesh.vertexBufferIndex, mesh.indexBufferIndex);
 
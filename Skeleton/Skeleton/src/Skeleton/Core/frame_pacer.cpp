@@ -0,0 +1,205 @@
+
+#include "pch.h"
+#include "skeleton/core/frame_pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#include <errno.h>
+#endif
+
+// Bounds on the time spent spinning before a deadline (nanoseconds)
+#define SKL_PACER_MIN_SPIN_NS 50000.0
+#define SKL_PACER_MAX_SPIN_NS 2000000.0
+#define SKL_PACER_INITIAL_SPIN_NS 500000.0
+
+SklFramePacer::SklFramePacer() : spinMargin(SKL_PACER_INITIAL_SPIN_NS)
+{
+#ifdef _WIN32
+  // High resolution timers are available on Windows 10 1803 and later
+#ifdef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+  waitableTimer = CreateWaitableTimerExW(nullptr, nullptr,
+                                         CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+  if (waitableTimer == nullptr)
+  {
+    waitableTimer = CreateWaitableTimerW(nullptr, TRUE, nullptr);
+  }
+#endif
+}
+
+SklFramePacer::~SklFramePacer()
+{
+#ifdef _WIN32
+  if (waitableTimer != nullptr)
+  {
+    CloseHandle(waitableTimer);
+  }
+#endif
+}
+
+void SklFramePacer::SetTargetFps(float _fps)
+{
+  SetTargetFrameTime(_fps > 0.f ? 1.0 / _fps : 0.0);
+}
+
+void SklFramePacer::SetTargetFrameTime(double _seconds)
+{
+  targetFrameTime = std::chrono::duration_cast<clock::duration>(
+      std::chrono::duration<double>(std::max(_seconds, 0.0)));
+  Reset();
+  ResetStats();
+}
+
+double SklFramePacer::GetTargetFrameTime() const
+{
+  return std::chrono::duration<double>(targetFrameTime).count();
+}
+
+void SklFramePacer::Wait()
+{
+  clock::time_point now = clock::now();
+
+  if (!started)
+  {
+    started = true;
+    nextDeadline = now + targetFrameTime;
+    lastFrame = now;
+    return;
+  }
+
+  if (targetFrameTime > clock::duration::zero())
+  {
+    // Fell more than a frame behind, start a new cadence rather than rushing to catch up
+    if (now > nextDeadline + targetFrameTime)
+    {
+      nextDeadline = now;
+    }
+
+    // Sleep through the bulk of the wait
+    clock::time_point wakeTime = nextDeadline -
+        std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::nano>(
+            spinMargin));
+    if (wakeTime > now)
+    {
+      SleepUntil(wakeTime);
+      RecordOversleep(std::chrono::duration<double, std::nano>(clock::now() - wakeTime).count());
+    }
+
+    // Spin for the remainder
+    while (clock::now() < nextDeadline)
+    {
+      std::this_thread::yield();
+    }
+
+    now = clock::now();
+    nextDeadline += targetFrameTime;
+  }
+
+  // Statistics
+  double interval = std::chrono::duration<double, std::nano>(now - lastFrame).count();
+  lastFrame = now;
+  frameCount++;
+  intervalSum += interval;
+  intervalSquaredSum += interval * interval;
+  if (targetFrameTime > clock::duration::zero())
+  {
+    double target = std::chrono::duration<double, std::nano>(targetFrameTime).count();
+    maxError = std::max(maxError, std::abs(interval - target));
+  }
+}
+
+void SklFramePacer::Reset()
+{
+  started = false;
+}
+
+sklFramePacerStats_t SklFramePacer::GetStats() const
+{
+  sklFramePacerStats_t stats = {};
+  stats.frameCount = frameCount;
+  stats.targetMs = std::chrono::duration<double, std::milli>(targetFrameTime).count();
+  stats.spinMarginUs = spinMargin / 1000.0;
+
+  if (frameCount > 0)
+  {
+    double mean = intervalSum / frameCount;
+    double variance = std::max(intervalSquaredSum / frameCount - mean * mean, 0.0);
+    stats.meanIntervalMs = mean / 1000000.0;
+    stats.jitterMs = std::sqrt(variance) / 1000000.0;
+    stats.maxErrorMs = maxError / 1000000.0;
+  }
+  if (sleepCount > 0)
+  {
+    stats.meanOversleepUs = oversleepSum / sleepCount / 1000.0;
+  }
+
+  return stats;
+}
+
+void SklFramePacer::ResetStats()
+{
+  frameCount = 0;
+  intervalSum = 0.0;
+  intervalSquaredSum = 0.0;
+  maxError = 0.0;
+  oversleepSum = 0.0;
+  sleepCount = 0;
+}
+
+void SklFramePacer::SleepUntil(clock::time_point _wakeTime)
+{
+  int64_t sleepNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      _wakeTime - clock::now()).count();
+  if (sleepNs <= 0)
+    return;
+
+#ifdef _WIN32
+  if (waitableTimer != nullptr)
+  {
+    // Negative due times are relative, in 100ns units
+    LARGE_INTEGER dueTime;
+    dueTime.QuadPart = -static_cast<LONGLONG>(sleepNs / 100);
+    if (SetWaitableTimer(waitableTimer, &dueTime, 0, nullptr, nullptr, FALSE))
+    {
+      WaitForSingleObject(waitableTimer, INFINITE);
+      return;
+    }
+  }
+  std::this_thread::sleep_until(_wakeTime);
+#else
+  // Sleep against an absolute deadline so interruptions don't accumulate error
+  timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  int64_t wakeNs = static_cast<int64_t>(deadline.tv_nsec) + sleepNs;
+  deadline.tv_sec += static_cast<time_t>(wakeNs / 1000000000);
+  deadline.tv_nsec = static_cast<long>(wakeNs % 1000000000);
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+  {
+  }
+#endif
+}
+
+void SklFramePacer::RecordOversleep(double _oversleepNs)
+{
+  _oversleepNs = std::max(_oversleepNs, 0.0);
+  oversleepSum += _oversleepNs;
+  sleepCount++;
+
+  // Exponentially weighted mean and deviation of the OS's wake latency
+  const double weight = 0.1;
+  double difference = _oversleepNs - oversleepMean;
+  oversleepMean += weight * difference;
+  oversleepDeviation += weight * (std::abs(difference) - oversleepDeviation);
+
+  // Spin long enough to cover nearly all observed wake latencies
+  spinMargin = std::clamp(oversleepMean + 3.0 * oversleepDeviation,
+                          SKL_PACER_MIN_SPIN_NS, SKL_PACER_MAX_SPIN_NS);
+}
@@ -0,0 +1,82 @@
+
+#ifndef SKELETON_CORE_FRAME_PACER_H
+#define SKELETON_CORE_FRAME_PACER_H 1
+
+#include <chrono>
+
+// Summary of how closely frames have matched the pacer's target
+struct sklFramePacerStats_t
+{
+  uint64_t frameCount;     // Frames paced since the last reset
+  double targetMs;         // Target frame time (0 when uncapped)
+  double meanIntervalMs;   // Average time between frames
+  double jitterMs;         // Standard deviation of the time between frames
+  double maxErrorMs;       // Largest difference between a frame's interval and the target
+  double meanOversleepUs;  // Average time the OS slept past the requested wake time
+  double spinMarginUs;     // Time currently reserved for spinning before each deadline
+};
+
+// Limits the frame rate by sleeping until shortly before each frame's deadline
+// then spinning for the remainder
+class SklFramePacer
+{
+  //=================================================
+  // Variables
+  //=================================================
+private:
+  typedef std::chrono::steady_clock clock;
+
+  clock::duration targetFrameTime = clock::duration::zero();
+  clock::time_point nextDeadline;
+  clock::time_point lastFrame;
+  bool started = false;
+
+  // Sleep overshoot estimation (nanoseconds)
+  double oversleepMean = 0.0;
+  double oversleepDeviation = 0.0;
+  double spinMargin;
+
+  // Statistics
+  uint64_t frameCount = 0;
+  double intervalSum = 0.0;
+  double intervalSquaredSum = 0.0;
+  double maxError = 0.0;
+  double oversleepSum = 0.0;
+  uint64_t sleepCount = 0;
+
+  // Platform timer handle, unused where the OS sleeps with an absolute deadline
+  void* waitableTimer = nullptr;
+
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  SklFramePacer();
+  ~SklFramePacer();
+
+  // Sets the target frame rate, 0 removes the cap
+  void SetTargetFps(float _fps);
+  // Sets the target time between frames in seconds, 0 removes the cap
+  void SetTargetFrameTime(double _seconds);
+  // Retrieves the target time between frames in seconds
+  double GetTargetFrameTime() const;
+
+  // Blocks until the next frame's deadline
+  void Wait();
+  // Restarts deadlines from the current time, used after long stalls like loading
+  void Reset();
+
+  // Retrieves pacing statistics
+  sklFramePacerStats_t GetStats() const;
+  // Clears accumulated statistics
+  void ResetStats();
+
+private:
+  // Sleeps with the OS until roughly the given time
+  void SleepUntil(clock::time_point _wakeTime);
+  // Updates the spin margin with the measured oversleep of a single sleep
+  void RecordOversleep(double _oversleepNs);
+
+}; // class SklFramePacer
+
+#endif // !SKELETON_CORE_FRAME_PACER_H
@@ -0,0 +1,273 @@
+
+#include "pch.h"
+#include "skeleton/core/logger.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+
+// One queued message
+// sequence tracks the slot's state: equal to its position when free, position + 1 when full
+struct sklLogRecord_t
+{
+  std::atomic<uint64_t> sequence;
+  const sklLogSite_t* site;
+  sklLogFormatFunction format;
+  uint8_t payload[SKL_LOG_PAYLOAD_SIZE];
+};
+
+namespace
+{
+  // Appends printf style output to a string, truncated to 1KB
+  void AppendFormattedList(std::string& _output, const char* _format, va_list _args)
+  {
+    char buffer[1024];
+    int length = vsnprintf(buffer, sizeof(buffer), _format, _args);
+    if (length > 0)
+    {
+      _output.append(buffer, std::min<size_t>(length, sizeof(buffer) - 1));
+    }
+  }
+
+  void AppendPrefix(std::string& _output, const char* _format, ...)
+  {
+    va_list args;
+    va_start(args, _format);
+    AppendFormattedList(_output, _format, args);
+    va_end(args);
+  }
+
+  // The queue and its writer thread
+  // Any thread may produce, only the writer consumes
+  struct sklLogWriter_t
+  {
+    std::unique_ptr<sklLogRecord_t[]> records;
+    alignas(64) std::atomic<uint64_t> tail { 0 };   // Next position to be claimed by producers
+    alignas(64) std::atomic<uint64_t> head { 0 };   // Next position to be written
+    std::atomic<uint64_t> droppedCount { 0 };
+    std::atomic<int> minimumLevel { SKL_LOG_LEVEL };
+
+    std::mutex filterLock;
+    std::unordered_map<std::string, bool> categoryFilters;
+
+    std::mutex signalLock;
+    std::condition_variable writerSignal;   // Wakes the writer early to flush or shut down
+    std::condition_variable flushedSignal;  // Signalled after the writer catches up
+    bool shuttingDown = false;
+    std::thread thread;
+
+    sklLogWriter_t() : records(new sklLogRecord_t[SKL_LOG_QUEUE_SIZE])
+    {
+      for (uint64_t i = 0; i < SKL_LOG_QUEUE_SIZE; i++)
+      {
+        records[i].sequence.store(i, std::memory_order_relaxed);
+      }
+      thread = std::thread(&sklLogWriter_t::Run, this);
+    }
+
+    ~sklLogWriter_t()
+    {
+      {
+        std::lock_guard<std::mutex> guard(signalLock);
+        shuttingDown = true;
+      }
+      writerSignal.notify_one();
+      thread.join();
+    }
+
+    // Writes queued records until shutdown, then drains the queue
+    void Run()
+    {
+      std::string line;
+      while (true)
+      {
+        bool wroteAny = false;
+        while (WriteNext(line))
+        {
+          wroteAny = true;
+        }
+
+        uint64_t dropped = droppedCount.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0)
+        {
+          fprintf(stdout, ":-skl-: %-15s :--: %llu messages dropped, the queue was full\n",
+                  "Logger", (unsigned long long)dropped);
+          wroteAny = true;
+        }
+
+        if (wroteAny)
+        {
+          fflush(stdout);
+        }
+
+        std::unique_lock<std::mutex> guard(signalLock);
+        flushedSignal.notify_all();
+        if (shuttingDown && head.load(std::memory_order_relaxed) ==
+                                tail.load(std::memory_order_acquire))
+        {
+          return;
+        }
+
+        // Producers never signal, polling keeps logging free of system calls
+        writerSignal.wait_for(guard, std::chrono::milliseconds(5));
+      }
+    }
+
+    // Formats and writes the oldest record, returns false if none is ready
+    bool WriteNext(std::string& _line)
+    {
+      uint64_t position = head.load(std::memory_order_relaxed);
+      sklLogRecord_t& record = records[position & (SKL_LOG_QUEUE_SIZE - 1)];
+      if (record.sequence.load(std::memory_order_acquire) != position + 1)
+      {
+        return false;
+      }
+
+      const sklLogSite_t& site = *record.site;
+      _line.clear();
+      if (site.style != Skl_Log_Style_Slim)
+      {
+        AppendPrefix(_line, ":-skl-: %-15s :--: ", site.category);
+      }
+      record.format(site, record.payload, _line);
+      _line.push_back('\n');
+      if (site.style == Skl_Log_Style_Located)
+      {
+        AppendPrefix(_line, "\t%s :--: %u\n", site.file, site.line);
+      }
+      fwrite(_line.data(), 1, _line.size(), stdout);
+
+      // Free the slot for the producer that will wrap around to it
+      record.sequence.store(position + SKL_LOG_QUEUE_SIZE, std::memory_order_release);
+      head.store(position + 1, std::memory_order_release);
+      return true;
+    }
+  };
+
+  sklLogWriter_t& GetWriter()
+  {
+    static sklLogWriter_t writer;
+    return writer;
+  }
+}
+
+std::atomic<uint32_t> SklLogger::filterGeneration(1);
+
+void SklLogger::Flush()
+{
+  sklLogWriter_t& writer = GetWriter();
+  uint64_t target = writer.tail.load(std::memory_order_acquire);
+
+  std::unique_lock<std::mutex> guard(writer.signalLock);
+  while (writer.head.load(std::memory_order_acquire) < target)
+  {
+    writer.writerSignal.notify_one();
+    writer.flushedSignal.wait_for(guard, std::chrono::milliseconds(1));
+  }
+}
+
+//=================================================
+// Runtime filters
+//=================================================
+
+void SklLogger::SetLevel(int _level)
+{
+  GetWriter().minimumLevel.store(_level, std::memory_order_relaxed);
+  filterGeneration.fetch_add(1, std::memory_order_release);
+}
+
+void SklLogger::SetCategoryEnabled(const char* _category, bool _enabled)
+{
+  sklLogWriter_t& writer = GetWriter();
+  {
+    std::lock_guard<std::mutex> guard(writer.filterLock);
+    writer.categoryFilters[_category] = _enabled;
+  }
+  filterGeneration.fetch_add(1, std::memory_order_release);
+}
+
+uint64_t SklLogger::GetDroppedCount()
+{
+  return GetWriter().droppedCount.load(std::memory_order_relaxed);
+}
+
+void SklLogger::RefreshSite(sklLogSite_t& _site, uint32_t _generation)
+{
+  sklLogWriter_t& writer = GetWriter();
+  bool enabled = _site.level >= writer.minimumLevel.load(std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> guard(writer.filterLock);
+    auto filter = writer.categoryFilters.find(_site.category);
+    if (filter != writer.categoryFilters.end())
+    {
+      enabled = enabled && filter->second;
+    }
+  }
+
+  _site.enabled.store(enabled, std::memory_order_relaxed);
+  _site.filterGeneration.store(_generation, std::memory_order_release);
+}
+
+//=================================================
+// Records
+//=================================================
+
+sklLogRecord_t* SklLogger::BeginRecord(const sklLogSite_t& _site, sklLogFormatFunction _format,
+                                       uint8_t*& _payload)
+{
+  sklLogWriter_t& writer = GetWriter();
+  uint64_t position = writer.tail.load(std::memory_order_relaxed);
+
+  while (true)
+  {
+    sklLogRecord_t& record = writer.records[position & (SKL_LOG_QUEUE_SIZE - 1)];
+    uint64_t sequence = record.sequence.load(std::memory_order_acquire);
+    int64_t difference = static_cast<int64_t>(sequence - position);
+
+    if (difference == 0)
+    {
+      if (writer.tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+      {
+        record.site = &_site;
+        record.format = _format;
+        _payload = record.payload;
+        return &record;
+      }
+    }
+    else if (difference < 0)
+    {
+      // Full, errors wait for the writer rather than being lost
+      if (_site.level < SKL_LOG_LEVEL_ERROR)
+      {
+        writer.droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      }
+      std::this_thread::yield();
+      position = writer.tail.load(std::memory_order_relaxed);
+    }
+    else
+    {
+      position = writer.tail.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void SklLogger::EndRecord(sklLogRecord_t* _record)
+{
+  uint64_t position = _record->sequence.load(std::memory_order_relaxed);
+  _record->sequence.store(position + 1, std::memory_order_release);
+}
+
+void SklLogger::AppendFormatted(std::string& _output, const char* _format, ...)
+{
+  va_list args;
+  va_start(args, _format);
+  AppendFormattedList(_output, _format, args);
+  va_end(args);
+}
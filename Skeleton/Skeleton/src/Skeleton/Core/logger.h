@@ -0,0 +1,239 @@
+
+#ifndef SKELETON_CORE_LOGGER_H
+#define SKELETON_CORE_LOGGER_H 1
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+// Message severities, messages below SKL_LOG_LEVEL are compiled out
+#define SKL_LOG_LEVEL_DEBUG 0
+#define SKL_LOG_LEVEL_INFO 1
+#define SKL_LOG_LEVEL_WARNING 2
+#define SKL_LOG_LEVEL_ERROR 3
+
+#ifndef SKL_LOG_LEVEL
+#ifdef _DEBUG
+#define SKL_LOG_LEVEL SKL_LOG_LEVEL_DEBUG
+#else
+#define SKL_LOG_LEVEL SKL_LOG_LEVEL_INFO
+#endif // _DEBUG
+#endif // !SKL_LOG_LEVEL
+
+// Bytes of arguments a single message can carry, longer strings are truncated to fit
+#define SKL_LOG_PAYLOAD_SIZE 224
+// Messages that can wait to be written, must be a power of two
+#define SKL_LOG_QUEUE_SIZE 4096
+
+// How a message is decorated when written
+typedef enum sklLogStyle
+{
+  Skl_Log_Style_Category,  // ":-skl-: category :--: message"
+  Skl_Log_Style_Slim,      // The message alone
+  Skl_Log_Style_Located    // Category, then the file and line on the next line
+}sklLogStyle;
+
+// The constant parts of a message, one exists for each logging statement
+struct sklLogSite_t
+{
+  int level;
+  sklLogStyle style;
+  const char* category;
+  const char* format;
+  const char* file;
+  uint32_t line;
+
+  // Result of the runtime filters, refreshed whenever they change
+  std::atomic<uint32_t> filterGeneration;
+  std::atomic<bool> enabled;
+
+  constexpr sklLogSite_t(int _level, sklLogStyle _style, const char* _category,
+                         const char* _format, const char* _file, uint32_t _line)
+      : level(_level), style(_style), category(_category), format(_format), file(_file),
+        line(_line), filterGeneration(0), enabled(false)
+  {}
+};
+
+struct sklLogRecord_t;
+
+// Formats a record's packed arguments with its site's format string
+typedef void(*sklLogFormatFunction)(const sklLogSite_t& _site, const uint8_t* _payload,
+                                    std::string& _output);
+
+// Queues messages as binary records and formats them on a background thread
+// Producers copy their arguments into a slot of a lock-free ring and return,
+//   the format string is only applied by the writer thread
+class SklLogger
+{
+  //=================================================
+  // Variables
+  //=================================================
+private:
+  // Incremented whenever a runtime filter changes
+  static std::atomic<uint32_t> filterGeneration;
+
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Whether messages from a site pass the runtime filters
+  static bool IsEnabled(sklLogSite_t& _site)
+  {
+    uint32_t generation = filterGeneration.load(std::memory_order_relaxed);
+    if (_site.filterGeneration.load(std::memory_order_acquire) != generation)
+    {
+      RefreshSite(_site, generation);
+    }
+    return _site.enabled.load(std::memory_order_relaxed);
+  }
+
+  // Queues a message, _args must be arithmetic, enums, pointers, or strings
+  template<typename... Args>
+  static void Write(const sklLogSite_t& _site, const Args&... _args)
+  {
+    static_assert(PackedSize<Args...>() <= SKL_LOG_PAYLOAD_SIZE,
+                  "Log message arguments do not fit in a record");
+
+    uint8_t* payload;
+    sklLogRecord_t* record =
+        BeginRecord(_site, &FormatRecord<typename std::decay<Args>::type...>, payload);
+    if (record == nullptr)
+      return;
+
+    // Space left after fixed size arguments is split evenly between strings
+    const size_t stringBudget = (SKL_LOG_PAYLOAD_SIZE - PackedSize<Args...>()) /
+                                std::max<size_t>(StringCount<Args...>(), 1);
+
+    uint8_t* cursor = payload;
+    int expander[] = { 0, (Pack(cursor, stringBudget, _args), 0)... };
+    (void)expander;
+    (void)stringBudget;
+
+    EndRecord(record);
+  }
+
+  // Blocks until every message queued so far has been written
+  static void Flush();
+
+  // Runtime filters
+  //=================================================
+
+  // Discards messages below _level, levels already compiled out cannot be restored
+  static void SetLevel(int _level);
+  // Enables or disables all messages of a category
+  static void SetCategoryEnabled(const char* _category, bool _enabled);
+  // Number of messages discarded because the queue was full
+  static uint64_t GetDroppedCount();
+
+private:
+  // Re-evaluates the runtime filters for a site
+  static void RefreshSite(sklLogSite_t& _site, uint32_t _generation);
+  // Claims a record for a message, returns nullptr if the message was dropped
+  static sklLogRecord_t* BeginRecord(const sklLogSite_t& _site, sklLogFormatFunction _format,
+                                     uint8_t*& _payload);
+  // Publishes a claimed record to the writer thread
+  static void EndRecord(sklLogRecord_t* _record);
+
+  // Argument packing
+  //=================================================
+
+  template<typename T>
+  using IsString = std::integral_constant<bool,
+      std::is_same<typename std::decay<T>::type, const char*>::value ||
+      std::is_same<typename std::decay<T>::type, char*>::value>;
+
+  // Bytes used by fixed size arguments and the length and terminator of each string
+  template<typename... Args>
+  static constexpr size_t PackedSize()
+  {
+    size_t sizes[] = { 0, (IsString<Args>::value ? sizeof(uint16_t) + 1
+                                                 : sizeof(typename std::decay<Args>::type))... };
+    size_t total = 0;
+    for (size_t s : sizes)
+    {
+      total += s;
+    }
+    return total;
+  }
+
+  template<typename... Args>
+  static constexpr size_t StringCount()
+  {
+    bool strings[] = { false, IsString<Args>::value... };
+    size_t count = 0;
+    for (bool s : strings)
+    {
+      count += s ? 1 : 0;
+    }
+    return count;
+  }
+
+  template<typename T>
+  static typename std::enable_if<!IsString<T>::value>::type
+  Pack(uint8_t*& _cursor, size_t _stringBudget, const T& _value)
+  {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+                  std::is_pointer<T>::value, "Log arguments must be trivial values or strings");
+    std::memcpy(_cursor, &_value, sizeof(T));
+    _cursor += sizeof(T);
+  }
+
+  // Copies the string itself, the caller's pointer may not outlive the call
+  template<typename T>
+  static typename std::enable_if<IsString<T>::value>::type
+  Pack(uint8_t*& _cursor, size_t _stringBudget, const T& _value)
+  {
+    const char* string = (_value != nullptr) ? static_cast<const char*>(_value) : "(null)";
+    size_t length = std::min(std::strlen(string), _stringBudget);
+
+    uint16_t stored = static_cast<uint16_t>(length);
+    std::memcpy(_cursor, &stored, sizeof(uint16_t));
+    std::memcpy(_cursor + sizeof(uint16_t), string, length);
+    _cursor[sizeof(uint16_t) + length] = '\0';
+    _cursor += sizeof(uint16_t) + length + 1;
+  }
+
+  template<typename T>
+  static typename std::enable_if<!IsString<T>::value, T>::type Unpack(const uint8_t*& _cursor)
+  {
+    T value;
+    std::memcpy(&value, _cursor, sizeof(T));
+    _cursor += sizeof(T);
+    return value;
+  }
+
+  template<typename T>
+  static typename std::enable_if<IsString<T>::value, const char*>::type
+  Unpack(const uint8_t*& _cursor)
+  {
+    uint16_t length;
+    std::memcpy(&length, _cursor, sizeof(uint16_t));
+    const char* string = reinterpret_cast<const char*>(_cursor + sizeof(uint16_t));
+    _cursor += sizeof(uint16_t) + length + 1;
+    return string;
+  }
+
+  // Instantiated once per argument list, run by the writer thread
+  template<typename... Args>
+  static void FormatRecord(const sklLogSite_t& _site, const uint8_t* _payload,
+                           std::string& _output)
+  {
+    // Braced initialization unpacks the arguments in order
+    const uint8_t* cursor = _payload;
+    std::tuple<decltype(Unpack<Args>(cursor))...> values { Unpack<Args>(cursor)... };
+    (void)cursor;
+
+    std::apply([&](auto... _values) { AppendFormatted(_output, _site.format, _values...); },
+               values);
+  }
+
+  // Appends printf style output to a string
+  static void AppendFormatted(std::string& _output, const char* _format, ...);
+
+}; // class SklLogger
+
+#endif // !SKELETON_CORE_LOGGER_H
@@ -0,0 +1,280 @@
+
+#include "pch.h"
+#include "skeleton/core/profiler.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <fstream>
+
+#include "skeleton/core/debug_tools.h"
+
+// Zones kept per thread, older zones are overwritten once a thread records more
+#define SKL_PROFILER_RING_SIZE 65536
+
+namespace
+{
+  // A single completed zone
+  struct sklProfileEvent_t
+  {
+    const char* name;
+    uint64_t startNs;
+    uint64_t endNs;
+  };
+
+  // One entry of a thread's ring, guarded by a sequence so readers can copy it while it's reused
+  // sequence holds the event's index + 1 once written, and 0 while the owner is writing it
+  struct sklProfileSlot_t
+  {
+    std::atomic<uint64_t> sequence { 0 };
+    std::atomic<const char*> name { nullptr };
+    std::atomic<uint64_t> startNs { 0 };
+    std::atomic<uint64_t> endNs { 0 };
+  };
+
+  // Zones recorded by one thread
+  // Only the owning thread writes, head is published after each event is written
+  struct sklProfileThreadBuffer_t
+  {
+    uint32_t id;
+    std::string name;
+    std::atomic<uint64_t> head { 0 };
+    std::unique_ptr<sklProfileSlot_t[]> events;
+  };
+
+  // A thread's zones copied out of its ring
+  struct sklProfileThreadCapture_t
+  {
+    uint32_t id;
+    std::string name;
+    std::vector<sklProfileEvent_t> events;
+  };
+
+  // Shared state, only touched when threads first record or when captures start and stop
+  struct sklProfilerRegistry_t
+  {
+    std::mutex lock;
+    std::vector<std::unique_ptr<sklProfileThreadBuffer_t>> threads;
+    std::vector<sklProfileEvent_t> gpuEvents;
+    uint64_t captureStartNs = 0;
+  };
+
+  sklProfilerRegistry_t& GetRegistry()
+  {
+    static sklProfilerRegistry_t registry;
+    return registry;
+  }
+
+  thread_local sklProfileThreadBuffer_t* threadBuffer = nullptr;
+  thread_local std::string pendingThreadName;
+
+  // Creates the calling thread's buffer the first time it records
+  sklProfileThreadBuffer_t* GetThreadBuffer()
+  {
+    if (threadBuffer == nullptr)
+    {
+      sklProfilerRegistry_t& registry = GetRegistry();
+      std::lock_guard<std::mutex> guard(registry.lock);
+
+      auto buffer = std::make_unique<sklProfileThreadBuffer_t>();
+      buffer->id = static_cast<uint32_t>(registry.threads.size()) + 1;
+      buffer->name = !pendingThreadName.empty() ? pendingThreadName
+                                                : "Thread " + std::to_string(buffer->id);
+      buffer->events.reset(new sklProfileSlot_t[SKL_PROFILER_RING_SIZE]);
+      threadBuffer = buffer.get();
+      registry.threads.push_back(std::move(buffer));
+    }
+    return threadBuffer;
+  }
+
+  // Copies the events still held in a thread's ring
+  // Slots the owner rewrites while they're being copied are discarded
+  void CopyThreadEvents(const sklProfileThreadBuffer_t& _thread, uint64_t _originNs,
+                        std::vector<sklProfileEvent_t>& _events)
+  {
+    uint64_t head = _thread.head.load(std::memory_order_acquire);
+    uint64_t begin = head > SKL_PROFILER_RING_SIZE ? head - SKL_PROFILER_RING_SIZE : 0;
+    _events.reserve(static_cast<size_t>(head - begin));
+
+    for (uint64_t i = begin; i < head; i++)
+    {
+      const sklProfileSlot_t& slot = _thread.events[i % SKL_PROFILER_RING_SIZE];
+      if (slot.sequence.load(std::memory_order_acquire) != i + 1)
+      {
+        continue;
+      }
+
+      sklProfileEvent_t event;
+      event.name = slot.name.load(std::memory_order_relaxed);
+      event.startNs = slot.startNs.load(std::memory_order_relaxed);
+      event.endNs = slot.endNs.load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == i + 1 && event.startNs >= _originNs)
+      {
+        _events.push_back(event);
+      }
+    }
+  }
+
+  // Writes a string as a JSON literal
+  void WriteJsonString(std::ofstream& _out, const char* _string)
+  {
+    _out << '"';
+    for (const char* c = _string; *c != '\0'; c++)
+    {
+      if (*c == '"' || *c == '\\')
+      {
+        _out << '\\';
+      }
+      _out << *c;
+    }
+    _out << '"';
+  }
+
+  // Writes a complete ("X") trace event, times are converted to microseconds
+  void WriteEvent(std::ofstream& _out, const sklProfileEvent_t& _event, uint32_t _tid,
+                  uint64_t _originNs, bool& _first)
+  {
+    _out << (_first ? "\n    " : ",\n    ");
+    _first = false;
+
+    _out << "{ \"ph\": \"X\", \"pid\": 1, \"tid\": " << _tid << ", \"name\": ";
+    WriteJsonString(_out, _event.name);
+    _out << ", \"ts\": " << (_event.startNs - _originNs) / 1000.0
+         << ", \"dur\": " << (_event.endNs - _event.startNs) / 1000.0 << " }";
+  }
+
+  // Writes a metadata event naming a track
+  void WriteThreadName(std::ofstream& _out, uint32_t _tid, const char* _name, bool& _first)
+  {
+    _out << (_first ? "\n    " : ",\n    ");
+    _first = false;
+
+    _out << "{ \"ph\": \"M\", \"pid\": 1, \"tid\": " << _tid
+         << ", \"name\": \"thread_name\", \"args\": { \"name\": ";
+    WriteJsonString(_out, _name);
+    _out << " } }";
+  }
+}
+
+std::atomic<bool> SklProfiler::capturing(false);
+
+void SklProfiler::StartCapture()
+{
+  sklProfilerRegistry_t& registry = GetRegistry();
+  {
+    std::lock_guard<std::mutex> guard(registry.lock);
+    registry.gpuEvents.clear();
+    registry.captureStartNs = Now();
+  }
+  capturing.store(true, std::memory_order_relaxed);
+}
+
+bool SklProfiler::StopCapture(const char* _path)
+{
+  capturing.store(false, std::memory_order_relaxed);
+
+  // Copy everything under the lock, the file is written once it's released
+  std::vector<sklProfileThreadCapture_t> threads;
+  std::vector<sklProfileEvent_t> gpuEvents;
+  uint64_t origin;
+  {
+    sklProfilerRegistry_t& registry = GetRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+
+    origin = registry.captureStartNs;
+    threads.resize(registry.threads.size());
+    for (size_t i = 0; i < registry.threads.size(); i++)
+    {
+      threads[i].id = registry.threads[i]->id;
+      threads[i].name = registry.threads[i]->name;
+      CopyThreadEvents(*registry.threads[i], origin, threads[i].events);
+    }
+
+    for (const auto& event : registry.gpuEvents)
+    {
+      if (event.startNs >= origin)
+      {
+        gpuEvents.push_back(event);
+      }
+    }
+  }
+
+  std::ofstream out(_path);
+  if (!out)
+  {
+    SKL_LOG(SKL_ERROR, "Failed to open profile capture \"%s\"", _path);
+    return false;
+  }
+  out.setf(std::ios::fixed);
+  out.precision(3);
+
+  bool first = true;
+  uint64_t eventCount = 0;
+
+  out << "{\n  \"displayTimeUnit\": \"ns\",\n  \"traceEvents\": [";
+
+  for (const auto& thread : threads)
+  {
+    WriteThreadName(out, thread.id, thread.name.c_str(), first);
+    for (const auto& event : thread.events)
+    {
+      WriteEvent(out, event, thread.id, origin, first);
+    }
+    eventCount += thread.events.size();
+  }
+
+  // GPU zones share a single track
+  const uint32_t gpuTid = 0;
+  WriteThreadName(out, gpuTid, "GPU", first);
+  for (const auto& event : gpuEvents)
+  {
+    WriteEvent(out, event, gpuTid, origin, first);
+  }
+  eventCount += gpuEvents.size();
+
+  out << "\n  ]\n}\n";
+
+  SKL_PRINT("Profiler", "Wrote %llu zones to \"%s\"", (unsigned long long)eventCount, _path);
+  return out.good();
+}
+
+void SklProfiler::SetThreadName(const char* _name)
+{
+  if (threadBuffer == nullptr)
+  {
+    pendingThreadName = _name;
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(GetRegistry().lock);
+  threadBuffer->name = _name;
+}
+
+void SklProfiler::RecordZone(const char* _name, uint64_t _startNs, uint64_t _endNs)
+{
+  sklProfileThreadBuffer_t* buffer = GetThreadBuffer();
+
+  uint64_t head = buffer->head.load(std::memory_order_relaxed);
+  sklProfileSlot_t& slot = buffer->events[head % SKL_PROFILER_RING_SIZE];
+
+  // Readers discard the slot until its sequence is published again
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(_name, std::memory_order_relaxed);
+  slot.startNs.store(_startNs, std::memory_order_relaxed);
+  slot.endNs.store(_endNs, std::memory_order_relaxed);
+  slot.sequence.store(head + 1, std::memory_order_release);
+
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void SklProfiler::RecordGpuZone(const char* _name, uint64_t _startNs, uint64_t _endNs)
+{
+  // GPU results arrive once per frame, a lock is cheap enough here
+  sklProfilerRegistry_t& registry = GetRegistry();
+  std::lock_guard<std::mutex> guard(registry.lock);
+  registry.gpuEvents.push_back({ _name, _startNs, _endNs });
+}
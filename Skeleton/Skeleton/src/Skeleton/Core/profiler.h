@@ -0,0 +1,90 @@
+
+#ifndef SKELETON_CORE_PROFILER_H
+#define SKELETON_CORE_PROFILER_H 1
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Zones cost a relaxed atomic load when no capture is running and two clock reads when one is
+// Define SKL_DISABLE_PROFILING to compile every zone out
+#ifndef SKL_DISABLE_PROFILING
+#define SKL_PROFILE_CONCAT_INNER(a, b) a##b
+#define SKL_PROFILE_CONCAT(a, b) SKL_PROFILE_CONCAT_INNER(a, b)
+// Times the enclosing scope, _name must be a string with static lifetime
+#define SKL_PROFILE_ZONE(_name) \
+  SklProfileZone SKL_PROFILE_CONCAT(sklProfileZone, __LINE__)(_name)
+// Times the enclosing function
+#define SKL_PROFILE_FUNCTION() SKL_PROFILE_ZONE(__FUNCTION__)
+#else
+#define SKL_PROFILE_ZONE(_name)
+#define SKL_PROFILE_FUNCTION()
+#endif // !SKL_DISABLE_PROFILING
+
+// Records timed zones from every thread and exports them as Chrome trace event JSON
+// Each thread writes into its own ring buffer without locking
+class SklProfiler
+{
+  //=================================================
+  // Variables
+  //=================================================
+private:
+  static std::atomic<bool> capturing;
+
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Nanoseconds on the profiler's clock, shared by every thread
+  static uint64_t Now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // Whether zones are currently being recorded
+  static bool IsCapturing() { return capturing.load(std::memory_order_relaxed); }
+
+  // Begins recording zones, discarding anything from previous captures
+  static void StartCapture();
+  // Stops recording and writes every zone from the capture to a .json file
+  // The result can be opened in Perfetto or chrome://tracing
+  static bool StopCapture(const char* _path);
+
+  // Names the calling thread's track in exported captures, the name is copied
+  static void SetThreadName(const char* _name);
+
+  // Records a finished zone on the calling thread, times are from Now()
+  static void RecordZone(const char* _name, uint64_t _startNs, uint64_t _endNs);
+  // Records a zone that ran on the GPU, times are from Now() after calibration
+  static void RecordGpuZone(const char* _name, uint64_t _startNs, uint64_t _endNs);
+
+}; // class SklProfiler
+
+// Records the lifetime of a scope as a zone while a capture is running
+class SklProfileZone
+{
+private:
+  const char* name;
+  uint64_t start;
+
+public:
+  SklProfileZone(const char* _name) : name(_name)
+  {
+    start = SklProfiler::IsCapturing() ? SklProfiler::Now() : 0;
+  }
+
+  ~SklProfileZone()
+  {
+    if (start != 0)
+    {
+      SklProfiler::RecordZone(name, start, SklProfiler::Now());
+    }
+  }
+
+  SklProfileZone(const SklProfileZone&) = delete;
+  SklProfileZone& operator=(const SklProfileZone&) = delete;
+
+}; // class SklProfileZone
+
+#endif // !SKELETON_CORE_PROFILER_H
@@ -0,0 +1,479 @@
+
+#include "pch.h"
+#include "skeleton/core/task_graph.h"
+
+#include <algorithm>
+#include <inttypes.h>
+#include <string>
+
+#include "skeleton/core/debug_tools.h"
+#include "skeleton/core/profiler.h"
+
+SklTaskGraph::SklTaskGraph(uint32_t _maxFramesInFlight, uint32_t _workerCount /*= 0*/)
+    : maxFramesInFlight(std::max(_maxFramesInFlight, 1u)),
+      creationTime(std::chrono::steady_clock::now())
+{
+  frames.resize(maxFramesInFlight * 2);
+  for (auto& f : frames)
+  {
+    f.frame = UINT64_MAX;
+  }
+
+  if (_workerCount == 0)
+  {
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    _workerCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+  }
+
+  for (uint32_t i = 0; i < _workerCount; i++)
+  {
+    workers.emplace_back(&SklTaskGraph::WorkerLoop, this, i);
+  }
+}
+
+SklTaskGraph::~SklTaskGraph()
+{
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    frameSignal.wait(guard, [&]()
+    {
+      return completedFrameCount == kickedFrameCount || taskException != nullptr;
+    });
+    shuttingDown = true;
+  }
+  workerSignal.notify_all();
+
+  for (auto& w : workers)
+  {
+    w.join();
+  }
+}
+
+//=================================================
+// Declaration
+//=================================================
+
+sklTaskResource SklTaskGraph::AddResource(const char* _name, uint32_t _versions /*= 1*/)
+{
+  resources.push_back({ _name, std::max(_versions, 1u) });
+  return static_cast<sklTaskResource>(resources.size() - 1);
+}
+
+sklTask SklTaskGraph::AddTask(const char* _name, const std::vector<sklTaskResource>& _reads,
+                              const std::vector<sklTaskResource>& _writes,
+                              sklTaskFunction _function, bool _mainThread /*= false*/)
+{
+  if (compiled)
+  {
+    SKL_LOG(SKL_ERROR, "Task \"%s\" added after the task graph was compiled", _name);
+    return -1;
+  }
+
+  sklTaskInfo_t task = {};
+  task.name = _name;
+  task.function = _function;
+  task.mainThread = _mainThread;
+  task.reads = _reads;
+  task.writes = _writes;
+  tasks.push_back(task);
+  return static_cast<sklTask>(tasks.size() - 1);
+}
+
+void SklTaskGraph::Compile()
+{
+  if (compiled)
+    return;
+
+  uint32_t taskCount = static_cast<uint32_t>(tasks.size());
+
+  // Returns the fewest number of versions among the resources the tasks conflict on
+  // Returns 0 if the tasks do not conflict
+  auto conflictVersions = [&](const sklTaskInfo_t& _a, const sklTaskInfo_t& _b)
+  {
+    uint32_t versions = 0;
+    auto consider = [&](const std::vector<sklTaskResource>& _x,
+                        const std::vector<sklTaskResource>& _y)
+    {
+      for (sklTaskResource rx : _x)
+      {
+        for (sklTaskResource ry : _y)
+        {
+          if (rx == ry && (versions == 0 || resources[rx].versions < versions))
+          {
+            versions = resources[rx].versions;
+          }
+        }
+      }
+    };
+
+    consider(_a.writes, _b.writes);
+    consider(_a.writes, _b.reads);
+    consider(_a.reads, _b.writes);
+    return versions;
+  };
+
+  for (uint32_t j = 0; j < taskCount; j++)
+  {
+    for (uint32_t i = 0; i < taskCount; i++)
+    {
+      uint32_t versions = conflictVersions(tasks[i], tasks[j]);
+
+      // Tasks of the same frame run in declaration order
+      if (i < j && versions != 0)
+      {
+        tasks[j].predecessors.push_back(i);
+        tasks[i].successors.push_back(j);
+      }
+
+      // A task never overlaps with itself, and must wait for whatever last touched
+      // the copy of a resource it is about to use
+      uint32_t lag = (i == j) ? 1 : versions;
+
+      // Lags beyond the in-flight limit are already guaranteed by Kick
+      if (lag != 0 && lag < maxFramesInFlight)
+      {
+        tasks[j].priorFrames.push_back({ i, lag });
+        tasks[i].laterFrames.push_back({ j, lag });
+      }
+    }
+  }
+
+  compiled = true;
+}
+
+//=================================================
+// Execution
+//=================================================
+
+void SklTaskGraph::Kick(uint64_t _frame)
+{
+  Compile();
+
+  std::unique_lock<std::mutex> guard(lock);
+  RethrowTaskException();
+
+  if (_frame != kickedFrameCount)
+  {
+    SKL_LOG(SKL_ERROR, "Frames must be kicked in order, expected %" PRIu64 " got %" PRIu64,
+            kickedFrameCount, _frame);
+    return;
+  }
+
+  // Limit the number of frames being worked on at once
+  frameSignal.wait(guard, [&]()
+  {
+    return _frame < maxFramesInFlight
+           || completedFrameCount > _frame - maxFramesInFlight
+           || taskException != nullptr;
+  });
+  RethrowTaskException();
+
+  sklTaskFrame_t& frame = frames[_frame % frames.size()];
+  frame.frame = _frame;
+  frame.kickNs = Now();
+  frame.remainingTasks = static_cast<uint32_t>(tasks.size());
+  frame.remainingMainTasks = 0;
+  frame.instances.assign(tasks.size(), {});
+  kickedFrameCount = _frame + 1;
+
+  for (uint32_t i = 0; i < tasks.size(); i++)
+  {
+    sklTaskInstance_t& instance = frame.instances[i];
+    instance.pendingCount = static_cast<uint32_t>(tasks[i].predecessors.size());
+
+    for (const auto& edge : tasks[i].priorFrames)
+    {
+      if (edge.frameLag <= _frame && !IsTaskComplete(edge.task, _frame - edge.frameLag))
+      {
+        instance.pendingCount++;
+      }
+    }
+
+    if (tasks[i].mainThread)
+    {
+      frame.remainingMainTasks++;
+    }
+  }
+
+  for (uint32_t i = 0; i < tasks.size(); i++)
+  {
+    if (frame.instances[i].pendingCount == 0)
+    {
+      EnqueueTask(i, _frame);
+    }
+  }
+}
+
+void SklTaskGraph::RunMainThreadTasks(uint64_t _frame)
+{
+  std::unique_lock<std::mutex> guard(lock);
+
+  while (true)
+  {
+    RethrowTaskException();
+
+    sklTaskFrame_t& frame = frames[_frame % frames.size()];
+    if (frame.frame != _frame || frame.remainingMainTasks == 0)
+    {
+      return;
+    }
+
+    mainSignal.wait(guard, [&]() { return !mainQueue.empty() || taskException != nullptr; });
+    if (mainQueue.empty())
+    {
+      continue;
+    }
+
+    std::pair<sklTask, uint64_t> next = mainQueue.front();
+    mainQueue.pop_front();
+
+    guard.unlock();
+    ExecuteTask(next.first, next.second);
+    guard.lock();
+  }
+}
+
+void SklTaskGraph::WaitIdle()
+{
+  std::unique_lock<std::mutex> guard(lock);
+  frameSignal.wait(guard, [&]()
+  {
+    return completedFrameCount == kickedFrameCount || taskException != nullptr;
+  });
+  RethrowTaskException();
+}
+
+void SklTaskGraph::WorkerLoop(uint32_t _index)
+{
+  SklProfiler::SetThreadName(("Worker " + std::to_string(_index)).c_str());
+
+  std::unique_lock<std::mutex> guard(lock);
+
+  while (true)
+  {
+    workerSignal.wait(guard, [&]() { return shuttingDown || !workerQueue.empty(); });
+    if (shuttingDown)
+    {
+      return;
+    }
+
+    std::pair<sklTask, uint64_t> next = workerQueue.front();
+    workerQueue.pop_front();
+
+    guard.unlock();
+    ExecuteTask(next.first, next.second);
+    guard.lock();
+  }
+}
+
+void SklTaskGraph::ExecuteTask(sklTask _task, uint64_t _frame)
+{
+  uint64_t start = Now();
+  std::exception_ptr exception = nullptr;
+  try
+  {
+    SklProfileZone zone(tasks[_task].name);
+    tasks[_task].function(_frame);
+  }
+  catch (...)
+  {
+    exception = std::current_exception();
+  }
+  uint64_t end = Now();
+
+  std::lock_guard<std::mutex> guard(lock);
+  if (exception != nullptr && taskException == nullptr)
+  {
+    taskException = exception;
+    mainSignal.notify_all();
+    frameSignal.notify_all();
+  }
+
+  sklTaskInstance_t& instance = frames[_frame % frames.size()].instances[_task];
+  instance.startNs = start;
+  instance.endNs = end;
+  CompleteTask(_task, _frame);
+}
+
+void SklTaskGraph::CompleteTask(sklTask _task, uint64_t _frame)
+{
+  sklTaskFrame_t& frame = frames[_frame % frames.size()];
+  frame.instances[_task].complete = true;
+
+  // Release tasks of the same frame
+  for (sklTask s : tasks[_task].successors)
+  {
+    if (--frame.instances[s].pendingCount == 0)
+    {
+      EnqueueTask(s, _frame);
+    }
+  }
+
+  // Release tasks of frames that have already been kicked
+  for (const auto& edge : tasks[_task].laterFrames)
+  {
+    uint64_t laterFrame = _frame + edge.frameLag;
+    sklTaskFrame_t& later = frames[laterFrame % frames.size()];
+    if (laterFrame < kickedFrameCount && later.frame == laterFrame)
+    {
+      if (--later.instances[edge.task].pendingCount == 0)
+      {
+        EnqueueTask(edge.task, laterFrame);
+      }
+    }
+  }
+
+  if (tasks[_task].mainThread)
+  {
+    frame.remainingMainTasks--;
+  }
+
+  // Tasks never overlap with their previous frame, so frames always finish in order
+  if (--frame.remainingTasks == 0)
+  {
+    BuildCriticalPath(_frame);
+    completedFrameCount = _frame + 1;
+    frameSignal.notify_all();
+  }
+}
+
+void SklTaskGraph::EnqueueTask(sklTask _task, uint64_t _frame)
+{
+  if (tasks[_task].mainThread)
+  {
+    mainQueue.push_back({ _task, _frame });
+    mainSignal.notify_one();
+  }
+  else
+  {
+    workerQueue.push_back({ _task, _frame });
+    workerSignal.notify_one();
+  }
+}
+
+bool SklTaskGraph::IsTaskComplete(sklTask _task, uint64_t _frame)
+{
+  const sklTaskFrame_t& frame = frames[_frame % frames.size()];
+  // A frame whose slot has been reused finished long ago
+  return frame.frame != _frame || frame.instances[_task].complete;
+}
+
+void SklTaskGraph::RethrowTaskException()
+{
+  if (taskException != nullptr)
+  {
+    std::rethrow_exception(taskException);
+  }
+}
+
+//=================================================
+// Analysis
+//=================================================
+
+void SklTaskGraph::BuildCriticalPath(uint64_t _frame)
+{
+  const sklTaskFrame_t& frame = frames[_frame % frames.size()];
+
+  // Start from the task that finished last
+  sklTask current = 0;
+  for (uint32_t i = 1; i < frame.instances.size(); i++)
+  {
+    if (frame.instances[i].endNs > frame.instances[current].endNs)
+    {
+      current = i;
+    }
+  }
+
+  criticalPath.clear();
+  criticalPathFrameNs = frame.instances.empty() ? 0 : frame.instances[current].endNs -
+                                                      frame.kickNs;
+  if (frame.instances.empty())
+    return;
+
+  while (true)
+  {
+    const sklTaskInstance_t& instance = frame.instances[current];
+
+    // Find the dependency that finished last, it is what this task was waiting on
+    bool found = false;
+    sklTask binding = 0;
+    uint64_t bindingFrame = _frame;
+    uint64_t bindingEnd = 0;
+
+    for (sklTask p : tasks[current].predecessors)
+    {
+      if (!found || frame.instances[p].endNs > bindingEnd)
+      {
+        found = true;
+        binding = p;
+        bindingEnd = frame.instances[p].endNs;
+      }
+    }
+    for (const auto& edge : tasks[current].priorFrames)
+    {
+      if (edge.frameLag > _frame)
+        continue;
+
+      const sklTaskFrame_t& prior = frames[(_frame - edge.frameLag) % frames.size()];
+      if (prior.frame == _frame - edge.frameLag
+          && prior.instances[edge.task].endNs > frame.kickNs
+          && (!found || prior.instances[edge.task].endNs > bindingEnd))
+      {
+        found = true;
+        binding = edge.task;
+        bindingFrame = prior.frame;
+        bindingEnd = prior.instances[edge.task].endNs;
+      }
+    }
+
+    uint64_t readyNs = std::max(found ? bindingEnd : 0, frame.kickNs);
+    criticalPath.push_back({ tasks[current].name, _frame, instance.startNs, instance.endNs,
+                             instance.startNs > readyNs ? instance.startNs - readyNs : 0 });
+
+    if (!found)
+      break;
+
+    if (bindingFrame != _frame)
+    {
+      // The frame was held back by a previous frame, note what it waited on and stop
+      const sklTaskInstance_t& prior =
+          frames[bindingFrame % frames.size()].instances[binding];
+      criticalPath.push_back({ tasks[binding].name, bindingFrame, prior.startNs, prior.endNs,
+                               0 });
+      break;
+    }
+
+    current = binding;
+  }
+
+  std::reverse(criticalPath.begin(), criticalPath.end());
+}
+
+std::vector<sklTaskPathNode_t> SklTaskGraph::GetCriticalPath()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  return criticalPath;
+}
+
+void SklTaskGraph::PrintCriticalPath()
+{
+  std::vector<sklTaskPathNode_t> path;
+  uint64_t frameNs;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    path = criticalPath;
+    frameNs = criticalPathFrameNs;
+  }
+
+  if (path.empty())
+    return;
+
+  SKL_PRINT("Task Graph", "Frame %" PRIu64 " critical path :--: %.3f ms",
+            path.back().frame, frameNs / 1000000.0);
+  for (const auto& node : path)
+  {
+    SKL_PRINT_SLIM("\t%-16s frame %6" PRIu64 " :--: %8.3f ms run :--: %8.3f ms wait",
+                   node.name, node.frame, (node.endNs - node.startNs) / 1000000.0,
+                   node.waitNs / 1000000.0);
+  }
+}
@@ -0,0 +1,184 @@
+
+#ifndef SKELETON_CORE_TASK_GRAPH_H
+#define SKELETON_CORE_TASK_GRAPH_H 1
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <chrono>
+
+// Handle to a resource declared in a SklTaskGraph
+typedef uint32_t sklTaskResource;
+// Handle to a task declared in a SklTaskGraph
+typedef uint32_t sklTask;
+
+// Work executed once per frame by a task, receives the index of the frame being processed
+typedef std::function<void(uint64_t _frame)> sklTaskFunction;
+
+// One step along a frame's critical path
+struct sklTaskPathNode_t
+{
+  const char* name;  // The task's name
+  uint64_t frame;    // The frame the task ran for
+  uint64_t startNs;  // When the task began running (nanoseconds since the graph's creation)
+  uint64_t endNs;    // When the task finished running
+  uint64_t waitNs;   // Time between the task's last dependency finishing and it starting
+};
+
+// Schedules a fixed set of tasks every frame based on the resources they read and write
+// Tasks of consecutive frames overlap wherever their resource accesses allow it
+class SklTaskGraph
+{
+  //=================================================
+  // Variables
+  //=================================================
+private:
+  // A piece of state shared between tasks
+  struct sklTaskResourceInfo_t
+  {
+    const char* name;
+    uint32_t versions;  // Number of copies cycled through by consecutive frames
+  };
+
+  // A dependency on a task of another frame
+  struct sklTaskFrameEdge_t
+  {
+    sklTask task;
+    uint32_t frameLag;  // How many frames apart the two tasks are
+  };
+
+  // A unit of work and its dependencies
+  struct sklTaskInfo_t
+  {
+    const char* name;
+    sklTaskFunction function;
+    bool mainThread;
+    std::vector<sklTaskResource> reads;
+    std::vector<sklTaskResource> writes;
+
+    std::vector<sklTask> predecessors;             // Tasks of the same frame that must finish first
+    std::vector<sklTask> successors;               // Tasks of the same frame waiting on this
+    std::vector<sklTaskFrameEdge_t> priorFrames;   // Tasks of earlier frames that must finish first
+    std::vector<sklTaskFrameEdge_t> laterFrames;   // Tasks of later frames waiting on this
+  };
+
+  // The state of one task within one frame
+  struct sklTaskInstance_t
+  {
+    uint32_t pendingCount;
+    bool complete;
+    uint64_t startNs;
+    uint64_t endNs;
+  };
+
+  // The state of all tasks within one frame
+  struct sklTaskFrame_t
+  {
+    uint64_t frame;
+    uint64_t kickNs;
+    uint32_t remainingTasks;
+    uint32_t remainingMainTasks;
+    std::vector<sklTaskInstance_t> instances;
+  };
+
+  std::vector<sklTaskResourceInfo_t> resources;
+  std::vector<sklTaskInfo_t> tasks;
+  bool compiled = false;
+
+  uint32_t maxFramesInFlight;
+  std::vector<sklTaskFrame_t> frames;  // Ring of frame states, twice maxFramesInFlight long
+  uint64_t kickedFrameCount = 0;
+  uint64_t completedFrameCount = 0;
+
+  std::vector<std::thread> workers;
+  std::deque<std::pair<sklTask, uint64_t>> workerQueue;
+  std::deque<std::pair<sklTask, uint64_t>> mainQueue;
+  std::mutex lock;
+  std::condition_variable workerSignal;
+  std::condition_variable mainSignal;
+  std::condition_variable frameSignal;
+  bool shuttingDown = false;
+  std::exception_ptr taskException;
+
+  std::chrono::steady_clock::time_point creationTime;
+  std::vector<sklTaskPathNode_t> criticalPath;  // Critical path of the last completed frame
+  uint64_t criticalPathFrameNs = 0;              // Kick-to-finish time of the last completed frame
+
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Starts the worker threads
+  // _maxFramesInFlight limits how many frames may be processed at once
+  SklTaskGraph(uint32_t _maxFramesInFlight, uint32_t _workerCount = 0);
+  // Waits for all kicked frames and stops the worker threads
+  ~SklTaskGraph();
+
+  // Declaration
+  //=================================================
+
+  // Declares a piece of state tasks may access
+  // A resource with multiple versions lets consecutive frames use separate copies of it
+  sklTaskResource AddResource(const char* _name, uint32_t _versions = 1);
+  // Declares a unit of work run once per frame
+  // Tasks that touch the same resources run in the order they were added
+  sklTask AddTask(const char* _name, const std::vector<sklTaskResource>& _reads,
+                  const std::vector<sklTaskResource>& _writes, sklTaskFunction _function,
+                  bool _mainThread = false);
+  // Builds the dependencies between tasks, called automatically by the first Kick
+  void Compile();
+
+  // Execution
+  //=================================================
+
+  // Schedules every task for a frame
+  // Blocks until the frame _maxFramesInFlight before this one has finished
+  void Kick(uint64_t _frame);
+  // Runs the main-thread tasks of a kicked frame on the calling thread
+  void RunMainThreadTasks(uint64_t _frame);
+  // Blocks until every kicked frame has finished
+  void WaitIdle();
+
+  // Retrieves which copy of a resource a frame should use
+  uint32_t GetVersion(sklTaskResource _resource, uint64_t _frame) const
+  {
+    return static_cast<uint32_t>(_frame % resources[_resource].versions);
+  }
+
+  // Analysis
+  //=================================================
+
+  // Retrieves the chain of tasks that bound the last completed frame's duration
+  std::vector<sklTaskPathNode_t> GetCriticalPath();
+  // Prints the last completed frame's critical path
+  void PrintCriticalPath();
+
+private:
+  // Pulls tasks from the worker queue until shutdown
+  void WorkerLoop(uint32_t _index);
+  // Runs a task's function and records its timing
+  void ExecuteTask(sklTask _task, uint64_t _frame);
+  // Marks a task as complete and releases any tasks waiting on it, lock must be held
+  void CompleteTask(sklTask _task, uint64_t _frame);
+  // Places a ready task into the correct queue, lock must be held
+  void EnqueueTask(sklTask _task, uint64_t _frame);
+  // Determines whether a task of a given frame has finished, lock must be held
+  bool IsTaskComplete(sklTask _task, uint64_t _frame);
+  // Walks back from a frame's last task to find its critical path, lock must be held
+  void BuildCriticalPath(uint64_t _frame);
+  // Rethrows an exception raised by a task, lock must be held
+  void RethrowTaskException();
+  // Nanoseconds since the graph's creation
+  uint64_t Now() const
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - creationTime).count();
+  }
+
+}; // class SklTaskGraph
+
+#endif // !SKELETON_CORE_TASK_GRAPH_H
@@ -5,6 +5,7 @@
 #include <set>
 #include <string>
 #include <chrono>
+#include <algorithm>
 
 #include "stb/stb_image.h"
 
@@ -15,28 +16,103 @@
 #include "skeleton/core/vertex.h"
 #include "skeleton/renderer/shader_program.h"
 #include "skeleton/core/mesh.h"
-
-Renderer::Renderer(const std::vector<const char*>& _extraExtensions, SDL_Window* _window)
+#include "skeleton/core/profiler.h"
+#include "skeleton/renderer/pipeline_cache.h"
+#include "skeleton/renderer/shader_hot_reload.h"
+#include "skeleton/renderer/pipeline_builder.h"
+#include "skeleton/renderer/descriptor_cache.h"
+#include "skeleton/renderer/bindless.h"
+
+Renderer::Renderer(const std::vector<const char*>& _extraExtensions, SDL_Window* _window,
+                   VkExtent2D _headlessExtent /*= { 0, 0 }*/)
 {
-  backend = new SklRenderBackend(_window, _extraExtensions);
+  backend = new SklRenderBackend(_window, _extraExtensions, _headlessExtent);
   bufferManager = backend->bufferManager;
 }
 
 Renderer::~Renderer()
 {
+  vkDeviceWaitIdle(vulkanContext.device);
+  delete(gpuProfiler);
+  // Builds still queued or compiling use the pipeline cache, finish them before it's destroyed
+  SklShaderHotReload::Shutdown();
+  SklPipelineBuilder::Shutdown();
+  SklPipelineCache::Shutdown();
   delete(bufferManager);
   delete(backend);
 }
 
-void Renderer::RenderFrame()
+void Renderer::RenderFrame(std::chrono::steady_clock::time_point _inputTime /*= {}*/)
+{
+  SKL_PROFILE_FUNCTION();
+
+  // Reloaded shaders and rebuilt pipelines only change between frames
+  SklShaderHotReload::ApplyPending();
+
+  SubmitFrame(_inputTime);
+
+  {
+    std::lock_guard<std::mutex> guard(renderedFrameLock);
+    renderedFrameCount++;
+  }
+  renderedFrameSignal.notify_all();
+}
+
+void Renderer::BeginFrame()
+{
+  SKL_PROFILE_FUNCTION();
+
+  // Changing the frame count changes which frame slot is used next
+  if (presentPolicyPending.exchange(false))
+  {
+    ApplyPresentPolicy();
+  }
+
+  uint32_t frame = backend->currentFrame;
+  vkWaitForFences(vulkanContext.device, 1, &backend->flightFences[frame], VK_TRUE, UINT64_MAX);
+
+  // The frame's previous submission has finished, so nothing still uses its transient sets
+  backend->frameDescriptorAllocators[frame]->Reset();
+  for (sklRenderable_t& renderable : vulkanContext.renderables)
+  {
+    renderable.frameDescriptorSet = VK_NULL_HANDLE;
+  }
+  frameBegun = true;
+}
+
+void Renderer::SubmitFrame(std::chrono::steady_clock::time_point _inputTime)
 {
-  vkWaitForFences(vulkanContext.device, 1, &backend->flightFences[backend->currentFrame],
-                  VK_TRUE, UINT64_MAX);
+  if (!frameBegun)
+  {
+    BeginFrame();
+  }
+  frameBegun = false;
+  backend->ProcessDeletions();
 
-  uint32_t imageIndex;
-  vkAcquireNextImageKHR(vulkanContext.device, backend->swapchain, UINT64_MAX, 
-                        backend->imageAvailableSemaphores[backend->currentFrame], VK_NULL_HANDLE,
-                        &imageIndex);
+  // Resizes are handled between frames, nothing is drawn while the window has no area
+  if (resizePending && !RecreateSwapchain())
+    return;
+
+  // Offscreen images are used in order, there is nothing to acquire from
+  uint32_t imageIndex = backend->currentFrame;
+  if (!backend->headless)
+  {
+    VkResult result = vkAcquireNextImageKHR(
+        vulkanContext.device, backend->swapchain, UINT64_MAX,
+        backend->imageAvailableSemaphores[backend->currentFrame], VK_NULL_HANDLE, &imageIndex);
+
+    // An out of date swapchain cannot be presented to, skip this frame and recreate it
+    if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+      resizePending = true;
+      return;
+    }
+    // A suboptimal swapchain can still be presented to, finish the frame first
+    if (result == VK_SUBOPTIMAL_KHR)
+    {
+      resizePending = true;
+    }
+  }
 
   if (backend->imageIsInFlightFences[imageIndex] != VK_NULL_HANDLE)
   {
@@ -45,16 +121,27 @@ void Renderer::RenderFrame()
   }
   backend->imageIsInFlightFences[imageIndex] = backend->flightFences[backend->currentFrame];
 
+  // The frame's previous submission has finished, its queries are ready
+  uint32_t frame = backend->currentFrame;
+  if (gpuProfiler->Collect(frame))
+  {
+    gpuFrameTime = gpuProfiler->GetScopeTime("Frame");
+  }
+
+  // Nothing recorded from the frame's pool is still in use, so it can be reset in bulk
+  vkResetCommandPool(vulkanContext.device, backend->frameCommandPools[frame], 0);
+  RecordCommandBuffer(frame, imageIndex);
+
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
   VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-  submitInfo.waitSemaphoreCount = 1;
+  submitInfo.waitSemaphoreCount = backend->headless ? 0 : 1;
   submitInfo.pWaitSemaphores = &backend->imageAvailableSemaphores[backend->currentFrame];
   submitInfo.pWaitDstStageMask = waitStages;
   submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &backend->commandBuffers[imageIndex];
-  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pCommandBuffers = &backend->commandBuffers[frame];
+  submitInfo.signalSemaphoreCount = backend->headless ? 0 : 1;
   submitInfo.pSignalSemaphores = &backend->renderCompleteSemaphores[backend->currentFrame];
 
   vkResetFences(vulkanContext.device, 1, &backend->flightFences[backend->currentFrame]);
@@ -63,6 +150,23 @@ void Renderer::RenderFrame()
       vkQueueSubmit(vulkanContext.graphicsQueue, 1, &submitInfo,
                     backend->flightFences[backend->currentFrame]),
       "Failed to submit draw command");
+  lastImageIndex = imageIndex;
+  lastSubmittedFence = backend->flightFences[backend->currentFrame];
+  gpuProfiler->MarkSubmitted(frame);
+  backend->submittedFrameCount++;
+
+  uint32_t framesInFlight = backend->presentPolicy.framesInFlight;
+  bool measureLatency = _inputTime != std::chrono::steady_clock::time_point();
+  if (backend->headless)
+  {
+    if (measureLatency)
+    {
+      inputLatency = std::chrono::duration<float, std::milli>(
+          std::chrono::steady_clock::now() - _inputTime).count();
+    }
+    backend->currentFrame = (backend->currentFrame + 1) % framesInFlight;
+    return;
+  }
 
   VkPresentInfoKHR presentInfo = {};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -72,102 +176,204 @@ void Renderer::RenderFrame()
   presentInfo.pSwapchains = &backend->swapchain;
   presentInfo.pImageIndices = &imageIndex;
 
-  vkQueuePresentKHR(vulkanContext.presentQueue, &presentInfo);
+  VkResult result = vkQueuePresentKHR(vulkanContext.presentQueue, &presentInfo);
+  if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+  {
+    resizePending = true;
+  }
+
+  // FIFO modes may block in the present call, so this includes any wait for a free image
+  if (measureLatency)
+  {
+    inputLatency = std::chrono::duration<float, std::milli>(
+        std::chrono::steady_clock::now() - _inputTime).count();
+  }
 
-  backend->currentFrame = (backend->currentFrame + 1) % MAX_FLIGHT_IMAGE_COUNT;
+  backend->currentFrame = (backend->currentFrame + 1) % framesInFlight;
 }
 
-void Renderer::CreateDescriptorSet(shaderProgram_t& _prog, sklRenderable_t& _renderable)
+void Renderer::SetPresentPolicy(const sklPresentPolicy_t& _policy)
 {
-  VkDescriptorSetAllocateInfo allocInfo = {};
-  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  allocInfo.descriptorPool = backend->descriptorPool;
-  allocInfo.descriptorSetCount = 1;
-  allocInfo.pSetLayouts = &_prog.descriptorSetLayout;
+  std::lock_guard<std::mutex> guard(presentPolicyLock);
+  requestedPresentPolicy = _policy;
+  presentPolicyPending = true;
+}
 
-  SKL_ASSERT_VK(
-      vkAllocateDescriptorSets(vulkanContext.device, &allocInfo, &_prog.descriptorSet),
-      "Failed to allocate descriptor set");
+sklPresentPolicy_t Renderer::GetPresentPolicy()
+{
+  std::lock_guard<std::mutex> guard(presentPolicyLock);
+  return requestedPresentPolicy;
+}
 
-  uint32_t bufferidx = 0, imageidx = 0;
-  std::vector<VkDescriptorBufferInfo> bufferInfos;
-  std::vector<VkDescriptorImageInfo> imageInfos;
-  std::vector< VkWriteDescriptorSet> writeSets(_prog.bindings.size());
+void Renderer::WaitForFrame(uint64_t _frameCount)
+{
+  SKL_PROFILE_FUNCTION();
+
+  VkFence fence;
+  {
+    std::unique_lock<std::mutex> guard(renderedFrameLock);
+    renderedFrameSignal.wait(guard, [&]() { return renderedFrameCount >= _frameCount; });
+    fence = lastSubmittedFence;
+  }
+
+  // The fence is only reset by the next RenderFrame, which cannot start until the caller lets it
+  if (fence != VK_NULL_HANDLE)
+  {
+    vkWaitForFences(vulkanContext.device, 1, &fence, VK_TRUE, UINT64_MAX);
+  }
+}
+
+void Renderer::ApplyPresentPolicy()
+{
+  sklPresentPolicy_t policy = GetPresentPolicy();
+  sklPresentPolicy_t& current = backend->presentPolicy;
+
+  // Offscreen images have no present mode, only the frame count applies to them
+  if (!backend->headless && (policy.mode != current.mode ||
+                             policy.swapchainImageCount != current.swapchainImageCount))
+  {
+    resizePending = true;
+  }
+  current.mode = policy.mode;
+  current.swapchainImageCount = policy.swapchainImageCount;
+  current.lowLatency = policy.lowLatency;
+  backend->SetFramesInFlight(policy.framesInFlight);
+}
+
+bool Renderer::CaptureFrame(const char* _directory)
+{
+  if (!backend->headless)
+  {
+    SKL_LOG(SKL_ERROR, "Frames can only be captured when rendering headless");
+    return false;
+  }
+
+  vkDeviceWaitIdle(vulkanContext.device);
+
+  VkExtent2D extent = vulkanContext.renderExtent;
+  VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+  VkBuffer readbackBuffer;
+  VkDeviceMemory readbackMemory;
+  uint32_t readbackIndex = bufferManager->CreateBuffer(readbackBuffer, readbackMemory, size,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+  // The renderpass leaves the image in TRANSFER_SRC_OPTIMAL
+  VkCommandBuffer command =
+      vulkanContext.BeginSingleTimeCommand(vulkanContext.graphicsCommandPool);
+
+  VkBufferImageCopy region = {};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = { 0, 0, 0 };
+  region.imageExtent = { extent.width, extent.height, 1 };
+
+  vkCmdCopyImageToBuffer(command, backend->swapchainImages[lastImageIndex],
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+  vulkanContext.EndSingleTimeCommand(command, vulkanContext.graphicsCommandPool,
+                                     vulkanContext.graphicsQueue);
+
+  void* pixels;
+  vkMapMemory(vulkanContext.device, readbackMemory, 0, size, 0, &pixels);
+  bool written = WritePngFile(_directory, extent.width, extent.height, pixels);
+  vkUnmapMemory(vulkanContext.device, readbackMemory);
+
+  bufferManager->RemoveAtIndex(readbackIndex);
+
+  if (written)
+  {
+    SKL_PRINT("Renderer", "Captured frame to \"%s\"", _directory);
+  }
+  return written;
+}
+
+void Renderer::CreateDescriptorSet(shaderProgram_t& _prog, sklRenderable_t& _renderable,
+                                   const std::vector<uint32_t>& _textures /*= {}*/)
+{
+  std::vector<sklDescriptorResource_t> resources(_prog.bindings.size());
+  uint32_t imageidx = 0;
 
   for (uint32_t i = 0; i < _prog.bindings.size(); i++)
   {
-    if (_prog.bindings[i] == Skl_Binding_Buffer)
+    // Bindless resources are identified by their position in the pushed indices instead
+    VkDeviceSize blockSize = 0;
+    if (vulkanContext.bindless)
     {
-      bufferidx++;
+      resources[i].binding = i;
+      resources[i].type = (_prog.bindings[i] == Skl_Binding_Buffer) ?
+          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     }
     else
     {
-      imageidx++;
+      resources[i].binding = _prog.reflectedBindings[i].binding;
+      resources[i].type = _prog.reflectedBindings[i].type;
+      blockSize = _prog.reflectedBindings[i].blockSize;
     }
-  }
 
-
-  bufferInfos.resize(bufferidx);
-  imageInfos.resize(imageidx);
-  bufferidx = 0;
-  imageidx = 0;
-
-  for (uint32_t i = 0; i < _prog.bindings.size(); i++)
-  {
-    if (_prog.bindings[i] == Skl_Binding_Buffer)
+    // Programs taking their model matrix as a push constant share the camera's matrices
+    if (_prog.bindings[i] == Skl_Binding_Buffer && _prog.pushConstantRange.size > 0 &&
+        resources[i].type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER &&
+        blockSize <= sizeof(MVPMatrices))
     {
+      resources[i].buffer = mvpBuffer;
+      resources[i].offset = 0;
+      resources[i].range = sizeof(MVPMatrices);
+    }
+    else if (_prog.bindings[i] == Skl_Binding_Buffer)
+    {
+      // Applications fill object buffers with MVPMatrices, larger blocks get their full size
+      VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+          ((resources[i].type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) ?
+              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
       sklBuffer_t* buf = new sklBuffer_t();
       bufferManager->CreateBuffer(
-          buf->buffer, buf->memory, sizeof(MVPMatrices),
-          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          buf->buffer, buf->memory, std::max<VkDeviceSize>(blockSize, sizeof(MVPMatrices)), usage,
           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
       _renderable.buffers.push_back(buf);
 
-      bufferInfos[bufferidx].buffer = buf->buffer;
-      bufferInfos[bufferidx].offset = 0;
-      bufferInfos[bufferidx].range = VK_WHOLE_SIZE;
-
-      writeSets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      writeSets[i].dstSet = _prog.descriptorSet;
-      writeSets[i].dstBinding = i;
-      writeSets[i].dstArrayElement = 0;
-      writeSets[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-      writeSets[i].descriptorCount = 1;
-      writeSets[i].pBufferInfo = &bufferInfos[bufferidx];
-      writeSets[i].pImageInfo = nullptr;
-      writeSets[i].pTexelBufferView = nullptr;
-
-      bufferidx++;
+      resources[i].buffer = buf->buffer;
+      resources[i].offset = 0;
+      resources[i].range = VK_WHOLE_SIZE;
     }
     else
     {
-      uint32_t texIdx = TextureManager::CreateTexture(((i % 2 == 0) ? "res/AltImage.png" : "res/TestImage.png"), bufferManager);
+      uint32_t texIdx = (imageidx < _textures.size()) ? _textures[imageidx] :
+          TextureManager::CreateTexture((i % 2 == 0) ? "res/AltImage.png" : "res/TestImage.png",
+                                        bufferManager);
       uint32_t rendImageIdx = TextureManager::textures[texIdx]->imageIndex;
       sklImage_t* imageA = ImageManager::images[rendImageIdx];
-      //uint32_t rendImageIdx = static_cast<uint32_t>(_renderable.images.size());
       _renderable.images.push_back(imageA);
 
-      VkDescriptorImageInfo imageInfoA = {};
-      imageInfos[imageidx].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-      imageInfos[imageidx].sampler = ImageManager::images[rendImageIdx]->sampler;
-      imageInfos[imageidx].imageView = ImageManager::images[rendImageIdx]->view;
-
-      writeSets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      writeSets[i].dstSet = _prog.descriptorSet;
-      writeSets[i].dstBinding = i;
-      writeSets[i].dstArrayElement = 0;
-      writeSets[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-      writeSets[i].descriptorCount = 1;
-      writeSets[i].pBufferInfo = nullptr;
-      writeSets[i].pImageInfo = &imageInfos[imageidx];
-      writeSets[i].pTexelBufferView = nullptr;
+      resources[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      resources[i].sampler = imageA->sampler;
+      resources[i].view = imageA->view;
 
       imageidx++;
     }
   }
 
-  vkUpdateDescriptorSets(vulkanContext.device, static_cast<uint32_t>(writeSets.size()),
-                         writeSets.data(), 0, nullptr);
+  if (vulkanContext.bindless)
+  {
+    _renderable.bindlessIndices.clear();
+    for (const sklDescriptorResource_t& resource : resources)
+    {
+      _renderable.bindlessIndices.push_back((resource.buffer != VK_NULL_HANDLE) ?
+          SklBindless::AddBuffer(resource.buffer, resource.offset, resource.range) :
+          SklBindless::AddTexture(resource.view, resource.sampler));
+    }
+    return;
+  }
+
+  // Renderables binding the same resources share a set, the rest each get their own
+  _renderable.descriptorSet = SklDescriptorCache::GetSet(_prog.descriptorSetLayout, resources);
+  _renderable.descriptorResources = resources;
 }
 
 //=================================================
@@ -176,7 +382,17 @@ void Renderer::CreateDescriptorSet(shaderProgram_t& _prog, sklRenderable_t& _ren
 
 void Renderer::CreateRenderer()
 {
+  SklPipelineCache::Initialize(pipelineCachePath);
+  // The swapchain is created with the policy requested so far
+  backend->presentPolicy = GetPresentPolicy();
+  backend->presentPolicy.framesInFlight = glm::clamp(backend->presentPolicy.framesInFlight, 1u,
+      static_cast<uint32_t>(MAX_FLIGHT_IMAGE_COUNT));
+  presentPolicyPending = false;
   backend->InitializeRenderComponents();
+  // Pipelines depend on the render pass, so programs can only be compiled once it exists
+  SklPipelineBuilder::Initialize(pipelineWorkerCount);
+  gpuProfiler = new SklGpuProfiler(MAX_FLIGHT_IMAGE_COUNT, 32, gpuPipelineStatistics);
+  aspectRatio = vulkanContext.renderExtent.width / float(vulkanContext.renderExtent.height);
 }
 
 void Renderer::CleanupRenderer()
@@ -186,9 +402,22 @@ void Renderer::CleanupRenderer()
 
 void Renderer::RecreateRenderer()
 {
-  vkDeviceWaitIdle(vulkanContext.device);
-  CleanupRenderer();
-  backend->CreateRenderComponents();
+  resizePending = true;
+}
+
+bool Renderer::RecreateSwapchain()
+{
+  SKL_PROFILE_FUNCTION();
+
+  if (!backend->RecreateSwapchain())
+    return false;
+  resizePending = false;
+
+  // Command buffers are recorded each frame, the next picks up the new framebuffers and extent
+  VkExtent2D extent = vulkanContext.renderExtent;
+  aspectRatio = extent.width / float(extent.height);
+  SKL_PRINT("Renderer", "Swapchain recreated at %ux%u", extent.width, extent.height);
+  return true;
 }
 
 //=================================================
@@ -200,13 +429,49 @@ void Renderer::RecreateRenderer()
 // CreateRenderer Functions
 //=================================================
 
-void Renderer::RecordCommandBuffers()
+VkDescriptorSet Renderer::AllocateFrameDescriptorSet(VkDescriptorSetLayout _layout)
 {
+  return backend->frameDescriptorAllocators[backend->currentFrame]->Allocate(_layout);
+}
+
+void Renderer::SetFrameTextures(sklRenderable_t& _renderable,
+                                const std::vector<uint32_t>& _textures)
+{
+  if (vulkanContext.bindless)
+  {
+    SKL_PRINT_WARNING("Renderer", "Frame textures are unavailable when rendering bindless");
+    return;
+  }
+
+  // Images are replaced in binding order, the renderable's buffers are kept
+  std::vector<sklDescriptorResource_t> resources = _renderable.descriptorResources;
+  uint32_t imageidx = 0;
+  for (sklDescriptorResource_t& resource : resources)
+  {
+    if (resource.buffer != VK_NULL_HANDLE || imageidx >= _textures.size())
+      continue;
+
+    uint32_t rendImageIdx = TextureManager::textures[_textures[imageidx++]]->imageIndex;
+    resource.view = ImageManager::images[rendImageIdx]->view;
+    resource.sampler = ImageManager::images[rendImageIdx]->sampler;
+  }
+
+  shaderProgram_t& program = vulkanContext.shaderPrograms[_renderable.shaderProgramIndex];
+  _renderable.frameDescriptorSet = AllocateFrameDescriptorSet(program.descriptorSetLayout);
+  SklDescriptorCache::WriteSet(_renderable.frameDescriptorSet, resources);
+}
+
+void Renderer::RecordCommandBuffer(uint32_t _frame, uint32_t _imageIndex)
+{
+  SKL_PROFILE_FUNCTION();
+
   shaderProgram_t* shaderProgram;
+  VkCommandBuffer command = backend->commandBuffers[_frame];
 
-  uint32_t comandCount = static_cast<uint32_t>(backend->commandBuffers.size());
+  // Recorded and submitted once before its pool is reset
   VkCommandBufferBeginInfo beginInfo = {};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
   VkClearValue clearValues[2] = {};
   clearValues[0].color = { 0.20784313725f, 0.21568627451f, 0.21568627451f, 1.0f };
@@ -219,46 +484,83 @@ void Renderer::RecordCommandBuffers()
   rpBeginInfo.pClearValues = clearValues;
   rpBeginInfo.renderArea.extent = vulkanContext.renderExtent;
   rpBeginInfo.renderArea.offset = { 0, 0 };
+  rpBeginInfo.framebuffer = backend->frameBuffers[_imageIndex];
 
-  for (uint32_t i = 0; i < comandCount; i++)
-  {
-    rpBeginInfo.framebuffer = backend->frameBuffers[i];
-    SKL_ASSERT_VK(
-      vkBeginCommandBuffer(backend->commandBuffers[i], &beginInfo),
-      "Failed to begin a command buffer");
+  SKL_ASSERT_VK(
+    vkBeginCommandBuffer(command, &beginInfo),
+    "Failed to begin a command buffer");
 
-    vkCmdBeginRenderPass(backend->commandBuffers[i], &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+  gpuProfiler->BeginRecording(command, _frame);
+  gpuProfiler->BeginScope(command, _frame, "Frame");
+  gpuProfiler->BeginScope(command, _frame, "Main Pass");
 
-    // TODO : Only bind pipelines once
-    for (uint32_t j = 0; j < vulkanContext.renderables.size(); j++)
+  vkCmdBeginRenderPass(command, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+  // Pipelines leave the viewport and scissor dynamic so they survive resizes
+  VkViewport viewport = {};
+  viewport.width = static_cast<float>(vulkanContext.renderExtent.width);
+  viewport.height = static_cast<float>(vulkanContext.renderExtent.height);
+  viewport.minDepth = 0.f;
+  viewport.maxDepth = 1.f;
+  vkCmdSetViewport(command, 0, 1, &viewport);
+
+  VkRect2D scissor = {};
+  scissor.extent = vulkanContext.renderExtent;
+  vkCmdSetScissor(command, 0, 1, &scissor);
+
+  // Every bindless program shares one pipeline layout, so the set stays bound across pipelines
+  if (vulkanContext.bindless)
+  {
+    SklBindless::Bind(command);
+  }
+
+  // TODO : Only bind pipelines once
+  for (uint32_t j = 0; j < vulkanContext.renderables.size(); j++)
+  {
+    shaderProgram =
+        &vulkanContext.shaderPrograms[vulkanContext.renderables[j].shaderProgramIndex];
+    vkCmdBindPipeline(
+      command,
+      VK_PIPELINE_BIND_POINT_GRAPHICS,
+      shaderProgram->GetPipeline(vulkanContext.shaders[shaderProgram->vertIdx].module,
+                                 vulkanContext.shaders[shaderProgram->fragIdx].module,
+                                 vulkanContext.renderables[j].shaderFeatures));
+    if (vulkanContext.extendedDynamicState)
+    {
+      SetDynamicPipelineState(command, shaderProgram->pipelineState);
+    }
+    if (vulkanContext.bindless)
+    {
+      SklBindless::PushIndices(command, vulkanContext.renderables[j].bindlessIndices);
+    }
+    else
     {
-      shaderProgram =
-          &vulkanContext.shaderPrograms[vulkanContext.renderables[j].shaderProgramIndex];
-      vkCmdBindPipeline(
-        backend->commandBuffers[i],
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        shaderProgram->GetPipeline(vulkanContext.shaders[shaderProgram->vertIdx].module,
-                             vulkanContext.shaders[shaderProgram->fragIdx].module));
-      vkCmdBindDescriptorSets(backend->commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS,
-                              shaderProgram->pipelineLayout, 0, 1, &shaderProgram->descriptorSet,
-                              0, nullptr);
-      VkDeviceSize offset[] = { 0 };
-
-      mesh_t& mesh = vulkanContext.renderables[j].mesh;
-      vkCmdBindVertexBuffers(backend->commandBuffers[i], 0, 1,
-                             bufferManager->GetBuffer(mesh.vertexBufferIndex), offset);
-      vkCmdBindIndexBuffer(backend->commandBuffers[i],
-          *(bufferManager->GetBuffer(mesh.indexBufferIndex)), 0, VK_INDEX_TYPE_UINT32);
-      vkCmdDrawIndexed(backend->commandBuffers[i], static_cast<uint32_t>(mesh.indices.size()),
-                       1, 0, 0, 0);
+      sklRenderable_t& renderable = vulkanContext.renderables[j];
+      const VkDescriptorSet* set = (renderable.frameDescriptorSet != VK_NULL_HANDLE) ?
+          &renderable.frameDescriptorSet : &renderable.descriptorSet;
+      vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              shaderProgram->pipelineLayout, 0, 1, set, 0, nullptr);
     }
+    PushDrawConstants(command, *shaderProgram, &vulkanContext.renderables[j].drawConstants,
+                      sizeof(sklDrawConstants_t));
+    VkDeviceSize offset[] = { 0 };
+
+    mesh_t& mesh = vulkanContext.renderables[j].mesh;
+    vkCmdBindVertexBuffers(command, 0, 1, bufferManager->GetBuffer(mesh.vertexBufferIndex),
+                           offset);
+    vkCmdBindIndexBuffer(command, *(bufferManager->GetBuffer(mesh.indexBufferIndex)), 0,
+                         VK_INDEX_TYPE_UINT32);
+    vkCmdDrawIndexed(command, static_cast<uint32_t>(mesh.indices.size()), 1, 0, 0, 0);
+  }
 
-    vkCmdEndRenderPass(backend->commandBuffers[i]);
+  vkCmdEndRenderPass(command);
 
-    SKL_ASSERT_VK(
-      vkEndCommandBuffer(backend->commandBuffers[i]),
-      "Failed to end command buffer");
-  }
+  gpuProfiler->EndScope(command, _frame);
+  gpuProfiler->EndScope(command, _frame);
+
+  SKL_ASSERT_VK(
+    vkEndCommandBuffer(command),
+    "Failed to end command buffer");
 }
 
 //=================================================
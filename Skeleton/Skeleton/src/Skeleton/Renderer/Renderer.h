@@ -3,6 +3,10 @@
 #define SKELETON_RENDERER_RENDERER_H 1
 
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 #include "vulkan/vulkan.h"
 #include "sdl/SDL.h"
@@ -11,6 +15,7 @@
 #include "glm/gtc/matrix_transform.hpp"
 
 #include "skeleton/renderer/render_backend.h"
+#include "skeleton/renderer/gpu_profiler.h"
 #include "skeleton/core/camera.h"
 
 class Renderer
@@ -36,6 +41,41 @@ public:
   // TODO : Move to the Main Application
   Camera cam;
 
+  // The image most recently submitted for rendering
+  uint32_t lastImageIndex = 0;
+  // Times scopes of the recorded command buffers on the GPU
+  SklGpuProfiler* gpuProfiler = nullptr;
+  // Gather pipeline statistics for top-level GPU scopes, set before CreateRenderer
+  bool gpuPipelineStatistics = false;
+  // Milliseconds the GPU spent on the most recently completed frame, 0 if unavailable
+  float gpuFrameTime = 0.f;
+  // File the pipeline cache is loaded from and saved to, set before CreateRenderer
+  const char* pipelineCachePath = nullptr;
+  // Set when the window's size changes, the swapchain is recreated before the next frame
+  std::atomic<bool> resizePending { false };
+  // Width over height of the render extent, follows swapchain recreation
+  std::atomic<float> aspectRatio { 1.f };
+  // Threads compiling pipelines in the background, set before CreateRenderer
+  // 0 uses one per hardware thread beyond the main thread's
+  uint32_t pipelineWorkerCount = 0;
+  // Milliseconds from sampling the most recent frame's input to handing it to presentation
+  std::atomic<float> inputLatency { 0.f };
+
+private:
+  // Policy requested through SetPresentPolicy, handed to the backend before the next frame
+  std::mutex presentPolicyLock;
+  sklPresentPolicy_t requestedPresentPolicy;
+  std::atomic<bool> presentPolicyPending { false };
+
+  // Whether BeginFrame has been called for the frame RenderFrame submits next
+  bool frameBegun = false;
+
+  // Counts RenderFrame calls so other threads can wait for a frame to be submitted
+  std::mutex renderedFrameLock;
+  std::condition_variable renderedFrameSignal;
+  uint64_t renderedFrameCount = 0;
+  VkFence lastSubmittedFence = VK_NULL_HANDLE;
+
   //=================================================
   // Functions
   //=================================================
@@ -44,7 +84,9 @@ public:
   //=================================================
 
   // Creates the RendererBackend and BufferManager
-  Renderer(const std::vector<const char*>& _extraExtensions, SDL_Window* _window);
+  // A null window renders offscreen at _headlessExtent
+  Renderer(const std::vector<const char*>& _extraExtensions, SDL_Window* _window,
+           VkExtent2D _headlessExtent = { 0, 0 });
   // Cleans up the RendererBackend
   ~Renderer();
 
@@ -55,29 +97,65 @@ public:
   void CreateRenderer();
   // Cleans up the RendererBackend
   void CleanupRenderer();
-  // Recreates the RendererBackend
+  // Recreates the swapchain and its dependents before the next frame
   void RecreateRenderer();
+  // Replaces the swapchain, the next frame is recorded at its new size
+  // Returns false if the window has no area to render to
+  bool RecreateSwapchain();
 
   // Runtime
   //=================================================
 
   // Handles all rendering processes
   // Fetches the next image and places in the rendering and presentation queues
-  void RenderFrame();
+  // _inputTime is when the frame's input was sampled, used to measure its latency
+  void RenderFrame(std::chrono::steady_clock::time_point _inputTime = {});
+  // Writes the most recently rendered headless image to a .png file
+  bool CaptureFrame(const char* _directory);
+
+  // Presentation
+  //=================================================
+
+  // Requests a presentation policy, applied before the next frame
+  // Changing the present mode or image count recreates the swapchain
+  void SetPresentPolicy(const sklPresentPolicy_t& _policy);
+  // Retrieves the most recently requested presentation policy
+  sklPresentPolicy_t GetPresentPolicy();
+  // Blocks until RenderFrame has been called _frameCount times and the GPU has finished the
+  //   last frame submitted
+  void WaitForFrame(uint64_t _frameCount);
 
   // Defines buffers and images for a shaderProgram's bindings
-  void CreateDescriptorSet(shaderProgram_t& _prog, sklRenderable_t& _renderable);
+  // Image bindings use _textures in order, or the default test images when none are given
+  void CreateDescriptorSet(shaderProgram_t& _prog, sklRenderable_t& _renderable,
+                           const std::vector<uint32_t>& _textures = {});
+
+  // Waits until the next frame's resources are free and resets its transient allocations
+  // Call before the frame's update work, RenderFrame calls it when it hasn't been
+  void BeginFrame();
+  // Allocates a set that is only valid for the frame begun by the last BeginFrame
+  // Its pool is reset when the frame's slot is begun again, so the set must not be kept
+  VkDescriptorSet AllocateFrameDescriptorSet(VkDescriptorSetLayout _layout);
+  // Draws _renderable with _textures in place of its images for the current frame only
+  // Call between BeginFrame and RenderFrame, unavailable when rendering bindless
+  void SetFrameTextures(sklRenderable_t& _renderable, const std::vector<uint32_t>& _textures);
 
   // TODO : Remove when Objects have individual MVP buffers/push-constants
   // Creates a universal MVP buffer
   void CreateModelBuffers();
-  // Records rendering information into commandbuffers
-  void RecordCommandBuffers();
 
 protected:
   // Helpers
   //=================================================
 
+  // Submits and presents the frame, RenderFrame wraps this to count its calls
+  void SubmitFrame(std::chrono::steady_clock::time_point _inputTime);
+  // Hands a requested presentation policy to the backend
+  void ApplyPresentPolicy();
+  // Records a frame's command buffer from the current renderables, drawing into _imageIndex
+  // The frame's pool must have been reset since its last submission
+  void RecordCommandBuffer(uint32_t _frame, uint32_t _imageIndex);
+
   // Loads image from file to a texture
   void CreateTextureImage(const char* _directory);
 
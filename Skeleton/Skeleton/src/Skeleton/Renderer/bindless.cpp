@@ -0,0 +1,261 @@
+
+#include "pch.h"
+#include "skeleton/renderer/bindless.h"
+
+#include <mutex>
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "skeleton/renderer/vulkan_context.h"
+#include "skeleton/core/debug_tools.h"
+
+// Bindings of the global set
+#define SKL_BINDLESS_TEXTURE_BINDING 0
+#define SKL_BINDLESS_BUFFER_BINDING 1
+
+namespace
+{
+  struct sklBindlessState_t
+  {
+    std::mutex lock;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSet set = VK_NULL_HANDLE;
+
+    uint32_t maxTextures = 0;
+    uint32_t maxBuffers = 0;
+    uint32_t textureCount = 0;
+    uint32_t bufferCount = 0;
+    // Index of each texture keyed by its view and sampler, identical pairs share a slot
+    std::map<std::pair<VkImageView, VkSampler>, uint32_t> textureIndices;
+  };
+
+  sklBindlessState_t& GetState()
+  {
+    static sklBindlessState_t state;
+    return state;
+  }
+}
+
+void SklBindless::Initialize(uint32_t _maxTextures /*= 4096*/, uint32_t _maxBuffers /*= 4096*/)
+{
+  sklBindlessState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  if (state.set != VK_NULL_HANDLE)
+    return;
+
+  // Update-after-bind descriptors have their own, usually much larger, limits
+  VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {};
+  indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+  VkPhysicalDeviceProperties2 properties = {};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties.pNext = &indexingProperties;
+  vkGetPhysicalDeviceProperties2(vulkanContext.gpu.device, &properties);
+
+  state.maxTextures = std::min({ _maxTextures,
+      indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+      indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages });
+  state.maxBuffers = std::min({ _maxBuffers,
+      indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+      indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+  // Layout
+  //=================================================
+  VkDescriptorSetLayoutBinding bindings[2] = {};
+  bindings[0].binding = SKL_BINDLESS_TEXTURE_BINDING;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  bindings[0].descriptorCount = state.maxTextures;
+  bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+  bindings[1].binding = SKL_BINDLESS_BUFFER_BINDING;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[1].descriptorCount = state.maxBuffers;
+  bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  // Unused slots are never accessed, and new slots are written while the set is bound
+  VkDescriptorBindingFlags bindingFlags[2] = {
+    VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+    VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+  };
+  VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo = {};
+  flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  flagsInfo.bindingCount = 2;
+  flagsInfo.pBindingFlags = bindingFlags;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.pNext = &flagsInfo;
+  layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+  layoutInfo.bindingCount = 2;
+  layoutInfo.pBindings = bindings;
+
+  SKL_ASSERT_VK(
+      vkCreateDescriptorSetLayout(vulkanContext.device, &layoutInfo, nullptr, &state.setLayout),
+      "Failed to create bindless descriptor set layout");
+
+  VkPushConstantRange pushRange = {};
+  pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushRange.offset = 0;
+  pushRange.size = sizeof(uint32_t) * SKL_BINDLESS_MAX_INDICES;
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &state.setLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+
+  SKL_ASSERT_VK(
+      vkCreatePipelineLayout(vulkanContext.device, &pipelineLayoutInfo, nullptr,
+                             &state.pipelineLayout),
+      "Failed to create bindless pipeline layout");
+
+  // Set
+  //=================================================
+  VkDescriptorPoolSize poolSizes[2] = {};
+  poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  poolSizes[0].descriptorCount = state.maxTextures;
+  poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSizes[1].descriptorCount = state.maxBuffers;
+
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+  poolInfo.maxSets = 1;
+  poolInfo.poolSizeCount = 2;
+  poolInfo.pPoolSizes = poolSizes;
+
+  SKL_ASSERT_VK(
+      vkCreateDescriptorPool(vulkanContext.device, &poolInfo, nullptr, &state.pool),
+      "Failed to create bindless descriptor pool");
+
+  VkDescriptorSetAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = state.pool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &state.setLayout;
+
+  SKL_ASSERT_VK(
+      vkAllocateDescriptorSets(vulkanContext.device, &allocInfo, &state.set),
+      "Failed to allocate bindless descriptor set");
+
+  SKL_PRINT("Bindless", "Global set holds %u textures and %u buffers", state.maxTextures,
+            state.maxBuffers);
+}
+
+void SklBindless::Shutdown()
+{
+  sklBindlessState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  if (state.set == VK_NULL_HANDLE)
+    return;
+
+  vkDestroyDescriptorPool(vulkanContext.device, state.pool, nullptr);
+  vkDestroyPipelineLayout(vulkanContext.device, state.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(vulkanContext.device, state.setLayout, nullptr);
+
+  state.set = VK_NULL_HANDLE;
+  state.textureCount = 0;
+  state.bufferCount = 0;
+  state.textureIndices.clear();
+}
+
+uint32_t SklBindless::AddTexture(VkImageView _view, VkSampler _sampler)
+{
+  sklBindlessState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+
+  auto existing = state.textureIndices.find({ _view, _sampler });
+  if (existing != state.textureIndices.end())
+  {
+    return existing->second;
+  }
+
+  if (state.textureCount >= state.maxTextures)
+  {
+    SKL_LOG(SKL_ERROR, "Bindless texture array is full (%u textures)", state.maxTextures);
+    throw std::runtime_error("Bindless texture array is full");
+  }
+
+  uint32_t index = state.textureCount++;
+  state.textureIndices[{ _view, _sampler }] = index;
+
+  VkDescriptorImageInfo imageInfo = {};
+  imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  imageInfo.imageView = _view;
+  imageInfo.sampler = _sampler;
+
+  VkWriteDescriptorSet write = {};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = state.set;
+  write.dstBinding = SKL_BINDLESS_TEXTURE_BINDING;
+  write.dstArrayElement = index;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  write.descriptorCount = 1;
+  write.pImageInfo = &imageInfo;
+  vkUpdateDescriptorSets(vulkanContext.device, 1, &write, 0, nullptr);
+
+  return index;
+}
+
+uint32_t SklBindless::AddBuffer(VkBuffer _buffer, VkDeviceSize _offset /*= 0*/,
+                                VkDeviceSize _range /*= VK_WHOLE_SIZE*/)
+{
+  sklBindlessState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+
+  if (state.bufferCount >= state.maxBuffers)
+  {
+    SKL_LOG(SKL_ERROR, "Bindless buffer array is full (%u buffers)", state.maxBuffers);
+    throw std::runtime_error("Bindless buffer array is full");
+  }
+
+  uint32_t index = state.bufferCount++;
+
+  VkDescriptorBufferInfo bufferInfo = {};
+  bufferInfo.buffer = _buffer;
+  bufferInfo.offset = _offset;
+  bufferInfo.range = _range;
+
+  VkWriteDescriptorSet write = {};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = state.set;
+  write.dstBinding = SKL_BINDLESS_BUFFER_BINDING;
+  write.dstArrayElement = index;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  write.descriptorCount = 1;
+  write.pBufferInfo = &bufferInfo;
+  vkUpdateDescriptorSets(vulkanContext.device, 1, &write, 0, nullptr);
+
+  return index;
+}
+
+VkDescriptorSetLayout SklBindless::GetSetLayout()
+{
+  return GetState().setLayout;
+}
+
+VkPipelineLayout SklBindless::GetPipelineLayout()
+{
+  return GetState().pipelineLayout;
+}
+
+void SklBindless::Bind(VkCommandBuffer _command)
+{
+  sklBindlessState_t& state = GetState();
+  vkCmdBindDescriptorSets(_command, VK_PIPELINE_BIND_POINT_GRAPHICS, state.pipelineLayout, 0, 1,
+                          &state.set, 0, nullptr);
+}
+
+void SklBindless::PushIndices(VkCommandBuffer _command, const std::vector<uint32_t>& _indices)
+{
+  // Unused indices are left as zero so the whole range is always defined
+  uint32_t indices[SKL_BINDLESS_MAX_INDICES] = {};
+  size_t count = std::min(_indices.size(), static_cast<size_t>(SKL_BINDLESS_MAX_INDICES));
+  std::copy(_indices.begin(), _indices.begin() + count, indices);
+
+  vkCmdPushConstants(_command, GetState().pipelineLayout,
+                     VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                     sizeof(indices), indices);
+}
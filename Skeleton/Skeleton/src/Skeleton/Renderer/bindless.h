@@ -0,0 +1,50 @@
+
+#ifndef SKELETON_RENDERER_BINDLESS_H
+#define SKELETON_RENDERER_BINDLESS_H 1
+
+#include <cstdint>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+// Most resource indices a single draw can push, one per binding of its program
+#define SKL_BINDLESS_MAX_INDICES 8
+
+// Holds every texture and per-object buffer in one global descriptor set that shaders index
+// Draws push the indices of their resources rather than binding sets of their own, so the set
+//   is bound once per command buffer and draws of different materials can be merged
+// Binding 0 is an array of combined image samplers, binding 1 an array of storage buffers
+// Both are partially bound and updated after bind, resources can be added while frames are
+//   in flight
+class SklBindless
+{
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Creates the global set with room for up to _maxTextures and _maxBuffers
+  // Both are reduced to what the device supports
+  static void Initialize(uint32_t _maxTextures = 4096, uint32_t _maxBuffers = 4096);
+  // Destroys the global set, its layouts, and its pool
+  static void Shutdown();
+
+  // Adds an image to the texture array and returns its index
+  // Adding a view and sampler that were already added returns their existing index
+  static uint32_t AddTexture(VkImageView _view, VkSampler _sampler);
+  // Adds a buffer to the storage buffer array and returns its index
+  static uint32_t AddBuffer(VkBuffer _buffer, VkDeviceSize _offset = 0,
+                            VkDeviceSize _range = VK_WHOLE_SIZE);
+
+  // Retrieves the layout of the global set
+  static VkDescriptorSetLayout GetSetLayout();
+  // Retrieves the pipeline layout every bindless program uses
+  static VkPipelineLayout GetPipelineLayout();
+
+  // Binds the global set, needed once per command buffer before drawing
+  static void Bind(VkCommandBuffer _command);
+  // Pushes a draw's resource indices, at most SKL_BINDLESS_MAX_INDICES
+  static void PushIndices(VkCommandBuffer _command, const std::vector<uint32_t>& _indices);
+
+}; // class SklBindless
+
+#endif // !SKELETON_RENDERER_BINDLESS_H
@@ -0,0 +1,105 @@
+
+#include "pch.h"
+#include "skeleton/renderer/descriptor_allocator.h"
+
+#include <algorithm>
+
+#include "skeleton/renderer/vulkan_context.h"
+#include "skeleton/core/debug_tools.h"
+
+// Pools stop growing at this many sets, beyond it more pools of the same size are added
+#define SKL_DESCRIPTOR_POOL_MAX_SETS 4096u
+
+SklDescriptorAllocator::SklDescriptorAllocator(
+    uint32_t _initialSets, const std::vector<sklDescriptorPoolRatio_t>& _ratios)
+    : ratios(_ratios), setsPerPool(std::max(_initialSets, 1u))
+{
+  readyPools.push_back(CreatePool(setsPerPool));
+}
+
+SklDescriptorAllocator::~SklDescriptorAllocator()
+{
+  for (VkDescriptorPool pool : readyPools)
+  {
+    vkDestroyDescriptorPool(vulkanContext.device, pool, nullptr);
+  }
+  for (VkDescriptorPool pool : fullPools)
+  {
+    vkDestroyDescriptorPool(vulkanContext.device, pool, nullptr);
+  }
+}
+
+VkDescriptorSet SklDescriptorAllocator::Allocate(VkDescriptorSetLayout _layout)
+{
+  VkDescriptorSetAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = GetPool();
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &_layout;
+
+  VkDescriptorSet set = VK_NULL_HANDLE;
+  VkResult result = vkAllocateDescriptorSets(vulkanContext.device, &allocInfo, &set);
+
+  // The pool ran out of sets or descriptors, retire it and retry once with a fresh pool
+  if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+  {
+    fullPools.push_back(readyPools.back());
+    readyPools.pop_back();
+
+    allocInfo.descriptorPool = GetPool();
+    result = vkAllocateDescriptorSets(vulkanContext.device, &allocInfo, &set);
+  }
+
+  SKL_ASSERT_VK(result, "Failed to allocate descriptor set");
+  allocatedSetCount++;
+  return set;
+}
+
+void SklDescriptorAllocator::Reset()
+{
+  for (VkDescriptorPool pool : readyPools)
+  {
+    vkResetDescriptorPool(vulkanContext.device, pool, 0);
+  }
+  for (VkDescriptorPool pool : fullPools)
+  {
+    vkResetDescriptorPool(vulkanContext.device, pool, 0);
+    readyPools.push_back(pool);
+  }
+  fullPools.clear();
+  allocatedSetCount = 0;
+}
+
+VkDescriptorPool SklDescriptorAllocator::GetPool()
+{
+  if (readyPools.empty())
+  {
+    // Growing geometrically keeps the number of pools logarithmic in the number of sets
+    setsPerPool = std::min(setsPerPool * 2, SKL_DESCRIPTOR_POOL_MAX_SETS);
+    readyPools.push_back(CreatePool(setsPerPool));
+  }
+  return readyPools.back();
+}
+
+VkDescriptorPool SklDescriptorAllocator::CreatePool(uint32_t _setCount)
+{
+  std::vector<VkDescriptorPoolSize> poolSizes(ratios.size());
+  for (uint32_t i = 0; i < ratios.size(); i++)
+  {
+    poolSizes[i].type = ratios[i].type;
+    poolSizes[i].descriptorCount =
+        std::max(static_cast<uint32_t>(ratios[i].perSet * _setCount), 1u);
+  }
+
+  VkDescriptorPoolCreateInfo createInfo = {};
+  createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  createInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  createInfo.pPoolSizes = poolSizes.data();
+  createInfo.maxSets = _setCount;
+
+  VkDescriptorPool pool;
+  SKL_ASSERT_VK(
+      vkCreateDescriptorPool(vulkanContext.device, &createInfo, nullptr, &pool),
+      "Failed to create descriptor pool for %u sets", _setCount);
+  return pool;
+}
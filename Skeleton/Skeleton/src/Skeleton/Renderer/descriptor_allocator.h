@@ -0,0 +1,63 @@
+
+#ifndef SKELETON_RENDERER_DESCRIPTOR_ALLOCATOR_H
+#define SKELETON_RENDERER_DESCRIPTOR_ALLOCATOR_H 1
+
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+// How many descriptors of a type a pool holds for each set it can allocate
+struct sklDescriptorPoolRatio_t
+{
+  VkDescriptorType type;
+  float perSet;
+};
+
+// Allocates descriptor sets from a chain of pools
+// A larger pool is added whenever every existing pool is exhausted, so there is no limit on
+//   the number of sets and each allocation is amortized O(1)
+// Sets are never freed individually, Reset returns every set to the pools at once
+class SklDescriptorAllocator
+{
+  //=================================================
+  // Variables
+  //=================================================
+private:
+  std::vector<sklDescriptorPoolRatio_t> ratios;
+  std::vector<VkDescriptorPool> readyPools;  // Pools that may still have room
+  std::vector<VkDescriptorPool> fullPools;   // Pools that have failed an allocation
+  uint32_t setsPerPool;                      // Size of the next pool created
+  uint32_t allocatedSetCount = 0;
+
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Creates the first pool, large enough for _initialSets sets
+  SklDescriptorAllocator(uint32_t _initialSets,
+                         const std::vector<sklDescriptorPoolRatio_t>& _ratios);
+  // Destroys every pool, freeing all sets allocated from them
+  ~SklDescriptorAllocator();
+
+  // Allocates a set with the given layout, adding a pool if the current ones are exhausted
+  VkDescriptorSet Allocate(VkDescriptorSetLayout _layout);
+  // Frees every set allocated so far, none may still be in use by the GPU
+  void Reset();
+
+  // Number of pools in the chain
+  uint32_t GetPoolCount() const
+  {
+    return static_cast<uint32_t>(readyPools.size() + fullPools.size());
+  }
+  // Number of sets allocated since creation or the last reset
+  uint32_t GetSetCount() const { return allocatedSetCount; }
+
+private:
+  // Retrieves a pool that may have room, creating one if there are none
+  VkDescriptorPool GetPool();
+  // Creates a pool for _setCount sets, with descriptors in proportion to the ratios
+  VkDescriptorPool CreatePool(uint32_t _setCount);
+
+}; // class SklDescriptorAllocator
+
+#endif // !SKELETON_RENDERER_DESCRIPTOR_ALLOCATOR_H
@@ -0,0 +1,306 @@
+
+#include "pch.h"
+#include "skeleton/renderer/descriptor_cache.h"
+
+#include <mutex>
+#include <unordered_map>
+
+#include "skeleton/renderer/descriptor_allocator.h"
+#include "skeleton/renderer/vulkan_context.h"
+#include "skeleton/core/debug_tools.h"
+
+namespace
+{
+  // Combines a value into a running hash
+  inline void HashCombine(size_t& _seed, uint64_t _value)
+  {
+    _seed ^= std::hash<uint64_t>()(_value) + 0x9e3779b97f4a7c15ull + (_seed << 6) + (_seed >> 2);
+  }
+
+  // Identifies a set layout by its bindings, immutable samplers are not supported
+  struct sklSetLayoutKey_t
+  {
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+    bool operator==(const sklSetLayoutKey_t& _other) const
+    {
+      if (bindings.size() != _other.bindings.size())
+        return false;
+
+      for (size_t i = 0; i < bindings.size(); i++)
+      {
+        const VkDescriptorSetLayoutBinding& a = bindings[i];
+        const VkDescriptorSetLayoutBinding& b = _other.bindings[i];
+        if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+            a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+  };
+
+  struct sklSetLayoutKeyHash_t
+  {
+    size_t operator()(const sklSetLayoutKey_t& _key) const
+    {
+      size_t seed = 0;
+      for (const VkDescriptorSetLayoutBinding& binding : _key.bindings)
+      {
+        HashCombine(seed, binding.binding);
+        HashCombine(seed, binding.descriptorType);
+        HashCombine(seed, binding.descriptorCount);
+        HashCombine(seed, binding.stageFlags);
+      }
+      return seed;
+    }
+  };
+
+  // Identifies a pipeline layout by its set layout and push constant range
+  struct sklPipelineLayoutKey_t
+  {
+    VkDescriptorSetLayout setLayout;
+    VkShaderStageFlags pushStages;
+    uint32_t pushOffset;
+    uint32_t pushSize;
+
+    bool operator==(const sklPipelineLayoutKey_t& _other) const
+    {
+      return setLayout == _other.setLayout && pushStages == _other.pushStages &&
+             pushOffset == _other.pushOffset && pushSize == _other.pushSize;
+    }
+  };
+
+  struct sklPipelineLayoutKeyHash_t
+  {
+    size_t operator()(const sklPipelineLayoutKey_t& _key) const
+    {
+      size_t seed = 0;
+      HashCombine(seed, reinterpret_cast<uint64_t>(_key.setLayout));
+      HashCombine(seed, _key.pushStages);
+      HashCombine(seed, _key.pushOffset);
+      HashCombine(seed, _key.pushSize);
+      return seed;
+    }
+  };
+
+  // Identifies a set by its layout and everything bound to it
+  struct sklSetKey_t
+  {
+    VkDescriptorSetLayout layout;
+    std::vector<sklDescriptorResource_t> resources;
+
+    bool operator==(const sklSetKey_t& _other) const
+    {
+      return layout == _other.layout && resources == _other.resources;
+    }
+  };
+
+  struct sklSetKeyHash_t
+  {
+    size_t operator()(const sklSetKey_t& _key) const
+    {
+      size_t seed = 0;
+      HashCombine(seed, reinterpret_cast<uint64_t>(_key.layout));
+      for (const sklDescriptorResource_t& resource : _key.resources)
+      {
+        HashCombine(seed, resource.binding);
+        HashCombine(seed, resource.type);
+        HashCombine(seed, reinterpret_cast<uint64_t>(resource.buffer));
+        HashCombine(seed, resource.offset);
+        HashCombine(seed, resource.range);
+        HashCombine(seed, reinterpret_cast<uint64_t>(resource.view));
+        HashCombine(seed, reinterpret_cast<uint64_t>(resource.sampler));
+        HashCombine(seed, resource.imageLayout);
+      }
+      return seed;
+    }
+  };
+
+  struct sklDescriptorCacheState_t
+  {
+    std::mutex lock;
+    SklDescriptorAllocator* allocator = nullptr;
+    std::unordered_map<sklSetLayoutKey_t, VkDescriptorSetLayout, sklSetLayoutKeyHash_t>
+        setLayouts;
+    std::unordered_map<sklPipelineLayoutKey_t, VkPipelineLayout, sklPipelineLayoutKeyHash_t>
+        pipelineLayouts;
+    std::unordered_map<sklSetKey_t, VkDescriptorSet, sklSetKeyHash_t> sets;
+    sklDescriptorCacheStats_t stats = {};
+  };
+
+  sklDescriptorCacheState_t& GetState()
+  {
+    static sklDescriptorCacheState_t state;
+    return state;
+  }
+}
+
+void SklDescriptorCache::Initialize(SklDescriptorAllocator* _allocator)
+{
+  sklDescriptorCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  state.allocator = _allocator;
+  state.stats = {};
+}
+
+void SklDescriptorCache::Shutdown()
+{
+  sklDescriptorCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+
+  SKL_PRINT("Descriptor Cache", "%u set layouts for %u requests, %u sets for %u requests",
+            state.stats.setLayouts, state.stats.layoutRequests, state.stats.sets,
+            state.stats.setRequests);
+
+  for (const auto& layout : state.pipelineLayouts)
+  {
+    vkDestroyPipelineLayout(vulkanContext.device, layout.second, nullptr);
+  }
+  for (const auto& layout : state.setLayouts)
+  {
+    vkDestroyDescriptorSetLayout(vulkanContext.device, layout.second, nullptr);
+  }
+
+  state.pipelineLayouts.clear();
+  state.setLayouts.clear();
+  state.sets.clear();
+  state.allocator = nullptr;
+}
+
+VkDescriptorSetLayout SklDescriptorCache::GetSetLayout(
+    const std::vector<VkDescriptorSetLayoutBinding>& _bindings)
+{
+  sklDescriptorCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  state.stats.layoutRequests++;
+
+  sklSetLayoutKey_t key = { _bindings };
+  auto cached = state.setLayouts.find(key);
+  if (cached != state.setLayouts.end())
+  {
+    return cached->second;
+  }
+
+  VkDescriptorSetLayoutCreateInfo createInfo = {};
+  createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  createInfo.bindingCount = static_cast<uint32_t>(_bindings.size());
+  createInfo.pBindings = _bindings.data();
+
+  VkDescriptorSetLayout layout;
+  SKL_ASSERT_VK(
+      vkCreateDescriptorSetLayout(vulkanContext.device, &createInfo, nullptr, &layout),
+      "Failed to create descriptor set layout");
+
+  state.setLayouts[key] = layout;
+  state.stats.setLayouts++;
+  return layout;
+}
+
+VkPipelineLayout SklDescriptorCache::GetPipelineLayout(
+    VkDescriptorSetLayout _setLayout, const VkPushConstantRange& _pushConstants /*= {}*/)
+{
+  sklDescriptorCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+
+  bool hasPushConstants = _pushConstants.size > 0;
+  sklPipelineLayoutKey_t key = { _setLayout, 0, 0, 0 };
+  if (hasPushConstants)
+  {
+    key.pushStages = _pushConstants.stageFlags;
+    key.pushOffset = _pushConstants.offset;
+    key.pushSize = _pushConstants.size;
+  }
+
+  auto cached = state.pipelineLayouts.find(key);
+  if (cached != state.pipelineLayouts.end())
+  {
+    return cached->second;
+  }
+
+  VkPipelineLayoutCreateInfo layoutInfo = {};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  layoutInfo.setLayoutCount = 1;
+  layoutInfo.pSetLayouts = &_setLayout;
+  layoutInfo.pushConstantRangeCount = hasPushConstants ? 1 : 0;
+  layoutInfo.pPushConstantRanges = hasPushConstants ? &_pushConstants : nullptr;
+
+  VkPipelineLayout layout;
+  SKL_ASSERT_VK(
+      vkCreatePipelineLayout(vulkanContext.device, &layoutInfo, nullptr, &layout),
+      "Failed to create pipeline layout");
+
+  state.pipelineLayouts[key] = layout;
+  state.stats.pipelineLayouts++;
+  return layout;
+}
+
+VkDescriptorSet SklDescriptorCache::GetSet(VkDescriptorSetLayout _layout,
+                                           const std::vector<sklDescriptorResource_t>& _resources)
+{
+  sklDescriptorCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  state.stats.setRequests++;
+
+  sklSetKey_t key = { _layout, _resources };
+  auto cached = state.sets.find(key);
+  if (cached != state.sets.end())
+  {
+    return cached->second;
+  }
+
+  VkDescriptorSet set = state.allocator->Allocate(_layout);
+
+  WriteSet(set, _resources);
+
+  state.sets[key] = set;
+  state.stats.sets++;
+  return set;
+}
+
+void SklDescriptorCache::WriteSet(VkDescriptorSet _set,
+                                  const std::vector<sklDescriptorResource_t>& _resources)
+{
+  // Infos are sized up front so the writes can point into them
+  std::vector<VkDescriptorBufferInfo> bufferInfos(_resources.size());
+  std::vector<VkDescriptorImageInfo> imageInfos(_resources.size());
+  std::vector<VkWriteDescriptorSet> writeSets(_resources.size());
+
+  for (uint32_t i = 0; i < _resources.size(); i++)
+  {
+    const sklDescriptorResource_t& resource = _resources[i];
+
+    writeSets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeSets[i].dstSet = _set;
+    writeSets[i].dstBinding = resource.binding;
+    writeSets[i].dstArrayElement = 0;
+    writeSets[i].descriptorType = resource.type;
+    writeSets[i].descriptorCount = 1;
+
+    if (resource.buffer != VK_NULL_HANDLE)
+    {
+      bufferInfos[i].buffer = resource.buffer;
+      bufferInfos[i].offset = resource.offset;
+      bufferInfos[i].range = resource.range;
+      writeSets[i].pBufferInfo = &bufferInfos[i];
+    }
+    else
+    {
+      imageInfos[i].imageLayout = resource.imageLayout;
+      imageInfos[i].sampler = resource.sampler;
+      imageInfos[i].imageView = resource.view;
+      writeSets[i].pImageInfo = &imageInfos[i];
+    }
+  }
+
+  vkUpdateDescriptorSets(vulkanContext.device, static_cast<uint32_t>(writeSets.size()),
+                         writeSets.data(), 0, nullptr);
+}
+
+sklDescriptorCacheStats_t SklDescriptorCache::GetStats()
+{
+  sklDescriptorCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  return state.stats;
+}
@@ -0,0 +1,80 @@
+
+#ifndef SKELETON_RENDERER_DESCRIPTOR_CACHE_H
+#define SKELETON_RENDERER_DESCRIPTOR_CACHE_H 1
+
+#include <cstdint>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+class SklDescriptorAllocator;
+
+// A resource bound to one binding of a descriptor set
+// Buffers use buffer, offset, and range, images use view, sampler, and imageLayout
+struct sklDescriptorResource_t
+{
+  uint32_t binding;
+  VkDescriptorType type;
+  VkBuffer buffer;
+  VkDeviceSize offset;
+  VkDeviceSize range;
+  VkImageView view;
+  VkSampler sampler;
+  VkImageLayout imageLayout;
+
+  bool operator==(const sklDescriptorResource_t& _other) const
+  {
+    return binding == _other.binding && type == _other.type && buffer == _other.buffer &&
+           offset == _other.offset && range == _other.range && view == _other.view &&
+           sampler == _other.sampler && imageLayout == _other.imageLayout;
+  }
+};
+
+// How many layouts and sets the cache holds and how often it was able to share them
+struct sklDescriptorCacheStats_t
+{
+  uint32_t setLayouts;       // Distinct descriptor set layouts created
+  uint32_t pipelineLayouts;  // Distinct pipeline layouts created
+  uint32_t sets;             // Distinct descriptor sets allocated
+  uint32_t layoutRequests;   // Set layouts requested, including those already cached
+  uint32_t setRequests;      // Descriptor sets requested, including those already cached
+};
+
+// Shares descriptor set layouts, pipeline layouts, and descriptor sets between their users
+// Layouts are keyed by their bindings, so programs with the same binding signature share
+//   layouts and stay pipeline-layout compatible
+// Sets are keyed by their layout and bound resources, so identical materials share one set
+class SklDescriptorCache
+{
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Begins caching, cached sets are allocated from _allocator
+  static void Initialize(SklDescriptorAllocator* _allocator);
+  // Destroys every cached layout, sets are freed with the allocator's pools
+  static void Shutdown();
+
+  // Retrieves the layout for a list of bindings, creating it if it is new
+  static VkDescriptorSetLayout GetSetLayout(
+      const std::vector<VkDescriptorSetLayoutBinding>& _bindings);
+  // Retrieves a pipeline layout using a single set layout and at most one push constant range,
+  //   creating it if it is new
+  // A range with a size of 0 declares no push constants
+  static VkPipelineLayout GetPipelineLayout(VkDescriptorSetLayout _setLayout,
+                                            const VkPushConstantRange& _pushConstants = {});
+  // Retrieves a set with the given layout and resources, allocating and writing it if it is new
+  // Each resource is written to the binding it names
+  static VkDescriptorSet GetSet(VkDescriptorSetLayout _layout,
+                                const std::vector<sklDescriptorResource_t>& _resources);
+
+  // Writes each resource to the binding it names in a set the cache does not own
+  static void WriteSet(VkDescriptorSet _set,
+                       const std::vector<sklDescriptorResource_t>& _resources);
+
+  // Retrieves how many layouts and sets have been created and requested
+  static sklDescriptorCacheStats_t GetStats();
+
+}; // class SklDescriptorCache
+
+#endif // !SKELETON_RENDERER_DESCRIPTOR_CACHE_H
@@ -0,0 +1,265 @@
+
+#include "pch.h"
+#include "skeleton/renderer/gpu_profiler.h"
+
+#include <cstring>
+
+#include "skeleton/renderer/vulkan_context.h"
+#include "skeleton/core/debug_tools.h"
+#include "skeleton/core/profiler.h"
+
+// The counters gathered by statistics queries, results are returned in this bit order
+#define SKL_GPU_PROFILER_STATISTICS                                   \
+  (VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |          \
+   VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |        \
+   VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |        \
+   VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |              \
+   VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT)
+
+SklGpuProfiler::SklGpuProfiler(uint32_t _slotCount, uint32_t _maxScopes /*= 32*/,
+                               bool _pipelineStatistics /*= false*/) : maxScopes(_maxScopes)
+{
+  uint32_t validBits =
+      vulkanContext.gpu.queueFamilyProperties[vulkanContext.graphicsIdx].timestampValidBits;
+  if (validBits == 0)
+  {
+    SKL_PRINT_DEBUG("GPU Profiler",
+                    "Graphics queue does not support timestamps, GPU profiling disabled");
+    return;
+  }
+
+  supported = true;
+  timestampPeriod = vulkanContext.gpu.properties.limits.timestampPeriod;
+  timestampMask = (validBits >= 64) ? ~0ull : ((1ull << validBits) - 1);
+  collectStatistics = _pipelineStatistics && vulkanContext.gpu.features.pipelineStatisticsQuery;
+  if (_pipelineStatistics && !collectStatistics)
+  {
+    SKL_PRINT_DEBUG("GPU Profiler", "Pipeline statistics queries are not supported");
+  }
+
+  slots.resize(_slotCount);
+  for (auto& slot : slots)
+  {
+    VkQueryPoolCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    createInfo.queryCount = maxScopes * 2;
+
+    SKL_ASSERT_VK(
+        vkCreateQueryPool(vulkanContext.device, &createInfo, nullptr, &slot.timestampPool),
+        "Failed to create timestamp query pool");
+
+    if (collectStatistics)
+    {
+      createInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+      createInfo.queryCount = maxScopes;
+      createInfo.pipelineStatistics = SKL_GPU_PROFILER_STATISTICS;
+
+      SKL_ASSERT_VK(
+          vkCreateQueryPool(vulkanContext.device, &createInfo, nullptr, &slot.statisticsPool),
+          "Failed to create pipeline statistics query pool");
+    }
+  }
+
+  Calibrate();
+}
+
+SklGpuProfiler::~SklGpuProfiler()
+{
+  for (auto& slot : slots)
+  {
+    vkDestroyQueryPool(vulkanContext.device, slot.timestampPool, nullptr);
+    if (slot.statisticsPool != VK_NULL_HANDLE)
+    {
+      vkDestroyQueryPool(vulkanContext.device, slot.statisticsPool, nullptr);
+    }
+  }
+}
+
+void SklGpuProfiler::Calibrate()
+{
+  VkQueryPool pool = slots.empty() ? VK_NULL_HANDLE : slots[0].timestampPool;
+  if (pool == VK_NULL_HANDLE)
+    return;
+
+  VkCommandBuffer command =
+      vulkanContext.BeginSingleTimeCommand(vulkanContext.graphicsCommandPool);
+  vkCmdResetQueryPool(command, pool, 0, 1);
+  vkCmdWriteTimestamp(command, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool, 0);
+
+  // The timestamp is assumed to land halfway between submission and completion
+  uint64_t cpuBefore = SklProfiler::Now();
+  vulkanContext.EndSingleTimeCommand(command, vulkanContext.graphicsCommandPool,
+                                     vulkanContext.graphicsQueue);
+  uint64_t cpuAfter = SklProfiler::Now();
+
+  uint64_t timestamp = 0;
+  if (vkGetQueryPoolResults(vulkanContext.device, pool, 0, 1, sizeof(uint64_t), &timestamp,
+                            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+  {
+    return;
+  }
+
+  uint64_t gpuNs = static_cast<uint64_t>((timestamp & timestampMask) * (double)timestampPeriod);
+  cpuOffsetNs = static_cast<int64_t>(cpuBefore + (cpuAfter - cpuBefore) / 2) -
+                static_cast<int64_t>(gpuNs);
+}
+
+//=================================================
+// Recording
+//=================================================
+
+void SklGpuProfiler::BeginRecording(VkCommandBuffer _command, uint32_t _slot)
+{
+  if (!supported)
+    return;
+
+  sklGpuProfilerSlot_t& slot = slots[_slot];
+  slot.scopes.clear();
+  slot.openScopes.clear();
+  slot.statisticsCount = 0;
+  slot.pending = false;
+
+  vkCmdResetQueryPool(_command, slot.timestampPool, 0, maxScopes * 2);
+  if (slot.statisticsPool != VK_NULL_HANDLE)
+  {
+    vkCmdResetQueryPool(_command, slot.statisticsPool, 0, maxScopes);
+  }
+}
+
+void SklGpuProfiler::BeginScope(VkCommandBuffer _command, uint32_t _slot, const char* _name)
+{
+  if (!supported)
+    return;
+
+  sklGpuProfilerSlot_t& slot = slots[_slot];
+  uint32_t index = static_cast<uint32_t>(slot.scopes.size());
+
+  // Keep begin and end paired even when out of queries
+  if (index >= maxScopes)
+  {
+    slot.openScopes.push_back(-1);
+    return;
+  }
+
+  // Statistics queries of one pool cannot be nested
+  sklGpuScope_t scope = { _name, static_cast<uint32_t>(slot.openScopes.size()), uint32_t(-1) };
+  if (slot.statisticsPool != VK_NULL_HANDLE && scope.depth == 0)
+  {
+    scope.statisticsQuery = slot.statisticsCount++;
+    vkCmdBeginQuery(_command, slot.statisticsPool, scope.statisticsQuery, 0);
+  }
+
+  vkCmdWriteTimestamp(_command, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slot.timestampPool,
+                      index * 2);
+
+  slot.scopes.push_back(scope);
+  slot.openScopes.push_back(index);
+}
+
+void SklGpuProfiler::EndScope(VkCommandBuffer _command, uint32_t _slot)
+{
+  if (!supported)
+    return;
+
+  sklGpuProfilerSlot_t& slot = slots[_slot];
+  if (slot.openScopes.empty())
+  {
+    SKL_LOG(SKL_ERROR, "GPU profiler scope ended without being begun");
+    return;
+  }
+
+  uint32_t index = slot.openScopes.back();
+  slot.openScopes.pop_back();
+  if (index == uint32_t(-1))
+    return;
+
+  vkCmdWriteTimestamp(_command, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, slot.timestampPool,
+                      index * 2 + 1);
+
+  const sklGpuScope_t& scope = slot.scopes[index];
+  if (scope.statisticsQuery != uint32_t(-1))
+  {
+    vkCmdEndQuery(_command, slot.statisticsPool, scope.statisticsQuery);
+  }
+}
+
+//=================================================
+// Results
+//=================================================
+
+void SklGpuProfiler::MarkSubmitted(uint32_t _slot)
+{
+  if (supported)
+  {
+    slots[_slot].pending = !slots[_slot].scopes.empty();
+  }
+}
+
+bool SklGpuProfiler::Collect(uint32_t _slot)
+{
+  if (!supported || !slots[_slot].pending)
+    return false;
+
+  sklGpuProfilerSlot_t& slot = slots[_slot];
+  uint32_t scopeCount = static_cast<uint32_t>(slot.scopes.size());
+
+  // Never waits, results that are not yet available are skipped
+  std::vector<uint64_t> timestamps(scopeCount * 2);
+  if (vkGetQueryPoolResults(vulkanContext.device, slot.timestampPool, 0, scopeCount * 2,
+                            timestamps.size() * sizeof(uint64_t), timestamps.data(),
+                            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+  {
+    return false;
+  }
+
+  std::vector<sklGpuPipelineStats_t> statistics(slot.statisticsCount);
+  if (slot.statisticsCount > 0 &&
+      vkGetQueryPoolResults(vulkanContext.device, slot.statisticsPool, 0, slot.statisticsCount,
+                            statistics.size() * sizeof(sklGpuPipelineStats_t),
+                            statistics.data(), sizeof(sklGpuPipelineStats_t),
+                            VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+  {
+    return false;
+  }
+
+  bool capturing = SklProfiler::IsCapturing();
+
+  results.resize(scopeCount);
+  for (uint32_t i = 0; i < scopeCount; i++)
+  {
+    const sklGpuScope_t& scope = slot.scopes[i];
+    uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & timestampMask;
+
+    if (capturing)
+    {
+      uint64_t start = static_cast<uint64_t>(
+          cpuOffsetNs + static_cast<int64_t>((timestamps[i * 2] & timestampMask) *
+                                             (double)timestampPeriod));
+      SklProfiler::RecordGpuZone(scope.name, start,
+                                 start + static_cast<uint64_t>(ticks * (double)timestampPeriod));
+    }
+
+    results[i].name = scope.name;
+    results[i].depth = scope.depth;
+    results[i].ms = static_cast<float>(ticks * timestampPeriod / 1000000.0);
+    results[i].hasStatistics = scope.statisticsQuery != uint32_t(-1);
+    results[i].statistics = results[i].hasStatistics ? statistics[scope.statisticsQuery]
+                                                     : sklGpuPipelineStats_t{};
+  }
+
+  slot.pending = false;
+  return true;
+}
+
+float SklGpuProfiler::GetScopeTime(const char* _name) const
+{
+  for (const auto& result : results)
+  {
+    if (std::strcmp(result.name, _name) == 0)
+    {
+      return result.ms;
+    }
+  }
+  return 0.f;
+}
@@ -0,0 +1,114 @@
+
+#ifndef SKELETON_RENDERER_GPU_PROFILER_H
+#define SKELETON_RENDERER_GPU_PROFILER_H 1
+
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+// Counters gathered by a pipeline statistics query
+struct sklGpuPipelineStats_t
+{
+  uint64_t inputVertices;           // Vertices read by the input assembler
+  uint64_t inputPrimitives;         // Primitives assembled
+  uint64_t vertexInvocations;       // Vertex shader invocations
+  uint64_t clippedPrimitives;       // Primitives output by the clipping stage
+  uint64_t fragmentInvocations;     // Fragment shader invocations
+};
+
+// The measured cost of one scope in the most recently collected frame
+struct sklGpuScopeTime_t
+{
+  const char* name;
+  uint32_t depth;                    // Number of scopes this is nested within
+  float ms;                          // Time between the scope's start and end on the GPU
+  bool hasStatistics;                // Only top-level scopes collect pipeline statistics
+  sklGpuPipelineStats_t statistics;
+};
+
+// Times named scopes within command buffers using timestamp queries
+// Each frame in flight gets its own slot of query pools, results are read after the frame's
+//   fence has signalled so reading never stalls
+class SklGpuProfiler
+{
+  //=================================================
+  // Variables
+  //=================================================
+private:
+  // A scope recorded into a slot's command buffer
+  struct sklGpuScope_t
+  {
+    const char* name;
+    uint32_t depth;
+    uint32_t statisticsQuery;  // -1 when the scope does not collect statistics
+  };
+
+  // The queries of a single frame
+  struct sklGpuProfilerSlot_t
+  {
+    VkQueryPool timestampPool = VK_NULL_HANDLE;
+    VkQueryPool statisticsPool = VK_NULL_HANDLE;
+    std::vector<sklGpuScope_t> scopes;
+    std::vector<uint32_t> openScopes;
+    uint32_t statisticsCount = 0;
+    bool pending = false;  // Submitted with results that have not been collected
+  };
+
+  std::vector<sklGpuProfilerSlot_t> slots;
+  uint32_t maxScopes;
+  bool supported = false;
+  bool collectStatistics = false;
+  float timestampPeriod = 0.f;  // Nanoseconds per timestamp tick
+  uint64_t timestampMask = 0;   // Bits of a timestamp that are valid
+  int64_t cpuOffsetNs = 0;      // Added to a timestamp in nanoseconds to place it on the CPU clock
+
+  std::vector<sklGpuScopeTime_t> results;
+
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Creates query pools for _slotCount frames, each holding up to _maxScopes scopes
+  // _pipelineStatistics is ignored when the device does not support statistics queries
+  SklGpuProfiler(uint32_t _slotCount, uint32_t _maxScopes = 32, bool _pipelineStatistics = false);
+  // Destroys all query pools
+  ~SklGpuProfiler();
+
+  // Whether the graphics queue can write timestamps
+  bool IsSupported() const { return supported; }
+  // Whether top-level scopes collect pipeline statistics
+  bool CollectsStatistics() const { return collectStatistics; }
+  // Number of frames the profiler has queries for
+  uint32_t GetSlotCount() const { return static_cast<uint32_t>(slots.size()); }
+
+private:
+  // Estimates the offset between GPU timestamps and the CPU profiler's clock
+  void Calibrate();
+
+public:
+  // Recording
+  //=================================================
+
+  // Resets a slot's queries, must be recorded outside of a renderpass before any scopes
+  void BeginRecording(VkCommandBuffer _command, uint32_t _slot);
+  // Writes a scope's starting timestamp
+  void BeginScope(VkCommandBuffer _command, uint32_t _slot, const char* _name);
+  // Writes the ending timestamp of the most recently begun scope
+  void EndScope(VkCommandBuffer _command, uint32_t _slot);
+
+  // Results
+  //=================================================
+
+  // Records that a slot's command buffer has been submitted
+  void MarkSubmitted(uint32_t _slot);
+  // Reads a slot's results if its last submission has finished, returns true on success
+  // Scopes are forwarded to the CPU profiler while it is capturing
+  bool Collect(uint32_t _slot);
+  // Retrieves every scope of the most recently collected frame
+  const std::vector<sklGpuScopeTime_t>& GetScopeTimes() const { return results; }
+  // Retrieves a scope's time in the most recently collected frame, 0 if it was not found
+  float GetScopeTime(const char* _name) const;
+
+}; // class SklGpuProfiler
+
+#endif // !SKELETON_RENDERER_GPU_PROFILER_H
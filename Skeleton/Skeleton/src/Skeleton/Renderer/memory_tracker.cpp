@@ -0,0 +1,302 @@
+
+#include "pch.h"
+#include "skeleton/renderer/memory_tracker.h"
+
+#include <mutex>
+#include <algorithm>
+#include <unordered_map>
+
+#include "skeleton/renderer/vulkan_context.h"
+#include "skeleton/core/debug_tools.h"
+
+// Fraction of a heap treated as the budget when the driver cannot report one
+#define SKL_MEMORY_DEFAULT_BUDGET_FRACTION 0.8
+
+namespace
+{
+  // The size, heap, and category of a live allocation
+  struct sklMemoryAllocation_t
+  {
+    VkDeviceSize size;
+    uint32_t heapIndex;
+    sklMemoryCategory category;
+  };
+
+  struct sklMemoryTrackerState_t
+  {
+    std::mutex lock;
+    bool memoryBudget = false;
+    std::vector<sklMemoryHeapStats_t> heaps;
+    std::vector<VkDeviceSize> budgetOverrides;
+    sklMemoryCategoryStats_t categories[Skl_Memory_Category_Count] = {};
+    std::unordered_map<VkDeviceMemory, sklMemoryAllocation_t> allocations;
+    sklMemoryEvictionCallback evictionCallback;
+  };
+
+  sklMemoryTrackerState_t& GetState()
+  {
+    static sklMemoryTrackerState_t state;
+    return state;
+  }
+
+  // Fills each heap's budget and driver usage, lock must be held
+  void QueryBudgets(sklMemoryTrackerState_t& _state)
+  {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    if (_state.memoryBudget)
+    {
+      VkPhysicalDeviceMemoryProperties2 properties = {};
+      properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+      properties.pNext = &budgetProperties;
+      vkGetPhysicalDeviceMemoryProperties2(vulkanContext.gpu.device, &properties);
+    }
+
+    for (uint32_t i = 0; i < _state.heaps.size(); i++)
+    {
+      sklMemoryHeapStats_t& heap = _state.heaps[i];
+      if (_state.memoryBudget)
+      {
+        heap.budget = budgetProperties.heapBudget[i];
+        heap.driverUsage = budgetProperties.heapUsage[i];
+      }
+      else
+      {
+        heap.budget = static_cast<VkDeviceSize>(heap.size * SKL_MEMORY_DEFAULT_BUDGET_FRACTION);
+        heap.driverUsage = heap.current;
+      }
+
+      if (_state.budgetOverrides[i] != 0)
+      {
+        // The driver's usage includes memory this tracker cannot see, only ours counts here
+        heap.budget = _state.budgetOverrides[i];
+        heap.driverUsage = heap.current;
+      }
+    }
+  }
+
+  // Converts bytes to mebibytes for printing
+  double ToMiB(VkDeviceSize _bytes)
+  {
+    return _bytes / (1024.0 * 1024.0);
+  }
+}
+
+void SklMemoryTracker::Initialize(bool _memoryBudget)
+{
+  sklMemoryTrackerState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+
+  const VkPhysicalDeviceMemoryProperties& properties = vulkanContext.gpu.memProperties;
+  state.memoryBudget = _memoryBudget;
+  state.heaps.resize(properties.memoryHeapCount);
+  state.budgetOverrides.resize(properties.memoryHeapCount, 0);
+  for (uint32_t i = 0; i < properties.memoryHeapCount; i++)
+  {
+    state.heaps[i] = {};
+    state.heaps[i].size = properties.memoryHeaps[i].size;
+    state.heaps[i].deviceLocal =
+        (properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+  }
+
+  SKL_PRINT_DEBUG("Memory", "%u heaps, budgets %s", properties.memoryHeapCount,
+                  _memoryBudget ? "reported by the driver" : "estimated");
+}
+
+//=================================================
+// Allocation
+//=================================================
+
+VkResult SklMemoryTracker::Allocate(const VkMemoryAllocateInfo& _allocInfo,
+                                    sklMemoryCategory _category, VkDeviceMemory* _memory)
+{
+  sklMemoryTrackerState_t& state = GetState();
+  uint32_t heapIndex =
+      vulkanContext.gpu.memProperties.memoryTypes[_allocInfo.memoryTypeIndex].heapIndex;
+
+  // The callback frees memory through the tracker, so it must run without the lock
+  sklMemoryEvictionCallback callback;
+  bool overBudget = false;
+  {
+    std::lock_guard<std::mutex> guard(state.lock);
+    QueryBudgets(state);
+    const sklMemoryHeapStats_t& heap = state.heaps[heapIndex];
+    overBudget = heap.driverUsage + _allocInfo.allocationSize > heap.budget;
+    callback = state.evictionCallback;
+  }
+
+  if (overBudget)
+  {
+    SKL_PRINT_WARNING("Memory", "Allocating %.2f MiB of %s exceeds heap %u's budget",
+                      ToMiB(_allocInfo.allocationSize), GetCategoryName(_category), heapIndex);
+    if (callback)
+    {
+      callback(heapIndex, _allocInfo.allocationSize);
+    }
+  }
+
+  VkResult result = vkAllocateMemory(vulkanContext.device, &_allocInfo, nullptr, _memory);
+
+  // Give the application one chance to make room when the driver refuses outright
+  if ((result == VK_ERROR_OUT_OF_DEVICE_MEMORY || result == VK_ERROR_OUT_OF_HOST_MEMORY) &&
+      callback && callback(heapIndex, _allocInfo.allocationSize))
+  {
+    result = vkAllocateMemory(vulkanContext.device, &_allocInfo, nullptr, _memory);
+  }
+
+  if (result != VK_SUCCESS)
+  {
+    return result;
+  }
+
+  std::lock_guard<std::mutex> guard(state.lock);
+  state.allocations[*_memory] = { _allocInfo.allocationSize, heapIndex, _category };
+
+  sklMemoryHeapStats_t& heap = state.heaps[heapIndex];
+  heap.current += _allocInfo.allocationSize;
+  heap.peak = std::max(heap.peak, heap.current);
+  heap.allocationCount++;
+
+  sklMemoryCategoryStats_t& category = state.categories[_category];
+  category.current += _allocInfo.allocationSize;
+  category.peak = std::max(category.peak, category.current);
+  category.allocationCount++;
+
+  return result;
+}
+
+void SklMemoryTracker::Free(VkDeviceMemory _memory)
+{
+  if (_memory == VK_NULL_HANDLE)
+    return;
+
+  vkFreeMemory(vulkanContext.device, _memory, nullptr);
+
+  sklMemoryTrackerState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  auto allocation = state.allocations.find(_memory);
+  if (allocation == state.allocations.end())
+  {
+    SKL_LOG(SKL_ERROR, "Freed memory that was not allocated through the tracker");
+    return;
+  }
+
+  sklMemoryHeapStats_t& heap = state.heaps[allocation->second.heapIndex];
+  heap.current -= allocation->second.size;
+  heap.allocationCount--;
+
+  sklMemoryCategoryStats_t& category = state.categories[allocation->second.category];
+  category.current -= allocation->second.size;
+  category.allocationCount--;
+
+  state.allocations.erase(allocation);
+}
+
+sklMemoryCategory SklMemoryTracker::CategorizeBuffer(VkBufferUsageFlags _usage)
+{
+  if (_usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+    return Skl_Memory_Vertex;
+  if (_usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
+    return Skl_Memory_Index;
+  if (_usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+    return Skl_Memory_Uniform;
+  // Buffers used only for transfers carry data to or from other resources
+  if ((_usage & ~(VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)) == 0)
+    return Skl_Memory_Staging;
+  return Skl_Memory_Other;
+}
+
+sklMemoryCategory SklMemoryTracker::CategorizeImage(VkImageUsageFlags _usage)
+{
+  if (_usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
+    return Skl_Memory_Depth;
+  if (_usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
+    return Skl_Memory_Render_Target;
+  if (_usage & VK_IMAGE_USAGE_SAMPLED_BIT)
+    return Skl_Memory_Texture;
+  return Skl_Memory_Other;
+}
+
+//=================================================
+// Budgets
+//=================================================
+
+void SklMemoryTracker::SetEvictionCallback(const sklMemoryEvictionCallback& _callback)
+{
+  sklMemoryTrackerState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  state.evictionCallback = _callback;
+}
+
+void SklMemoryTracker::SetBudgetOverride(uint32_t _heapIndex, VkDeviceSize _bytes)
+{
+  sklMemoryTrackerState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  if (_heapIndex < state.budgetOverrides.size())
+  {
+    state.budgetOverrides[_heapIndex] = _bytes;
+  }
+}
+
+//=================================================
+// Statistics
+//=================================================
+
+sklMemoryStats_t SklMemoryTracker::GetStats()
+{
+  sklMemoryTrackerState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  QueryBudgets(state);
+
+  sklMemoryStats_t stats;
+  stats.driverBudget = state.memoryBudget;
+  stats.heaps = state.heaps;
+  for (uint32_t i = 0; i < Skl_Memory_Category_Count; i++)
+  {
+    stats.categories[i] = state.categories[i];
+  }
+  return stats;
+}
+
+void SklMemoryTracker::PrintStats()
+{
+  sklMemoryStats_t stats = GetStats();
+
+  SKL_PRINT("Memory", "Usage :--: budgets %s",
+            stats.driverBudget ? "reported by the driver" : "estimated");
+  for (uint32_t i = 0; i < stats.heaps.size(); i++)
+  {
+    const sklMemoryHeapStats_t& heap = stats.heaps[i];
+    SKL_PRINT_SLIM("\tHeap %u (%s) :--: %9.2f MiB current, %9.2f MiB peak, "
+                   "%9.2f / %9.2f MiB budget, %u allocations",
+                   i, heap.deviceLocal ? "device" : "host  ", ToMiB(heap.current),
+                   ToMiB(heap.peak), ToMiB(heap.driverUsage), ToMiB(heap.budget),
+                   heap.allocationCount);
+  }
+  for (uint32_t i = 0; i < Skl_Memory_Category_Count; i++)
+  {
+    const sklMemoryCategoryStats_t& category = stats.categories[i];
+    if (category.peak == 0)
+      continue;
+
+    SKL_PRINT_SLIM("\t%-13s :--: %9.2f MiB current, %9.2f MiB peak, %u allocations",
+                   GetCategoryName(static_cast<sklMemoryCategory>(i)), ToMiB(category.current),
+                   ToMiB(category.peak), category.allocationCount);
+  }
+}
+
+const char* SklMemoryTracker::GetCategoryName(sklMemoryCategory _category)
+{
+  switch (_category)
+  {
+  case Skl_Memory_Vertex: return "Vertex";
+  case Skl_Memory_Index: return "Index";
+  case Skl_Memory_Uniform: return "Uniform";
+  case Skl_Memory_Texture: return "Texture";
+  case Skl_Memory_Depth: return "Depth";
+  case Skl_Memory_Render_Target: return "Render Target";
+  case Skl_Memory_Staging: return "Staging";
+  default: return "Other";
+  }
+}
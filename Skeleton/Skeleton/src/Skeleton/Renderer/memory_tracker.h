@@ -0,0 +1,95 @@
+
+#ifndef SKELETON_RENDERER_MEMORY_TRACKER_H
+#define SKELETON_RENDERER_MEMORY_TRACKER_H 1
+
+#include <vector>
+#include <functional>
+
+#include "vulkan/vulkan.h"
+
+// What an allocation is used for
+typedef enum sklMemoryCategory
+{
+  Skl_Memory_Vertex,
+  Skl_Memory_Index,
+  Skl_Memory_Uniform,
+  Skl_Memory_Texture,
+  Skl_Memory_Depth,
+  Skl_Memory_Render_Target,
+  Skl_Memory_Staging,
+  Skl_Memory_Other,
+  Skl_Memory_Category_Count
+}sklMemoryCategory;
+
+// Usage of a single memory heap
+struct sklMemoryHeapStats_t
+{
+  VkDeviceSize size;          // Total size of the heap
+  VkDeviceSize budget;        // Bytes this process can use before the driver starts evicting
+  VkDeviceSize driverUsage;   // Bytes in use by this process as reported by the driver
+  VkDeviceSize current;       // Bytes currently allocated through the tracker
+  VkDeviceSize peak;          // Most bytes ever allocated through the tracker at once
+  uint32_t allocationCount;
+  bool deviceLocal;           // Device memory when set, host memory otherwise
+};
+
+// Usage of a single category across every heap
+struct sklMemoryCategoryStats_t
+{
+  VkDeviceSize current;
+  VkDeviceSize peak;
+  uint32_t allocationCount;
+};
+
+// A snapshot of all tracked memory
+struct sklMemoryStats_t
+{
+  bool driverBudget;  // Budgets and driver usage come from VK_EXT_memory_budget
+  std::vector<sklMemoryHeapStats_t> heaps;
+  sklMemoryCategoryStats_t categories[Skl_Memory_Category_Count];
+};
+
+// Called before an allocation that would exceed its heap's budget
+// Should release resources from _heapIndex, returns true if anything was released
+typedef std::function<bool(uint32_t _heapIndex, VkDeviceSize _requiredBytes)>
+    sklMemoryEvictionCallback;
+
+// Allocates and frees VkDeviceMemory while accounting for it by heap and category
+class SklMemoryTracker
+{
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Reads heap information from the selected GPU, call once after device creation
+  // _memoryBudget enables budget queries and requires VK_EXT_memory_budget to be enabled
+  static void Initialize(bool _memoryBudget);
+
+  // Allocates device memory under a category
+  // Calls the eviction callback first if the allocation would exceed its heap's budget
+  static VkResult Allocate(const VkMemoryAllocateInfo& _allocInfo, sklMemoryCategory _category,
+                           VkDeviceMemory* _memory);
+  // Frees memory allocated through the tracker
+  static void Free(VkDeviceMemory _memory);
+
+  // Picks the category for a buffer from its usage
+  static sklMemoryCategory CategorizeBuffer(VkBufferUsageFlags _usage);
+  // Picks the category for an image from its usage
+  static sklMemoryCategory CategorizeImage(VkImageUsageFlags _usage);
+
+  // Sets the function called when an allocation would exceed its heap's budget
+  static void SetEvictionCallback(const sklMemoryEvictionCallback& _callback);
+  // Limits a heap to _bytes regardless of what the driver reports, 0 removes the limit
+  // Lets smaller machines be emulated when sizing scenes
+  static void SetBudgetOverride(uint32_t _heapIndex, VkDeviceSize _bytes);
+
+  // Retrieves current usage, queries the driver's budget if available
+  static sklMemoryStats_t GetStats();
+  // Prints usage per heap and per category
+  static void PrintStats();
+  // Retrieves a category's name
+  static const char* GetCategoryName(sklMemoryCategory _category);
+
+}; // class SklMemoryTracker
+
+#endif // !SKELETON_RENDERER_MEMORY_TRACKER_H
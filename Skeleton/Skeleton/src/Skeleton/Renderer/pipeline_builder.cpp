@@ -0,0 +1,185 @@
+
+#include "pch.h"
+#include "skeleton/renderer/pipeline_builder.h"
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "skeleton/renderer/shader_program.h"
+#include "skeleton/renderer/shader_module_cache.h"
+#include "skeleton/renderer/vulkan_context.h"
+#include "skeleton/core/debug_tools.h"
+#include "skeleton/core/profiler.h"
+
+namespace
+{
+  struct sklPipelineBuilderState_t
+  {
+    std::mutex lock;
+    std::condition_variable workSignal;
+    std::deque<std::packaged_task<VkPipeline()>> queue;
+    std::vector<std::thread> workers;
+    std::unordered_map<sklPipelineState_t, std::shared_future<VkPipeline>> pipelines;
+    uint32_t pendingCount = 0;
+    bool shuttingDown = false;
+  };
+
+  sklPipelineBuilderState_t& GetState()
+  {
+    static sklPipelineBuilderState_t state;
+    return state;
+  }
+
+  // Compiles queued pipelines until shutdown
+  void WorkerLoop(uint32_t _index)
+  {
+    SklProfiler::SetThreadName(("Pipeline Worker " + std::to_string(_index)).c_str());
+
+    sklPipelineBuilderState_t& state = GetState();
+    std::unique_lock<std::mutex> guard(state.lock);
+
+    while (true)
+    {
+      state.workSignal.wait(guard, [&]() { return state.shuttingDown || !state.queue.empty(); });
+      if (state.queue.empty())
+      {
+        return;
+      }
+
+      std::packaged_task<VkPipeline()> task = std::move(state.queue.front());
+      state.queue.pop_front();
+
+      // Failures are stored in the task's future and rethrown by whoever waits on it
+      guard.unlock();
+      task();
+      guard.lock();
+
+      state.pendingCount--;
+    }
+  }
+}
+
+void SklPipelineBuilder::Initialize(uint32_t _workerCount /*= 0*/)
+{
+  sklPipelineBuilderState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  if (!state.workers.empty())
+    return;
+
+  if (_workerCount == 0)
+  {
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    _workerCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+  }
+
+  state.shuttingDown = false;
+  for (uint32_t i = 0; i < _workerCount; i++)
+  {
+    state.workers.emplace_back(WorkerLoop, i);
+  }
+
+  SKL_PRINT_DEBUG("Pipeline Builder", "Compiling pipelines on %u threads", _workerCount);
+}
+
+void SklPipelineBuilder::Shutdown()
+{
+  sklPipelineBuilderState_t& state = GetState();
+  std::vector<std::thread> workers;
+  {
+    std::lock_guard<std::mutex> guard(state.lock);
+    state.shuttingDown = true;
+    workers.swap(state.workers);
+  }
+  state.workSignal.notify_all();
+
+  // Workers drain the queue before exiting so no submitted future is left unsatisfied
+  for (auto& w : workers)
+  {
+    w.join();
+  }
+
+  std::lock_guard<std::mutex> guard(state.lock);
+  for (auto& p : state.pipelines)
+  {
+    try
+    {
+      vkDestroyPipeline(vulkanContext.device, p.second.get(), nullptr);
+    }
+    catch (...)
+    {
+      // The failure was reported to whoever waited on the pipeline, there is nothing to free
+    }
+    SklShaderModuleCache::Release(p.first.vertModule);
+    SklShaderModuleCache::Release(p.first.fragModule);
+  }
+  state.pipelines.clear();
+}
+
+std::shared_future<VkPipeline> SklPipelineBuilder::Submit(const sklPipelineState_t& _state,
+                                                          VkPipelineLayout _pipeLayout)
+{
+  sklPipelineBuilderState_t& state = GetState();
+  std::packaged_task<VkPipeline()> task;
+  std::shared_future<VkPipeline> pipeline;
+  // Dynamic state is set while recording, so it does not distinguish pipelines
+  sklPipelineState_t key = _state;
+  if (vulkanContext.extendedDynamicState)
+  {
+    key.settings &= ~uint64_t(Skl_Pipeline_Dynamic_Bits);
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(state.lock);
+    auto existing = state.pipelines.find(key);
+    if (existing != state.pipelines.end())
+    {
+      return existing->second;
+    }
+
+    task = std::packaged_task<VkPipeline()>([key, _pipeLayout]()
+    {
+      return CreatePipeline(key, _pipeLayout);
+    });
+    pipeline = task.get_future().share();
+    state.pipelines[key] = pipeline;
+    // Keys compare module handles, so the modules must not be destroyed and their handles
+    //   reused while the pipeline is cached
+    SklShaderModuleCache::AddReference(key.vertModule);
+    SklShaderModuleCache::AddReference(key.fragModule);
+
+    if (!state.workers.empty())
+    {
+      state.queue.push_back(std::move(task));
+      state.pendingCount++;
+    }
+  }
+
+  if (task.valid())
+  {
+    task();
+  }
+  else
+  {
+    state.workSignal.notify_one();
+  }
+  return pipeline;
+}
+
+uint32_t SklPipelineBuilder::GetPendingCount()
+{
+  sklPipelineBuilderState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  return state.pendingCount;
+}
+
+uint32_t SklPipelineBuilder::GetPipelineCount()
+{
+  sklPipelineBuilderState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  return static_cast<uint32_t>(state.pipelines.size());
+}
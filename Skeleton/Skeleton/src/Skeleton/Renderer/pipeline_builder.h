@@ -0,0 +1,40 @@
+
+#ifndef SKELETON_RENDERER_PIPELINE_BUILDER_H
+#define SKELETON_RENDERER_PIPELINE_BUILDER_H 1
+
+#include <cstdint>
+#include <future>
+
+#include "vulkan/vulkan.h"
+
+struct sklPipelineState_t;
+
+// Compiles graphics pipelines on a pool of worker threads and owns them
+// Programs submit their pipeline as soon as they are created so compilation overlaps with
+//   the rest of loading, recording only waits on the pipelines it actually binds
+// Pipelines are keyed by their complete state, equal states are only compiled once
+class SklPipelineBuilder
+{
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Starts the worker threads, 0 uses one per hardware thread beyond the calling thread's
+  static void Initialize(uint32_t _workerCount = 0);
+  // Finishes every submitted pipeline, stops the worker threads, and destroys all pipelines
+  static void Shutdown();
+
+  // Retrieves the pipeline for a state, queueing it for compilation if it is new
+  // The state's shader modules and _pipeLayout must outlive the compilation
+  // Compiles on the calling thread if the builder has not been initialized
+  static std::shared_future<VkPipeline> Submit(const sklPipelineState_t& _state,
+                                               VkPipelineLayout _pipeLayout);
+
+  // Retrieves the number of pipelines queued or compiling
+  static uint32_t GetPendingCount();
+  // Retrieves the number of distinct pipelines submitted
+  static uint32_t GetPipelineCount();
+
+}; // class SklPipelineBuilder
+
+#endif // !SKELETON_RENDERER_PIPELINE_BUILDER_H
@@ -0,0 +1,223 @@
+
+#include "pch.h"
+#include "skeleton/renderer/pipeline_cache.h"
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <fstream>
+#include <cstring>
+#include <filesystem>
+
+#include "skeleton/renderer/vulkan_context.h"
+#include "skeleton/core/debug_tools.h"
+
+// Identifies a pipeline cache file, "SKPC"
+#define SKL_PIPELINE_CACHE_MAGIC 0x43504B53u
+#define SKL_PIPELINE_CACHE_VERSION 1u
+
+namespace
+{
+  // Precedes the driver's data in a cache file
+  struct sklPipelineCacheFileHeader_t
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t dataSize;
+    uint64_t checksum;  // FNV-1a of the driver's data, catches truncated or partial writes
+  };
+
+  // The header every driver writes at the start of its data
+  // Mirrors VkPipelineCacheHeaderVersionOne, which older SDK headers do not declare
+  struct sklPipelineCacheDriverHeader_t
+  {
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+  };
+
+  struct sklPipelineCacheState_t
+  {
+    std::mutex lock;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    std::string path;
+    sklPipelineCacheStats_t stats = {};
+  };
+
+  sklPipelineCacheState_t& GetState()
+  {
+    static sklPipelineCacheState_t state;
+    return state;
+  }
+
+  uint64_t Checksum(const char* _data, size_t _size)
+  {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < _size; i++)
+    {
+      hash = (hash ^ static_cast<uint8_t>(_data[i])) * 1099511628211ull;
+    }
+    return hash;
+  }
+
+  // Reads a cache file, returns nothing if it is damaged or was written by another driver
+  std::vector<char> LoadCacheFile(const char* _path)
+  {
+    std::ifstream file(_path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+      return {};
+    }
+
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+
+    sklPipelineCacheFileHeader_t header;
+    if (fileSize < sizeof(header) + sizeof(sklPipelineCacheDriverHeader_t) ||
+        !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != SKL_PIPELINE_CACHE_MAGIC || header.version != SKL_PIPELINE_CACHE_VERSION ||
+        header.dataSize != fileSize - sizeof(header))
+    {
+      SKL_PRINT_WARNING("Pipeline Cache", "\"%s\" is not a valid cache file", _path);
+      return {};
+    }
+
+    std::vector<char> data(static_cast<size_t>(header.dataSize));
+    if (!file.read(data.data(), data.size()) ||
+        Checksum(data.data(), data.size()) != header.checksum)
+    {
+      SKL_PRINT_WARNING("Pipeline Cache", "\"%s\" is damaged", _path);
+      return {};
+    }
+
+    // Drivers may reject or misread data produced by another driver or device
+    sklPipelineCacheDriverHeader_t driverHeader;
+    std::memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+    const VkPhysicalDeviceProperties& properties = vulkanContext.gpu.properties;
+    if (driverHeader.headerSize < sizeof(driverHeader) || driverHeader.headerSize > data.size() ||
+        driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+        driverHeader.vendorID != properties.vendorID ||
+        driverHeader.deviceID != properties.deviceID ||
+        std::memcmp(driverHeader.pipelineCacheUUID, properties.pipelineCacheUUID,
+                    VK_UUID_SIZE) != 0)
+    {
+      SKL_PRINT("Pipeline Cache", "\"%s\" was written by another driver or device", _path);
+      return {};
+    }
+
+    return data;
+  }
+}
+
+void SklPipelineCache::Initialize(const char* _path)
+{
+  sklPipelineCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+
+  state.path = (_path != nullptr) ? _path : "";
+  state.stats = {};
+
+  std::vector<char> initialData;
+  if (!state.path.empty())
+  {
+    initialData = LoadCacheFile(_path);
+  }
+
+  VkPipelineCacheCreateInfo createInfo = {};
+  createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  createInfo.initialDataSize = initialData.size();
+  createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+  // Data that passed validation can still be refused, start empty rather than fail
+  if (vkCreatePipelineCache(vulkanContext.device, &createInfo, nullptr, &state.cache) !=
+      VK_SUCCESS)
+  {
+    createInfo.initialDataSize = 0;
+    createInfo.pInitialData = nullptr;
+    initialData.clear();
+    SKL_ASSERT_VK(
+        vkCreatePipelineCache(vulkanContext.device, &createInfo, nullptr, &state.cache),
+        "Failed to create pipeline cache");
+  }
+
+  state.stats.warm = !initialData.empty();
+  state.stats.loadedBytes = initialData.size();
+  SKL_PRINT("Pipeline Cache", "Starting %s (%zu bytes)", state.stats.warm ? "warm" : "cold",
+            state.stats.loadedBytes);
+}
+
+void SklPipelineCache::Shutdown()
+{
+  sklPipelineCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  if (state.cache == VK_NULL_HANDLE)
+    return;
+
+  SKL_PRINT("Pipeline Cache", "%u pipelines created in %.2f ms (%.3f ms each) from a %s cache",
+            state.stats.pipelineCount, state.stats.totalMs,
+            state.stats.pipelineCount ? state.stats.totalMs / state.stats.pipelineCount : 0.0,
+            state.stats.warm ? "warm" : "cold");
+
+  if (!state.path.empty())
+  {
+    size_t dataSize = 0;
+    vkGetPipelineCacheData(vulkanContext.device, state.cache, &dataSize, nullptr);
+    std::vector<char> data(dataSize);
+    if (dataSize > 0 &&
+        vkGetPipelineCacheData(vulkanContext.device, state.cache, &dataSize, data.data()) ==
+            VK_SUCCESS)
+    {
+      sklPipelineCacheFileHeader_t header = {};
+      header.magic = SKL_PIPELINE_CACHE_MAGIC;
+      header.version = SKL_PIPELINE_CACHE_VERSION;
+      header.dataSize = dataSize;
+      header.checksum = Checksum(data.data(), dataSize);
+
+      // Write beside the old file then swap, an interrupted write never replaces a good cache
+      std::string tempPath = state.path + ".tmp";
+      bool written = false;
+      {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), dataSize);
+        written = file.good();
+      }
+
+      std::error_code error;
+      if (written)
+      {
+        std::filesystem::rename(tempPath, state.path, error);
+      }
+      if (!written || error)
+      {
+        SKL_LOG(SKL_ERROR, "Failed to write pipeline cache \"%s\"", state.path.c_str());
+        std::filesystem::remove(tempPath, error);
+      }
+    }
+  }
+
+  vkDestroyPipelineCache(vulkanContext.device, state.cache, nullptr);
+  state.cache = VK_NULL_HANDLE;
+}
+
+VkPipelineCache SklPipelineCache::Get()
+{
+  return GetState().cache;
+}
+
+void SklPipelineCache::RecordCreation(double _ms)
+{
+  sklPipelineCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  state.stats.pipelineCount++;
+  state.stats.totalMs += _ms;
+}
+
+sklPipelineCacheStats_t SklPipelineCache::GetStats()
+{
+  sklPipelineCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  return state.stats;
+}
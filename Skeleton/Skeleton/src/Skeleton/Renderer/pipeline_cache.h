@@ -0,0 +1,43 @@
+
+#ifndef SKELETON_RENDERER_PIPELINE_CACHE_H
+#define SKELETON_RENDERER_PIPELINE_CACHE_H 1
+
+#include <cstdint>
+
+#include "vulkan/vulkan.h"
+
+// How long pipeline creation has taken since the cache was initialized
+struct sklPipelineCacheStats_t
+{
+  bool warm;               // The cache was seeded with data from a previous run
+  size_t loadedBytes;      // Size of the data the cache was seeded with
+  uint32_t pipelineCount;  // Pipelines created through the cache
+  double totalMs;          // Time spent creating those pipelines
+};
+
+// Owns the VkPipelineCache every pipeline is created through
+// Its contents are loaded from disk at startup and written back at shutdown so pipelines
+//   compiled by earlier runs do not have to be compiled again
+class SklPipelineCache
+{
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Creates the cache, seeded from _path if it holds data from this driver and device
+  // A null _path keeps the cache in memory only
+  static void Initialize(const char* _path);
+  // Writes the cache back to its file and destroys it
+  static void Shutdown();
+
+  // Retrieves the cache handle, VK_NULL_HANDLE before initialization
+  static VkPipelineCache Get();
+
+  // Adds a pipeline's creation time to the statistics, safe to call from any thread
+  static void RecordCreation(double _ms);
+  // Retrieves creation statistics
+  static sklPipelineCacheStats_t GetStats();
+
+}; // class SklPipelineCache
+
+#endif // !SKELETON_RENDERER_PIPELINE_CACHE_H
@@ -2,20 +2,35 @@
 #include "pch.h"
 #include "render_backend.h"
 
+#include <cstring>
+
 #include "skeleton/core/debug_tools.h"
 #include "skeleton/core/time.h"
+#include "skeleton/renderer/memory_tracker.h"
+#include "skeleton/renderer/pipeline_builder.h"
+#include "skeleton/renderer/descriptor_cache.h"
+#include "skeleton/renderer/bindless.h"
+#include "skeleton/renderer/shader_hot_reload.h"
+#include "skeleton/renderer/shader_module_cache.h"
 
 SklVulkanContext_t vulkanContext;
 
 void SklVulkanContext_t::Cleanup()
 {
   SKL_PRINT("Vulkan Context", "Cleanup =================================================");
-  for (uint32_t i = 0; i < shaderPrograms.size(); i++)
+  // Stops submitting rebuilt pipelines before the builder goes away
+  SklShaderHotReload::Shutdown();
+  // Destroys every pipeline, programs only reference the ones they use
+  SklPipelineBuilder::Shutdown();
+  // Layouts are shared between programs with the same bindings
+  SklDescriptorCache::Shutdown();
+  SklBindless::Shutdown();
+  // Pipelines released their modules above, the shaders hold the remaining references
+  for (uint32_t i = 0; i < shaders.size(); i++)
   {
-    vkDestroyPipeline(device, shaderPrograms[i].pipeline, nullptr);
-    vkDestroyPipelineLayout(device, shaderPrograms[i].pipelineLayout, nullptr);
-    vkDestroyDescriptorSetLayout(device, shaderPrograms[i].descriptorSetLayout, nullptr);
+    SklShaderModuleCache::Release(shaders[i].module);
   }
+  SklShaderModuleCache::Shutdown();
 
   ImageManager::Cleanup();
   //BufferManager::Cleanup();
@@ -35,14 +50,24 @@ void SklVulkanContext_t::Cleanup()
 //=================================================
 
 SklRenderBackend::SklRenderBackend(SDL_Window* _window,
-                                       const std::vector<const char*>& _extraExtensions)
-                                       : window(_window)
+                                   const std::vector<const char*>& _extraExtensions,
+                                   VkExtent2D _headlessExtent /*= { 0, 0 }*/)
+                                   : window(_window), headless(_window == nullptr),
+                                     headlessExtent(_headlessExtent)
 {
   // Include the extra extensions specified
   for (const char* additionalExtension : _extraExtensions)
   {
     instanceExtensions.push_back(additionalExtension);
   }
+
+  // Nothing is presented when headless
+  if (headless)
+  {
+    deviceExtensions.clear();
+  }
+
+  RemoveUnavailableInstanceFeatures();
   CreateInstance();
   CreateDevice();
   CreateCommandPool();
@@ -53,14 +78,36 @@ SklRenderBackend::~SklRenderBackend()
 {
   vkDeviceWaitIdle(vulkanContext.device);
 
-  vkDestroyDescriptorPool(vulkanContext.device, descriptorPool, nullptr);
+  delete(descriptorAllocator);
+  for (SklDescriptorAllocator* allocator : frameDescriptorAllocators)
+  {
+    delete(allocator);
+  }
 
+  ProcessDeletions(true);
   CleanupRenderComponents();
 
+  // Destroy Sync Objects
+  for (uint32_t i = 0; i < MAX_FLIGHT_IMAGE_COUNT; i++)
+  {
+    vkDestroyFence(vulkanContext.device, flightFences[i], nullptr);
+    vkDestroySemaphore(vulkanContext.device, imageAvailableSemaphores[i], nullptr);
+    vkDestroySemaphore(vulkanContext.device, renderCompleteSemaphores[i], nullptr);
+  }
+
+  // Destroying a pool frees its command buffers
+  for (VkCommandPool pool : frameCommandPools)
+  {
+    vkDestroyCommandPool(vulkanContext.device, pool, nullptr);
+  }
+
   vkDestroyCommandPool(vulkanContext.device, vulkanContext.graphicsCommandPool, nullptr);
 
   vulkanContext.Cleanup();
-  vkDestroySurfaceKHR(instance, surface, nullptr);
+  if (surface != VK_NULL_HANDLE)
+  {
+    vkDestroySurfaceKHR(instance, surface, nullptr);
+  }
   vkDestroyInstance(instance, nullptr);
 }
 
@@ -89,7 +136,12 @@ void SklRenderBackend::CreateInstance()
       "Failed to create vkInstance");
 
   // Create the surface
-  SDL_Vulkan_CreateSurface(window, instance, &surface);
+  surface = VK_NULL_HANDLE;
+  if (!headless && !SDL_Vulkan_CreateSurface(window, instance, &surface))
+  {
+    SKL_LOG(SKL_ERROR, "SDL failed to create a surface :--: %s", SDL_GetError());
+    throw "SDL failure";
+  }
 }
 
 void SklRenderBackend::CreateDevice()
@@ -99,8 +151,9 @@ void SklRenderBackend::CreateDevice()
   VkPhysicalDevice physicalDevice;
   ChoosePhysicalDevice(physicalDevice, queueIndices[0], queueIndices[1], queueIndices[2]);
 
-  SKL_PRINT(SKL_DEBUG, "Queue indices :--: Graphics: %u :--: Present: %u :--: Transfer: %u",
-            queueIndices[0], queueIndices[1], queueIndices[2]);
+  SKL_PRINT_DEBUG("Vulkan Context",
+                  "Queue indices :--: Graphics: %u :--: Present: %u :--: Transfer: %u",
+                  queueIndices[0], queueIndices[1], queueIndices[2]);
 
   vulkanContext.gpu.device = physicalDevice;
 
@@ -108,8 +161,100 @@ void SklRenderBackend::CreateDevice()
   vulkanContext.presentIdx = queueIndices[1];
   vulkanContext.transferIdx = queueIndices[2];
 
+  // Budget queries are optional, only request them when the driver has them
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount,
+                                       availableExtensions.data());
+
+  // Cull and depth state can be set per draw, so programs differing only there share pipelines
+  VkPhysicalDeviceExtendedDynamicStateFeaturesEXT dynamicStateFeatures = {};
+  dynamicStateFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+
+  // Bindless rendering indexes large, partially bound arrays updated while in use
+  VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures = {};
+  indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  bool descriptorIndexing = false;
+
+  bool memoryBudget = false;
+  for (const auto& extension : availableExtensions)
+  {
+    if (std::strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+    {
+      memoryBudget = true;
+      deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    if (std::strcmp(extension.extensionName, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) == 0)
+    {
+      VkPhysicalDeviceFeatures2 features = {};
+      features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+      features.pNext = &dynamicStateFeatures;
+      vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+      if (dynamicStateFeatures.extendedDynamicState)
+      {
+        deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+      }
+    }
+    if (std::strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0)
+    {
+      VkPhysicalDeviceFeatures2 features = {};
+      features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+      features.pNext = &indexingFeatures;
+      vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+      descriptorIndexing = features.features.shaderSampledImageArrayDynamicIndexing &&
+                           features.features.shaderStorageBufferArrayDynamicIndexing &&
+                           indexingFeatures.runtimeDescriptorArray &&
+                           indexingFeatures.descriptorBindingPartiallyBound &&
+                           indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+                           indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind;
+      if (descriptorIndexing)
+      {
+        deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+      }
+    }
+  }
+
+  // Only the features the renderer uses are enabled
+  void* featureChain = nullptr;
+  if (dynamicStateFeatures.extendedDynamicState)
+  {
+    dynamicStateFeatures.pNext = featureChain;
+    featureChain = &dynamicStateFeatures;
+  }
+  VkPhysicalDeviceDescriptorIndexingFeatures enabledIndexing = {};
+  enabledIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  if (descriptorIndexing)
+  {
+    enabledIndexing.runtimeDescriptorArray = VK_TRUE;
+    enabledIndexing.descriptorBindingPartiallyBound = VK_TRUE;
+    enabledIndexing.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    enabledIndexing.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    enabledIndexing.pNext = featureChain;
+    featureChain = &enabledIndexing;
+  }
+
   CreateLogicalDevice({ queueIndices[0], queueIndices[1], queueIndices[2] }, deviceExtensions,
-                      validationLayer);
+                      validationLayer, featureChain);
+
+  vulkanContext.extendedDynamicState = dynamicStateFeatures.extendedDynamicState == VK_TRUE;
+  vulkanContext.bindless = descriptorIndexing;
+  if (vulkanContext.extendedDynamicState)
+  {
+    VkDevice device = vulkanContext.device;
+    vulkanContext.vkCmdSetCullModeEXT = reinterpret_cast<PFN_vkCmdSetCullModeEXT>(
+        vkGetDeviceProcAddr(device, "vkCmdSetCullModeEXT"));
+    vulkanContext.vkCmdSetFrontFaceEXT = reinterpret_cast<PFN_vkCmdSetFrontFaceEXT>(
+        vkGetDeviceProcAddr(device, "vkCmdSetFrontFaceEXT"));
+    vulkanContext.vkCmdSetDepthTestEnableEXT = reinterpret_cast<PFN_vkCmdSetDepthTestEnableEXT>(
+        vkGetDeviceProcAddr(device, "vkCmdSetDepthTestEnableEXT"));
+    vulkanContext.vkCmdSetDepthWriteEnableEXT =
+        reinterpret_cast<PFN_vkCmdSetDepthWriteEnableEXT>(
+            vkGetDeviceProcAddr(device, "vkCmdSetDepthWriteEnableEXT"));
+    vulkanContext.vkCmdSetDepthCompareOpEXT = reinterpret_cast<PFN_vkCmdSetDepthCompareOpEXT>(
+        vkGetDeviceProcAddr(device, "vkCmdSetDepthCompareOpEXT"));
+  }
 
   // Fill GPU details
   //=================================================
@@ -124,14 +269,18 @@ void SklRenderBackend::CreateDevice()
 
   vkGetPhysicalDeviceProperties(pysDevice, &pdInfo.properties);
 
-  uint32_t extensionCount;
-  vkEnumerateDeviceExtensionProperties(pysDevice, nullptr, &extensionCount, nullptr);
-  pdInfo.extensionProperties.resize(extensionCount);
-  vkEnumerateDeviceExtensionProperties(pysDevice, nullptr, &extensionCount,
-                                       pdInfo.extensionProperties.data());
+  pdInfo.extensionProperties = availableExtensions;
 
   vkGetPhysicalDeviceFeatures(pysDevice, &pdInfo.features);
   vkGetPhysicalDeviceMemoryProperties(pysDevice, &pdInfo.memProperties);
+  SklMemoryTracker::Initialize(memoryBudget);
+
+  SKL_PRINT_DEBUG("Vulkan Context", "Using \"%s\"%s", pdInfo.properties.deviceName,
+                  headless ? " headless" : "");
+
+  // Surface details
+  if (headless)
+    return;
 
   uint32_t presentModeCount;
   vkGetPhysicalDeviceSurfacePresentModesKHR(pysDevice, surface, &presentModeCount, nullptr);
@@ -166,7 +315,7 @@ void SklRenderBackend::ChoosePhysicalDevice(VkPhysicalDevice& _selectedDevice,
     uint32_t graphicsIndex;
     uint32_t presentIndex;
     uint32_t transferIndex;
-  } bestFit;
+  } bestFit = {};
 
   for (const auto& pdevice : physDevices)
   {
@@ -195,7 +344,9 @@ void SklRenderBackend::ChoosePhysicalDevice(VkPhysicalDevice& _selectedDevice,
 
     _graphicsIndex = GetQueueIndex(queueProperties, VK_QUEUE_GRAPHICS_BIT);
     _transferIndex = GetQueueIndex(queueProperties, VK_QUEUE_TRANSFER_BIT);
-    _presentIndex = GetPresentIndex(&pdevice, propertyCount, _graphicsIndex);
+    // Headless rendering never presents, graphics stands in for the present queue
+    _presentIndex = headless ? _graphicsIndex
+                             : GetPresentIndex(&pdevice, propertyCount, _graphicsIndex);
 
     if (
       features.samplerAnisotropy &&
@@ -243,31 +394,31 @@ void SklRenderBackend::CreateCommandPool()
 
 void SklRenderBackend::InitializeRenderComponents()
 {
+  // The render pass only depends on formats, keeping it through resizes keeps pipelines valid
+  CreateRenderpass();
   CreateRenderComponents();
 
-  CreateDescriptorPool();
+  CreateDescriptorAllocators();
   CreateSyncObjects();
   CreateCommandBuffers();
 }
 
 void SklRenderBackend::CreateRenderComponents()
 {
-  CreateSwapchain();
-  CreateRenderpass();
+  if (headless)
+  {
+    CreateOffscreenTargets();
+  }
+  else
+  {
+    CreateSwapchain();
+  }
   CreateDepthImage();
   CreateFramebuffers();
 }
 
 void SklRenderBackend::CleanupRenderComponents()
 {
-  // Destroy Sync Objects
-  for (uint32_t i = 0; i < MAX_FLIGHT_IMAGE_COUNT; i++)
-  {
-    vkDestroyFence(vulkanContext.device, flightFences[i], nullptr);
-    vkDestroySemaphore(vulkanContext.device, imageAvailableSemaphores[i], nullptr);
-    vkDestroySemaphore(vulkanContext.device, renderCompleteSemaphores[i], nullptr);
-  }
-
   // Destroy Framebuffers
   for (uint32_t i = 0; i < (uint32_t)frameBuffers.size(); i++)
   {
@@ -275,19 +426,22 @@ void SklRenderBackend::CleanupRenderComponents()
   }
 
   // Destroy Depth Image
-  //vkDestroyImage(vulkanContext.device, depthImage, nullptr);
-  //vkFreeMemory(vulkanContext.device, depthMemory, nullptr);
-  //vkDestroyImageView(vulkanContext.device, depthImageView, nullptr);
+  ImageManager::DestroyImage(depthImage);
+  depthImage = nullptr;
 
   // Destroy Renderpass
   //vkDestroyRenderPass(vulkanContext.device, Renderpass)
 
   // Destroy Swapchain
+  // Offscreen images are owned by the ImageManager, only their views are destroyed here
   for (const auto& view : swapchainImageViews)
   {
     vkDestroyImageView(vulkanContext.device, view, nullptr);
   }
-  vkDestroySwapchainKHR(vulkanContext.device, swapchain, nullptr);
+  if (!headless)
+  {
+    vkDestroySwapchainKHR(vulkanContext.device, swapchain, nullptr);
+  }
 }
 
 void SklRenderBackend::RecreateRenderComponents()
@@ -298,11 +452,97 @@ void SklRenderBackend::RecreateRenderComponents()
   CreateRenderComponents();
 }
 
+bool SklRenderBackend::RecreateSwapchain()
+{
+  if (headless)
+    return false;
+
+  // The surface's size has changed since it was last queried
+  VkSurfaceCapabilitiesKHR& capabilities = vulkanContext.gpu.surfaceCapabilities;
+  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vulkanContext.gpu.device, surface, &capabilities);
+
+  // A minimized window has no area, rendering resumes once it is restored
+  int width = 0, height = 0;
+  SDL_Vulkan_GetDrawableSize(window, &width, &height);
+  if (capabilities.currentExtent.width == 0 || capabilities.currentExtent.height == 0 ||
+      width == 0 || height == 0)
+  {
+    return false;
+  }
+
+  // Frames still in flight use the old components, retire them rather than waiting
+  VkSwapchainKHR oldSwapchain = swapchain;
+  std::vector<VkImageView> oldViews = swapchainImageViews;
+  std::vector<VkFramebuffer> oldFramebuffers = frameBuffers;
+  sklImage_t* oldDepthImage = depthImage;
+  DeferDeletion([=]()
+  {
+    VkDevice device = vulkanContext.device;
+    for (VkFramebuffer framebuffer : oldFramebuffers)
+    {
+      vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+    for (VkImageView view : oldViews)
+    {
+      vkDestroyImageView(device, view, nullptr);
+    }
+    ImageManager::DestroyImage(oldDepthImage);
+    vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+  });
+
+  CreateSwapchain(oldSwapchain);
+  CreateDepthImage();
+  CreateFramebuffers();
+
+  // None of the new images have been rendered to yet
+  imageIsInFlightFences.assign(swapchainImages.size(), VK_NULL_HANDLE);
+  return true;
+}
+
+//=================================================
+// Deferred Deletion
+//=================================================
+
+void SklRenderBackend::SetFramesInFlight(uint32_t _count)
+{
+  _count = glm::clamp(_count, 1u, static_cast<uint32_t>(MAX_FLIGHT_IMAGE_COUNT));
+  if (_count == presentPolicy.framesInFlight)
+    return;
+
+  // Every fence is signaled once the queued frames finish, so any of them can be used next
+  vkWaitForFences(vulkanContext.device, MAX_FLIGHT_IMAGE_COUNT, flightFences.data(), VK_TRUE,
+                  UINT64_MAX);
+  presentPolicy.framesInFlight = _count;
+  currentFrame = 0;
+}
+
+void SklRenderBackend::DeferDeletion(std::function<void()> _destroy)
+{
+  deletionQueue.push_back({ submittedFrameCount, _destroy });
+}
+
+void SklRenderBackend::ProcessDeletions(bool _all /*= false*/)
+{
+  // Waiting on this frame's fence finished the frame that last used it and all before it
+  // Assumes the most frames that can be in flight, so changing the count never frees early
+  uint64_t completedFrameCount = 0;
+  if (submittedFrameCount >= MAX_FLIGHT_IMAGE_COUNT)
+  {
+    completedFrameCount = submittedFrameCount - MAX_FLIGHT_IMAGE_COUNT + 1;
+  }
+
+  while (!deletionQueue.empty() && (_all || deletionQueue.front().frame <= completedFrameCount))
+  {
+    deletionQueue.front().destroy();
+    deletionQueue.pop_front();
+  }
+}
+
 //=================================================
 // Renderer Create Functions
 //=================================================
 
-void SklRenderBackend::CreateSwapchain()
+void SklRenderBackend::CreateSwapchain(VkSwapchainKHR _oldSwapchain /*= VK_NULL_HANDLE*/)
 {
   // Find the best surface format
   VkSurfaceFormatKHR formatInfo = vulkanContext.gpu.surfaceFormats[0];
@@ -316,15 +556,20 @@ void SklRenderBackend::CreateSwapchain()
     }
   }
 
-  // Find the best present mode
-  VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
-  for (const auto& p : vulkanContext.gpu.presentModes)
+  // Use the policy's present mode, FIFO is the only one every surface supports
+  const VkPresentModeKHR policyModes[] = { VK_PRESENT_MODE_FIFO_KHR,
+                                           VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+                                           VK_PRESENT_MODE_MAILBOX_KHR,
+                                           VK_PRESENT_MODE_IMMEDIATE_KHR };
+  VkPresentModeKHR presentMode = policyModes[presentPolicy.mode];
+  const std::vector<VkPresentModeKHR>& supportedModes = vulkanContext.gpu.presentModes;
+  if (std::find(supportedModes.begin(), supportedModes.end(), presentMode) ==
+      supportedModes.end())
   {
-    if (p == VK_PRESENT_MODE_MAILBOX_KHR)
-    {
-      presentMode = p;
-      break;
-    }
+    SKL_PRINT_WARNING("Vulkan Context", "The %s present mode is unsupported, using FIFO",
+                      SklPresentModeName(presentPolicy.mode));
+    presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    presentPolicy.mode = Skl_Present_Fifo;
   }
 
   // Get the device's extent
@@ -347,6 +592,10 @@ void SklRenderBackend::CreateSwapchain()
 
   // Choose an image count
   uint32_t imageCount = capabilities.minImageCount + 1;
+  if (presentPolicy.swapchainImageCount != 0)
+  {
+    imageCount = glm::max(presentPolicy.swapchainImageCount, capabilities.minImageCount);
+  }
   if (capabilities.maxImageCount > 0 && capabilities.maxImageCount < imageCount)
   {
     imageCount = capabilities.maxImageCount;
@@ -376,6 +625,7 @@ void SklRenderBackend::CreateSwapchain()
   createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
   createInfo.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
   createInfo.presentMode = presentMode;
+  createInfo.oldSwapchain = _oldSwapchain;
 
   SKL_ASSERT_VK(
       vkCreateSwapchainKHR(vulkanContext.device, &createInfo, nullptr, &swapchain),
@@ -397,13 +647,41 @@ void SklRenderBackend::CreateSwapchain()
   }
 }
 
+void SklRenderBackend::CreateOffscreenTargets()
+{
+  // An 8-bit RGBA format supported everywhere, including software rasterizers,
+  // and trivially written out as a PNG
+  swapchainFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  swapchain = VK_NULL_HANDLE;
+  vulkanContext.renderExtent = headlessExtent;
+
+  uint32_t imageCount = MAX_FLIGHT_IMAGE_COUNT;
+  swapchainImages.resize(imageCount);
+  swapchainImageViews.resize(imageCount);
+
+  for (uint32_t i = 0; i < imageCount; i++)
+  {
+    uint32_t index = CreateImage(headlessExtent.width, headlessExtent.height, swapchainFormat,
+                                 VK_IMAGE_TILING_OPTIMAL,
+                                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                     VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    swapchainImages[i] = ImageManager::images[index]->image;
+    swapchainImageViews[i] =
+        ImageManager::CreateImageView(swapchainFormat, VK_IMAGE_ASPECT_COLOR_BIT,
+                                      swapchainImages[i]);
+  }
+}
+
 void SklRenderBackend::CreateRenderpass()
 {
   VkAttachmentDescription colorDesc = {};
   colorDesc.format = swapchainFormat;
   colorDesc.samples = VK_SAMPLE_COUNT_1_BIT;
   colorDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorDesc.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  // Offscreen images are left ready to be copied out
+  colorDesc.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                   : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
   colorDesc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
   colorDesc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   colorDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
@@ -454,6 +732,10 @@ void SklRenderBackend::CreateRenderpass()
   SKL_ASSERT_VK(
       vkCreateRenderPass(vulkanContext.device, &creteInfo, nullptr, &vulkanContext.renderPass),
       "Failed to create renderpass");
+
+  vulkanContext.renderPassColorFormat = colorDesc.format;
+  vulkanContext.renderPassDepthFormat = depthDesc.format;
+  vulkanContext.renderPassSamples = colorDesc.samples;
 }
 
 void SklRenderBackend::CreateDepthImage()
@@ -493,23 +775,31 @@ void SklRenderBackend::CreateFramebuffers()
   }
 }
 
-void SklRenderBackend::CreateDescriptorPool()
+void SklRenderBackend::CreateDescriptorAllocators()
 {
-  VkDescriptorPoolSize poolSizes[2] = {};
-  poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSizes[0].descriptorCount = 3;
-  poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSizes[1].descriptorCount = 6;
-
-  VkDescriptorPoolCreateInfo createInfo = {};
-  createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  createInfo.poolSizeCount = 2;
-  createInfo.pPoolSizes = poolSizes;
-  createInfo.maxSets = 3;
+  // Room for a couple of buffers and a few images in each set
+  // Programs may bind either kind of buffer, so both are reserved
+  const std::vector<sklDescriptorPoolRatio_t> ratios = {
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.f },
+    { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.f }
+  };
+
+  descriptorAllocator = new SklDescriptorAllocator(maxRenderables, ratios);
+  SklDescriptorCache::Initialize(descriptorAllocator);
+
+  // Per-frame sets are rebuilt every frame, their pools settle at the largest frame's size
+  frameDescriptorAllocators.resize(MAX_FLIGHT_IMAGE_COUNT);
+  for (auto& allocator : frameDescriptorAllocators)
+  {
+    allocator = new SklDescriptorAllocator(64, ratios);
+  }
 
-  SKL_ASSERT_VK(
-      vkCreateDescriptorPool(vulkanContext.device, &createInfo, nullptr, &descriptorPool),
-      "Failed to create descriptor pool");
+  // Sized well past maxRenderables, resources are only ever added to the global set
+  if (vulkanContext.bindless)
+  {
+    SklBindless::Initialize();
+  }
 }
 
 void SklRenderBackend::CreateSyncObjects()
@@ -545,18 +835,25 @@ void SklRenderBackend::CreateSyncObjects()
 
 void SklRenderBackend::CreateCommandBuffers()
 {
-  uint32_t bufferCount = static_cast<uint32_t>(swapchainImages.size());
-  commandBuffers.resize(bufferCount);
+  frameCommandPools.resize(MAX_FLIGHT_IMAGE_COUNT);
+  commandBuffers.resize(MAX_FLIGHT_IMAGE_COUNT);
 
   VkCommandBufferAllocateInfo allocInfo = {};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandBufferCount = bufferCount;
-  allocInfo.commandPool = vulkanContext.graphicsCommandPool;
+  allocInfo.commandBufferCount = 1;
 
-  SKL_ASSERT_VK(
-      vkAllocateCommandBuffers(vulkanContext.device, &allocInfo, commandBuffers.data()),
-      "Failed to allocate command buffers");
+  // Resetting a whole pool is cheaper than resetting its command buffers individually
+  for (uint32_t i = 0; i < MAX_FLIGHT_IMAGE_COUNT; i++)
+  {
+    SklCreateCommandPool(frameCommandPools[i], vulkanContext.graphicsIdx,
+                         VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+    allocInfo.commandPool = frameCommandPools[i];
+    SKL_ASSERT_VK(
+        vkAllocateCommandBuffers(vulkanContext.device, &allocInfo, &commandBuffers[i]),
+        "Failed to allocate command buffer for frame %u", i);
+  }
 }
 
 //=================================================
@@ -566,6 +863,73 @@ void SklRenderBackend::CreateCommandBuffers()
 // Initialization
 //=================================================
 
+void SklRenderBackend::RemoveUnavailableInstanceFeatures()
+{
+  // Render nodes and software drivers often ship without validation layers
+  uint32_t layerCount;
+  vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+  std::vector<VkLayerProperties> layers(layerCount);
+  vkEnumerateInstanceLayerProperties(&layerCount, layers.data());
+
+  for (uint32_t i = 0; i < validationLayer.size();)
+  {
+    bool found = false;
+    for (const auto& layer : layers)
+    {
+      found |= std::strcmp(layer.layerName, validationLayer[i]) == 0;
+    }
+
+    if (found)
+    {
+      i++;
+    }
+    else
+    {
+      SKL_PRINT_DEBUG("Vulkan Context", "Layer \"%s\" is unavailable", validationLayer[i]);
+      validationLayer.erase(validationLayer.begin() + i);
+    }
+  }
+
+  uint32_t extensionCount;
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> extensions(extensionCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+  auto isAvailable = [&](const char* _name)
+  {
+    for (const auto& extension : extensions)
+    {
+      if (std::strcmp(extension.extensionName, _name) == 0)
+      {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // The window can't be presented to without the extensions it asked for
+  for (const char* required : instanceExtensions)
+  {
+    if (!isAvailable(required))
+    {
+      SKL_LOG(SKL_ERROR, "Required instance extension \"%s\" is unavailable", required);
+      throw std::runtime_error("Required instance extension is unavailable");
+    }
+  }
+
+  for (const char* optional : optionalInstanceExtensions)
+  {
+    if (isAvailable(optional))
+    {
+      instanceExtensions.push_back(optional);
+    }
+    else
+    {
+      SKL_PRINT_DEBUG("Vulkan Context", "Instance extension \"%s\" is unavailable", optional);
+    }
+  }
+}
+
 uint32_t SklRenderBackend::GetQueueIndex(std::vector<VkQueueFamilyProperties>& _queues,
                                            VkQueueFlags _flags)
 {
@@ -3,6 +3,10 @@
 #define SKELETON_RENDERER_RENDER_BACKEND_H 1
 
 #include <vector>
+#include <deque>
+#include <algorithm>
+#include <functional>
+#include <cstring>
 
 #include "vulkan/vulkan.h"
 #include "sdl/SDL.h"
@@ -13,6 +17,7 @@
 #include "skeleton/core/time.h"
 #include "skeleton/renderer/shader_program.h"
 #include "skeleton/renderer/resource_managers.h"
+#include "skeleton/renderer/descriptor_allocator.h"
 #include "skeleton/core/mesh.h"
 
 // Holds the MVP matrix of a camera and all the objects it should render
@@ -22,6 +27,51 @@ struct sklView_t
   std::vector<sklRenderable_t> renderables;  // Objects this view can see
 };
 
+// How presented images are queued for display
+typedef enum sklPresentMode
+{
+  Skl_Present_Fifo,          // Waits for vertical blank, never tears, always supported
+  Skl_Present_Fifo_Relaxed,  // Waits for vertical blank unless the frame is late, may tear
+  Skl_Present_Mailbox,       // Replaces the waiting image, never tears
+  Skl_Present_Immediate      // Presents without waiting, may tear
+} sklPresentMode;
+
+// Names of each present mode, in the enum's order
+static const char* const sklPresentModeNames[] = { "fifo", "fifo-relaxed", "mailbox",
+                                                   "immediate" };
+
+// Retrieves the name of a present mode
+inline const char* SklPresentModeName(sklPresentMode _mode)
+{
+  return sklPresentModeNames[_mode];
+}
+
+// Finds the present mode with the given name, returns false if there is none
+inline bool SklPresentModeFromName(const char* _name, sklPresentMode& _mode)
+{
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    if (std::strcmp(_name, sklPresentModeNames[i]) == 0)
+    {
+      _mode = static_cast<sklPresentMode>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Upper bound on frames the CPU may queue, sync objects are created for this many
+#define MAX_FLIGHT_IMAGE_COUNT 3
+
+// Trades throughput for latency when presenting frames
+struct sklPresentPolicy_t
+{
+  sklPresentMode mode = Skl_Present_Mailbox;
+  uint32_t swapchainImageCount = 0;                   // 0 uses one more than the surface's minimum
+  uint32_t framesInFlight = MAX_FLIGHT_IMAGE_COUNT;   // Frames the CPU may queue, at least 1
+  bool lowLatency = false;                            // Waits on the prior frame before input
+};
+
 // Creates a command pool
 inline void SklCreateCommandPool(VkCommandPool& _pool, uint32_t _queueIndex,
                                  VkCommandPoolCreateFlags _flags = 0)
@@ -36,26 +86,51 @@ inline void SklCreateCommandPool(VkCommandPool& _pool, uint32_t _queueIndex,
 }
 
 // Creates a logical device based on the selected GPU in the vulkanContext
+// _featureChain is a pNext chain of extension feature structs to enable
 inline void CreateLogicalDevice(const std::vector<uint32_t> _queueIndices,
                                 const std::vector<const char*> _deviceExtensions,
-                                const std::vector<const char*> _deviceLayers)
+                                const std::vector<const char*> _deviceLayers,
+                                void* _featureChain = nullptr)
 {
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(vulkanContext.gpu.device, &supportedFeatures);
+
   VkPhysicalDeviceFeatures enabledFeatures = {};
   enabledFeatures.samplerAnisotropy = VK_TRUE;
-  uint32_t queueCount = static_cast<uint32_t>(_queueIndices.size());
+  // Allows GPU profiling to gather pipeline statistics
+  enabledFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+  // Allows wireframe and point pipelines
+  enabledFeatures.fillModeNonSolid = supportedFeatures.fillModeNonSolid;
+  // Allows bindless shaders to index descriptor arrays with pushed indices
+  enabledFeatures.shaderSampledImageArrayDynamicIndexing =
+      supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+  enabledFeatures.shaderStorageBufferArrayDynamicIndexing =
+      supportedFeatures.shaderStorageBufferArrayDynamicIndexing;
+
+  // Each queue family may only be requested once
+  std::vector<uint32_t> uniqueIndices;
+  for (uint32_t index : _queueIndices)
+  {
+    if (std::find(uniqueIndices.begin(), uniqueIndices.end(), index) == uniqueIndices.end())
+    {
+      uniqueIndices.push_back(index);
+    }
+  }
+  uint32_t queueCount = static_cast<uint32_t>(uniqueIndices.size());
 
   const float priority = 1.f;
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos(queueCount);
   for (uint32_t i = 0; i < queueCount; i++)
   {
     queueCreateInfos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    queueCreateInfos[i].queueFamilyIndex = _queueIndices[i];
+    queueCreateInfos[i].queueFamilyIndex = uniqueIndices[i];
     queueCreateInfos[i].queueCount = 1;
     queueCreateInfos[i].pQueuePriorities = &priority;
   }
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  createInfo.pNext = _featureChain;
   createInfo.pEnabledFeatures = &enabledFeatures;
   createInfo.enabledExtensionCount = static_cast<uint32_t>(_deviceExtensions.size());
   createInfo.ppEnabledExtensionNames = _deviceExtensions.data();
@@ -81,7 +156,10 @@ class SklRenderBackend
 {
 private:
   std::vector<const char*> validationLayer = { "VK_LAYER_KHRONOS_validation" };
-  std::vector<const char*> instanceExtensions = { VK_EXT_DEBUG_UTILS_EXTENSION_NAME };
+  // Instance extensions the window requires, creation fails without them
+  std::vector<const char*> instanceExtensions;
+  // Debugging instance extensions, enabled only when the loader provides them
+  std::vector<const char*> optionalInstanceExtensions = { VK_EXT_DEBUG_UTILS_EXTENSION_NAME };
   std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
 public:
@@ -89,6 +167,11 @@ public:
   SDL_Window* window;
   BufferManager* bufferManager;
 
+  // Renders into offscreen images instead of a swapchain, set when created without a window
+  bool headless;
+  // Size of the offscreen images when headless
+  VkExtent2D headlessExtent;
+
   VkInstance instance;
   VkSurfaceKHR surface;
 
@@ -100,24 +183,45 @@ public:
 
   sklImage_t* depthImage;
 
-  VkDescriptorPool descriptorPool;
+  // Sets that live as long as their renderable or material
+  SklDescriptorAllocator* descriptorAllocator;
+  // Sets used by a single frame, reset wholesale once that frame's fence signals
+  std::vector<SklDescriptorAllocator*> frameDescriptorAllocators;
+  // Number of renderables the first descriptor pool is sized for, set before initializing
+  // More pools are added as needed, this only avoids growing them during startup
+  uint32_t maxRenderables = 64;
 
   // Synchronization
-  #define MAX_FLIGHT_IMAGE_COUNT 3
   std::vector<VkFence> imageIsInFlightFences;
   std::vector<VkFence> flightFences;
   std::vector<VkSemaphore> renderCompleteSemaphores;
   std::vector<VkSemaphore> imageAvailableSemaphores;
   uint32_t currentFrame = 0;
+  // Applied when the swapchain is next created, frames in flight through SetFramesInFlight
+  sklPresentPolicy_t presentPolicy;
 
+  // One transient pool per frame in flight, reset in bulk once that frame's fence signals
+  std::vector<VkCommandPool> frameCommandPools;
+  // Each frame's command buffer, re-recorded from its pool every frame
   std::vector<VkCommandBuffer> commandBuffers;
 
+  // Resources replaced while frames using them may still be in flight
+  struct sklDeferredDeletion_t
+  {
+    uint64_t frame;                  // Frames submitted before the resource was retired
+    std::function<void()> destroy;
+  };
+  std::deque<sklDeferredDeletion_t> deletionQueue;
+  uint64_t submittedFrameCount = 0;
+
 public:
   // Initialization
   //=================================================
 
   // Initializes surface independent components and selects a physical device
-  SklRenderBackend(SDL_Window* _window, const std::vector<const char*>& _extraExtensions);
+  // A null window creates a headless backend that renders offscreen at _headlessExtent
+  SklRenderBackend(SDL_Window* _window, const std::vector<const char*>& _extraExtensions,
+                   VkExtent2D _headlessExtent = { 0, 0 });
   // Destroys all attached Vulkan components
   ~SklRenderBackend();
 
@@ -142,9 +246,28 @@ public:
   void CleanupRenderComponents();
   // Destroys and recreates all components required for rendering dependent on the swapchain
   void RecreateRenderComponents();
+  // Replaces the swapchain and everything sized to it without waiting for the device
+  // The old components are retired through the deletion queue
+  // Returns false if the window has no area to render to
+  bool RecreateSwapchain();
+
+  // Changes how many frames may be queued at once, waiting for those already queued
+  void SetFramesInFlight(uint32_t _count);
+
+  // Deferred deletion
+  //=================================================
+
+  // Destroys a resource once every frame submitted so far has finished
+  void DeferDeletion(std::function<void()> _destroy);
+  // Destroys retired resources no longer in use, call after waiting on the current frame's fence
+  // _all destroys everything and must only be used once the device is idle
+  void ProcessDeletions(bool _all = false);
 
   // Creates the swapchain, retrieves its images, and creates their views
-  void CreateSwapchain();
+  // _oldSwapchain is handed to the driver so it can reuse its resources
+  void CreateSwapchain(VkSwapchainKHR _oldSwapchain = VK_NULL_HANDLE);
+  // Creates offscreen color images and their views in place of a swapchain
+  void CreateOffscreenTargets();
   // Creates a generic Renderpass
   void CreateRenderpass();
   // Creates a generic DepthImage
@@ -152,16 +275,19 @@ public:
   // Creates a set of Framebuffers
   void CreateFramebuffers();
 
-  // Creates a generic shader descriptor pool
-  void CreateDescriptorPool();
+  // Creates the long-lived and per-frame descriptor allocators
+  void CreateDescriptorAllocators();
   // Creates the fences and semaphores required for GPU/CPU synchronization
   void CreateSyncObjects();
-  // Allocates CommandBuffers for recording
+  // Creates each frame's command pool and allocates its command buffer
   void CreateCommandBuffers();
 
   // Helpers
   //=================================================
 
+  // Removes any optional layers or instance extensions the Vulkan loader does not provide
+  // Throws if a required instance extension is unavailable
+  void RemoveUnavailableInstanceFeatures();
   // Returns the first instance of a queue with the input flags
   uint32_t GetQueueIndex(std::vector<VkQueueFamilyProperties>& _queues, VkQueueFlags _flags);
   // Returns the first instance of a presentation queue
@@ -2,8 +2,13 @@
 #include "pch.h"
 #include "skeleton/renderer/resource_managers.h"
 
+#include <algorithm>
+
+
 #include "skeleton/core/debug_tools.h"
 #include "skeleton/core/file_system.h"
+#include "skeleton/core/profiler.h"
+#include "skeleton/renderer/memory_tracker.h"
 
 //=================================================
 // Buffer Manager
@@ -33,7 +38,7 @@ BufferManager::~BufferManager()
   {
     if (GetIndexBitMapAt(i))
     {
-      vkFreeMemory(vulkanContext.device, m_memories[i], nullptr);
+      SklMemoryTracker::Free(m_memories[i]);
       vkDestroyBuffer(vulkanContext.device, m_buffers[i], nullptr);
     }
   }
@@ -43,18 +48,27 @@ BufferManager::~BufferManager()
 
 bool BufferManager::GetIndexBitMapAt(uint32_t _index)
 {
-  return (m_indexBitMap & (1i64 << _index));
+  if (_index / 64 >= m_indexBitMap.size())
+  {
+    return false;
+  }
+  return (m_indexBitMap[_index / 64] & (1ull << (_index % 64)));
 }
 
 void BufferManager::SetIndexBitMapAt(uint32_t _index, bool _value /*= true*/)
 {
+  if (_index / 64 >= m_indexBitMap.size())
+  {
+    m_indexBitMap.resize(_index / 64 + 1, 0);
+  }
+
   if (_value)
   {
-    m_indexBitMap |= (1i64 << _index);
+    m_indexBitMap[_index / 64] |= (1ull << (_index % 64));
   }
   else
   {
-    m_indexBitMap &= ~(1i64 << _index);
+    m_indexBitMap[_index / 64] &= ~(1ull << (_index % 64));
   }
 }
 
@@ -85,25 +99,27 @@ const VkDeviceMemory* BufferManager::GetMemory(uint32_t _index)
 void BufferManager::RemoveAtIndex(uint32_t _index)
 {
   SetIndexBitMapAt(_index, false);
-  vkFreeMemory(vulkanContext.device, m_memories[_index], nullptr);
+  SklMemoryTracker::Free(m_memories[_index]);
   vkDestroyBuffer(vulkanContext.device, m_buffers[_index], nullptr);
 }
 
 uint32_t BufferManager::GetFirstAvailableIndex()
 {
-  uint32_t arraySize = static_cast<uint32_t>(m_buffers.size());
-  uint32_t i = 0;
-  while (i <= arraySize && i < INDEXBITMAPSIZE)
+  // Skip fully occupied words, any slot past the end of the array is free
+  for (uint32_t word = 0; word < m_indexBitMap.size(); word++)
   {
-    if (GetIndexBitMapAt(i) == 0)
+    if (m_indexBitMap[word] != ~0ull)
     {
+      uint32_t i = word * 64;
+      while (GetIndexBitMapAt(i))
+      {
+        i++;
+      }
       return i;
     }
-
-    i++;
   }
-  SKL_LOG(SKL_ERROR, "Failed to find an available index");
-  return -1;
+
+  return static_cast<uint32_t>(m_indexBitMap.size() * 64);
 }
 
 uint32_t BufferManager::CreateAndFillBuffer(const void* _data, VkDeviceSize _size,
@@ -165,7 +181,8 @@ uint32_t BufferManager::CreateBuffer(VkBuffer& _buffer, VkDeviceMemory& _memory,
 
   VkDeviceMemory tmpMemory;
   SKL_ASSERT_VK(
-    vkAllocateMemory(vulkanContext.device, &allocInfo, nullptr, &tmpMemory),
+    SklMemoryTracker::Allocate(allocInfo, SklMemoryTracker::CategorizeBuffer(_usage),
+                               &tmpMemory),
     "Failed to allocate vert memory");
 
   if (index < static_cast<uint32_t>(m_memories.size()))
@@ -219,7 +236,8 @@ uint32_t BufferManager::CreateBuffer(VkDeviceSize _size, VkBufferUsageFlags _usa
 
   VkDeviceMemory tmpMemory;
   SKL_ASSERT_VK(
-    vkAllocateMemory(vulkanContext.device, &allocInfo, nullptr, &tmpMemory),
+    SklMemoryTracker::Allocate(allocInfo, SklMemoryTracker::CategorizeBuffer(_usage),
+                               &tmpMemory),
     "Failed to allocate vert memory");
 
   if (index < static_cast<uint32_t>(m_memories.size()))
@@ -313,14 +331,32 @@ void ImageManager::Cleanup()
 {
   for (const auto& i : images)
   {
+    if (i == nullptr)
+      continue;
+
     vkDestroyImage(vulkanContext.device, i->image, nullptr);
-    vkFreeMemory(vulkanContext.device, i->memory, nullptr);
+    SklMemoryTracker::Free(i->memory);
     vkDestroyImageView(vulkanContext.device, i->view, nullptr);
     vkDestroySampler(vulkanContext.device, i->sampler, nullptr);
     free(i);
   }
 }
 
+void ImageManager::DestroyImage(sklImage_t* _image)
+{
+  // Other images are referenced by index, so the slot stays in place
+  auto slot = std::find(images.begin(), images.end(), _image);
+  if (slot == images.end())
+    return;
+
+  vkDestroyImage(vulkanContext.device, _image->image, nullptr);
+  SklMemoryTracker::Free(_image->memory);
+  vkDestroyImageView(vulkanContext.device, _image->view, nullptr);
+  vkDestroySampler(vulkanContext.device, _image->sampler, nullptr);
+  delete(_image);
+  *slot = nullptr;
+}
+
 uint32_t ImageManager::CreateImage(uint32_t _width, uint32_t _height, VkFormat _format,
                                    VkImageTiling _tiling, VkImageUsageFlags _usage,
                                    VkMemoryPropertyFlags _memFlags)
@@ -356,7 +392,8 @@ uint32_t ImageManager::CreateImage(uint32_t _width, uint32_t _height, VkFormat _
                                                             _memFlags);
 
   SKL_ASSERT_VK(
-    vkAllocateMemory(vulkanContext.device, &allocInfo, nullptr, &img->memory),
+    SklMemoryTracker::Allocate(allocInfo, SklMemoryTracker::CategorizeImage(_usage),
+                               &img->memory),
     "Failed to allocate texture memory");
 
   vkBindImageMemory(vulkanContext.device, img->image, img->memory, 0);
@@ -493,13 +530,26 @@ uint32_t TextureManager::CreateTexture(const char* _directory, BufferManager* _b
   }
 
   SKL_PRINT_SIMPLE("Creating a texture from %s", _directory);
-  sklTexture_t* tex = new sklTexture_t(_directory);
 
   // Image loading
   //=================================================
   int width, height;
   void* imageFile = LoadImageFile(_directory, width, height);
-  VkDeviceSize size = width * height * 4;
+
+  uint32_t index = CreateTexture(_directory, imageFile, static_cast<uint32_t>(width),
+                                 static_cast<uint32_t>(height), _bufferManager);
+
+  DestroyImageFile(imageFile);
+  return index;
+}
+
+uint32_t TextureManager::CreateTexture(const char* _name, const void* _pixels, uint32_t _width,
+                                       uint32_t _height, BufferManager* _bufferManager)
+{
+  SKL_PROFILE_FUNCTION();
+
+  sklTexture_t* tex = new sklTexture_t(_name);
+  VkDeviceSize size = static_cast<VkDeviceSize>(_width) * _height * 4;
 
   // Staging buffer
   //=================================================
@@ -510,14 +560,12 @@ uint32_t TextureManager::CreateTexture(const char* _directory, BufferManager* _b
     stagingBuffer, stagingMemory, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-  _bufferManager->FillBuffer(stagingMemory, imageFile, size);
-
-  DestroyImageFile(imageFile);
+  _bufferManager->FillBuffer(stagingMemory, _pixels, size);
 
   // Image creation
   //=================================================
   uint32_t imageIdx = ImageManager::CreateImage(
-    static_cast<uint32_t>(width), static_cast<uint32_t>(height), VK_FORMAT_R8G8B8A8_UNORM,
+    _width, _height, VK_FORMAT_R8G8B8A8_UNORM,
     VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
@@ -526,8 +574,7 @@ uint32_t TextureManager::CreateTexture(const char* _directory, BufferManager* _b
   ImageManager::TransitionImageLayout(img->image, VK_FORMAT_R8G8B8A8_UNORM,
                                       VK_IMAGE_LAYOUT_UNDEFINED,
                                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  BufferManager::CopyBufferToImage(stagingBuffer, img->image, static_cast<uint32_t>(width),
-                                   static_cast<uint32_t>(height));
+  BufferManager::CopyBufferToImage(stagingBuffer, img->image, _width, _height);
   ImageManager::TransitionImageLayout(img->image, VK_FORMAT_R8G8B8A8_UNORM,
                                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
@@ -18,8 +18,8 @@ class BufferManager
   // Variables
   //=================================================
 private:
-  uint64_t m_indexBitMap = 0;
-  const uint32_t INDEXBITMAPSIZE = 64;
+  // One bit per buffer slot, grows as buffers are created
+  std::vector<uint64_t> m_indexBitMap;
   std::vector<VkBuffer> m_buffers;
   std::vector<VkDeviceMemory> m_memories;
 
@@ -86,6 +86,8 @@ public:
   static uint32_t CreateImage(uint32_t _width, uint32_t _height, VkFormat _format,
                               VkImageTiling _tiling, VkImageUsageFlags _usage,
                               VkMemoryPropertyFlags _memFlags);
+  // Destroys an image and its view and sampler, its index is left empty
+  static void DestroyImage(sklImage_t* _image);
   // Changes the ImageLayout of an image via a commandBuffer
   static void TransitionImageLayout(VkImage _image, VkFormat _format, VkImageLayout _oldLayout,
                                     VkImageLayout _newLayout);
@@ -104,6 +106,9 @@ public:
 
 public:
   static uint32_t CreateTexture(const char* _directory, BufferManager* bufferManager);
+  // Creates a texture from 8-bit RGBA pixels, _name must outlive the texture
+  static uint32_t CreateTexture(const char* _name, const void* _pixels, uint32_t _width,
+                                uint32_t _height, BufferManager* bufferManager);
 };
 
 #endif // !SKELETON_RDNERER_RESOURCE_MANAGERS_H
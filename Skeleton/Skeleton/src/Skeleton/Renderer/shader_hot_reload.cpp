@@ -0,0 +1,501 @@
+
+#include "pch.h"
+#include "skeleton/renderer/shader_hot_reload.h"
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "skeleton/renderer/vulkan_context.h"
+#include "skeleton/renderer/shader_program.h"
+#include "skeleton/renderer/shader_reflection.h"
+#include "skeleton/renderer/pipeline_builder.h"
+#include "skeleton/renderer/shader_module_cache.h"
+#include "skeleton/core/file_system.h"
+#include "skeleton/core/debug_tools.h"
+
+namespace
+{
+  // A shader loaded on the watcher thread, waiting to be swapped in
+  struct sklReloadedShader_t
+  {
+    std::string name;
+    sklShaderStageFlags stage;
+    VkShaderModule module;
+    sklShaderReflection_t reflection;
+  };
+
+  // A program's rebuilt pipeline, swapped in once it has compiled
+  struct sklPendingSwap_t
+  {
+    uint32_t programIndex;
+    uint64_t features;  // The variant being rebuilt
+    sklPipelineState_t state;
+    std::shared_future<VkPipeline> pipeline;
+  };
+
+  struct sklShaderHotReloadState_t
+  {
+    std::mutex lock;
+    std::atomic<bool> running = false;
+    std::thread watcher;
+    std::string directory;
+    std::string compiler;
+
+    // Filled by the watcher thread, emptied between frames
+    std::vector<sklReloadedShader_t> reloadedShaders;
+
+    // Only used between frames on the render thread
+    std::vector<sklPendingSwap_t> pendingSwaps;
+    uint32_t reloadCount = 0;
+  };
+
+  sklShaderHotReloadState_t& GetState()
+  {
+    static sklShaderHotReloadState_t state;
+    return state;
+  }
+
+  // Stage a compiled binary is for, 0 if the extension isn't a SPIR-V binary's
+  sklShaderStageFlags StageOfBinary(const std::string& _extension)
+  {
+    if (_extension == ".vspv") return Skl_Shader_Vert_Stage;
+    if (_extension == ".fspv") return Skl_Shader_Frag_Stage;
+    if (_extension == ".cspv") return Skl_Shader_Comp_Stage;
+    return 0;
+  }
+
+  // Extension of the binary compiled from a GLSL source, empty if it isn't a source
+  std::string BinaryExtensionOfSource(const std::string& _extension)
+  {
+    if (_extension == ".vert") return ".vspv";
+    if (_extension == ".frag") return ".fspv";
+    if (_extension == ".comp") return ".cspv";
+    return "";
+  }
+
+  // Compiles a GLSL source next to itself, the new binary is picked up as its own change
+  void CompileSource(const std::filesystem::path& _source, const std::string& _binaryExtension)
+  {
+    sklShaderHotReloadState_t& state = GetState();
+    std::filesystem::path binary = _source;
+    binary.replace_extension(_binaryExtension);
+
+    std::string command = "\"" + state.compiler + "\" \"" + _source.string() + "\" -o \"" +
+                          binary.string() + "\"";
+#ifdef _WIN32
+    // cmd strips the outer quotes of a command that starts with one
+    command = "\"" + command + "\"";
+#endif
+
+    SKL_PRINT("Shader Hot Reload", "Compiling %s", _source.filename().string().c_str());
+    if (std::system(command.c_str()) != 0)
+    {
+      SKL_PRINT_WARNING("Shader Hot Reload", "Failed to compile %s",
+                        _source.filename().string().c_str());
+    }
+  }
+
+  // Loads and reflects a changed binary, queueing it to be swapped in between frames
+  void LoadBinary(const std::filesystem::path& _binary, sklShaderStageFlags _stage)
+  {
+    std::vector<char> code = LoadFile(_binary.string().c_str());
+    if (code.empty())
+      return;
+
+    const sklShaderReflection_t& reflection = SklShaderReflection::Reflect(code);
+    if (!reflection.valid)
+    {
+      SKL_PRINT_WARNING("Shader Hot Reload", "Skipping %s, it could not be reflected",
+                        _binary.filename().string().c_str());
+      return;
+    }
+
+    VkShaderModule module;
+    try
+    {
+      module = SklShaderModuleCache::Acquire(code);
+    }
+    catch (...)
+    {
+      SKL_PRINT_WARNING("Shader Hot Reload", "Failed to create a module for %s",
+                        _binary.filename().string().c_str());
+      return;
+    }
+
+    sklShaderHotReloadState_t& state = GetState();
+    std::lock_guard<std::mutex> guard(state.lock);
+    state.reloadedShaders.push_back(
+        { _binary.stem().string(), _stage, module, reflection });
+  }
+
+  // Compiles changed sources and loads changed binaries
+  void HandleChange(const std::filesystem::path& _file)
+  {
+    std::string extension = _file.extension().string();
+
+    std::string binaryExtension = BinaryExtensionOfSource(extension);
+    if (!binaryExtension.empty())
+    {
+      CompileSource(_file, binaryExtension);
+      return;
+    }
+
+    sklShaderStageFlags stage = StageOfBinary(extension);
+    if (stage != 0)
+    {
+      LoadBinary(_file, stage);
+    }
+  }
+
+#ifdef __linux__
+  // Blocks on inotify, waking periodically to check whether to stop
+  void Watch()
+  {
+    sklShaderHotReloadState_t& state = GetState();
+    int notify = inotify_init1(IN_NONBLOCK);
+    if (notify < 0 ||
+        inotify_add_watch(notify, state.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+      SKL_LOG(SKL_ERROR, "Failed to watch \"%s\" for shader changes", state.directory.c_str());
+      if (notify >= 0)
+        close(notify);
+      return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (state.running)
+    {
+      pollfd pollInfo = { notify, POLLIN, 0 };
+      if (poll(&pollInfo, 1, 100) <= 0)
+        continue;
+
+      ssize_t length = read(notify, buffer, sizeof(buffer));
+      for (ssize_t offset = 0; offset < length; )
+      {
+        const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+        if (event->len > 0)
+        {
+          HandleChange(std::filesystem::path(state.directory) / event->name);
+        }
+        offset += sizeof(inotify_event) + event->len;
+      }
+    }
+
+    close(notify);
+  }
+#else
+  // Polls the directory's write times
+  // A change is only handled once its time has held for a full interval, so files still being
+  //   written are not read
+  void Watch()
+  {
+    using fileTime = std::filesystem::file_time_type;
+    sklShaderHotReloadState_t& state = GetState();
+    std::unordered_map<std::string, fileTime> handledTimes;
+    std::unordered_map<std::string, fileTime> changedTimes;
+
+    auto scan = [&](bool _handle)
+    {
+      std::error_code error;
+      for (const auto& entry : std::filesystem::directory_iterator(state.directory, error))
+      {
+        std::string path = entry.path().string();
+        fileTime time = entry.last_write_time(error);
+        if (error || handledTimes[path] == time)
+          continue;
+
+        if (!_handle)
+        {
+          handledTimes[path] = time;
+        }
+        else if (changedTimes.count(path) && changedTimes[path] == time)
+        {
+          handledTimes[path] = time;
+          changedTimes.erase(path);
+          HandleChange(entry.path());
+        }
+        else
+        {
+          changedTimes[path] = time;
+        }
+      }
+    };
+
+    // Existing files are only recorded, they were loaded normally
+    scan(false);
+    while (state.running)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(250));
+      scan(true);
+    }
+  }
+#endif
+
+  // Whether two blocks have the same members at the same offsets
+  bool SameMembers(const std::vector<sklReflectedMember_t>& _a,
+                   const std::vector<sklReflectedMember_t>& _b)
+  {
+    if (_a.size() != _b.size())
+      return false;
+    for (size_t i = 0; i < _a.size(); i++)
+    {
+      if (_a[i].name != _b[i].name || _a[i].offset != _b[i].offset || _a[i].size != _b[i].size)
+        return false;
+    }
+    return true;
+  }
+
+  // Whether a reloaded shader can replace the current one without changing pipeline layouts
+  // Buffers are sized from their blocks and bindless indices are pushed by member name, so
+  //   block layouts have to match as well
+  bool SameInterface(const sklShaderReflection_t& _a, const sklShaderReflection_t& _b)
+  {
+    if (_a.bindings.size() != _b.bindings.size() || _a.inputs.size() != _b.inputs.size() ||
+        _a.pushConstants.offset != _b.pushConstants.offset ||
+        _a.pushConstants.size != _b.pushConstants.size ||
+        !SameMembers(_a.pushConstantMembers, _b.pushConstantMembers))
+    {
+      return false;
+    }
+
+    for (size_t i = 0; i < _a.bindings.size(); i++)
+    {
+      const sklReflectedBinding_t& a = _a.bindings[i];
+      const sklReflectedBinding_t& b = _b.bindings[i];
+      if (a.set != b.set || a.binding != b.binding || a.type != b.type || a.count != b.count ||
+          a.blockSize != b.blockSize || !SameMembers(a.members, b.members))
+      {
+        return false;
+      }
+    }
+    // Features are read when programs are created
+    if (_a.specConstants.size() != _b.specConstants.size())
+      return false;
+    for (size_t i = 0; i < _a.specConstants.size(); i++)
+    {
+      if (_a.specConstants[i].id != _b.specConstants[i].id ||
+          _a.specConstants[i].isBool != _b.specConstants[i].isBool)
+      {
+        return false;
+      }
+    }
+    for (size_t i = 0; i < _a.inputs.size(); i++)
+    {
+      if (_a.inputs[i].location != _b.inputs[i].location ||
+          _a.inputs[i].format != _b.inputs[i].format)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Replaces a shader's module and queues its programs' pipelines for rebuilding
+  void SwapShader(sklReloadedShader_t& _reloaded)
+  {
+    sklShaderHotReloadState_t& state = GetState();
+
+    std::string key(_reloaded.name);
+    key.append("#").append(std::to_string(_reloaded.stage));
+    auto existing = vulkanContext.shaderLookup.find(key);
+
+    // Shaders no program has loaded are picked up from disk when they are first used
+    if (existing == vulkanContext.shaderLookup.end() ||
+        vulkanContext.shaders[existing->second].module == VK_NULL_HANDLE)
+    {
+      SklShaderModuleCache::Release(_reloaded.module);
+      return;
+    }
+
+    uint32_t shaderIndex = existing->second;
+    shader_t& shader = vulkanContext.shaders[shaderIndex];
+    // Saving without changes produces the same binary, and so the same module
+    if (_reloaded.module == shader.module)
+    {
+      SklShaderModuleCache::Release(_reloaded.module);
+      return;
+    }
+    if (!SameInterface(shader.reflection, _reloaded.reflection))
+    {
+      SKL_PRINT_WARNING("Shader Hot Reload",
+                        "%s changed its bindings or inputs, restart to apply it", shader.name);
+      SklShaderModuleCache::Release(_reloaded.module);
+      return;
+    }
+
+    // Pipelines built from the old module keep it alive until they are destroyed
+    SklShaderModuleCache::Release(shader.module);
+    shader.module = _reloaded.module;
+    shader.reflection = _reloaded.reflection;
+
+    for (uint32_t i = 0; i < vulkanContext.shaderPrograms.size(); i++)
+    {
+      shaderProgram_t& program = vulkanContext.shaderPrograms[i];
+      if ((program.vertIdx != shaderIndex && program.fragIdx != shaderIndex) ||
+          program.vertIdx == -1 || program.fragIdx == -1)
+      {
+        continue;
+      }
+
+      // A newer rebuild of the same program supersedes one still compiling
+      state.pendingSwaps.erase(std::remove_if(state.pendingSwaps.begin(),
+                                              state.pendingSwaps.end(),
+          [i](const sklPendingSwap_t& _swap)
+      {
+        return _swap.programIndex == i;
+      }), state.pendingSwaps.end());
+
+      // The default pipeline is unspecialized, every variant used so far is rebuilt with it
+      std::vector<uint64_t> featureSets = { program.defaultFeatures };
+      for (const auto& variant : program.variants)
+      {
+        featureSets.push_back(variant.first);
+      }
+
+      for (uint64_t features : featureSets)
+      {
+        bool isDefault = features == program.defaultFeatures;
+        sklPendingSwap_t swap = {};
+        swap.programIndex = i;
+        swap.features = features;
+        swap.state = GetPipelineState(vulkanContext.shaders[program.vertIdx].module,
+                                      vulkanContext.shaders[program.fragIdx].module,
+                                      program.pipelineSettingsFlags,
+                                      isDefault ? 0 : program.featureMask, features);
+        swap.pipeline = SklPipelineBuilder::Submit(swap.state, program.pipelineLayout);
+        state.pendingSwaps.push_back(swap);
+      }
+    }
+
+    SKL_PRINT("Shader Hot Reload", "Reloaded %s, rebuilding %u pipelines", shader.name,
+              static_cast<uint32_t>(state.pendingSwaps.size()));
+  }
+}
+
+void SklShaderHotReload::Initialize(const char* _directory /*= "res/Shaders"*/,
+                                    const char* _compiler /*= nullptr*/)
+{
+  sklShaderHotReloadState_t& state = GetState();
+  if (state.running)
+    return;
+
+  state.directory = _directory;
+  if (_compiler != nullptr)
+  {
+    state.compiler = _compiler;
+  }
+  else
+  {
+    const char* sdk = std::getenv("VULKAN_SDK");
+#ifdef _WIN32
+    state.compiler = (sdk != nullptr) ? std::string(sdk) + "\\Bin\\glslc.exe" : "glslc.exe";
+#else
+    state.compiler = (sdk != nullptr) ? std::string(sdk) + "/bin/glslc" : "glslc";
+#endif
+  }
+
+  state.running = true;
+  state.watcher = std::thread(Watch);
+  SKL_PRINT("Shader Hot Reload", "Watching \"%s\"", state.directory.c_str());
+}
+
+void SklShaderHotReload::Shutdown()
+{
+  sklShaderHotReloadState_t& state = GetState();
+  state.running = false;
+  if (state.watcher.joinable())
+  {
+    state.watcher.join();
+  }
+
+  std::lock_guard<std::mutex> guard(state.lock);
+  for (const sklReloadedShader_t& reloaded : state.reloadedShaders)
+  {
+    SklShaderModuleCache::Release(reloaded.module);
+  }
+  state.reloadedShaders.clear();
+  state.pendingSwaps.clear();
+}
+
+void SklShaderHotReload::ApplyPending()
+{
+  sklShaderHotReloadState_t& state = GetState();
+  if (!state.running)
+    return;
+
+  SKL_PROFILE_FUNCTION();
+
+  std::vector<sklReloadedShader_t> reloaded;
+  {
+    std::lock_guard<std::mutex> guard(state.lock);
+    reloaded.swap(state.reloadedShaders);
+  }
+  for (sklReloadedShader_t& shader : reloaded)
+  {
+    SwapShader(shader);
+  }
+
+  // Pipelines still compiling are checked again next frame
+  for (auto swap = state.pendingSwaps.begin(); swap != state.pendingSwaps.end(); )
+  {
+    if (swap->pipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+      ++swap;
+      continue;
+    }
+
+    shaderProgram_t& program = vulkanContext.shaderPrograms[swap->programIndex];
+    try
+    {
+      if (swap->features == program.defaultFeatures)
+      {
+        program.pipeline = swap->pipeline.get();
+        program.pipelineState = swap->state;
+        program.pendingPipeline = {};
+      }
+      else
+      {
+        sklPipelineVariant_t& variant = program.variants[swap->features];
+        variant.pipeline = swap->pipeline.get();
+        variant.state = swap->state;
+        variant.pendingPipeline = {};
+      }
+      state.reloadCount++;
+    }
+    // Vulkan failures are thrown as strings, anything else is reported without a reason
+    catch (const std::exception& _error)
+    {
+      SKL_PRINT_WARNING("Shader Hot Reload", "%s kept its old pipeline: %s", program.name,
+                        _error.what());
+    }
+    catch (const char* _error)
+    {
+      SKL_PRINT_WARNING("Shader Hot Reload", "%s kept its old pipeline: %s", program.name,
+                        _error);
+    }
+    catch (...)
+    {
+      SKL_PRINT_WARNING("Shader Hot Reload", "%s kept its old pipeline", program.name);
+    }
+    swap = state.pendingSwaps.erase(swap);
+  }
+}
+
+uint32_t SklShaderHotReload::GetReloadCount()
+{
+  return GetState().reloadCount;
+}
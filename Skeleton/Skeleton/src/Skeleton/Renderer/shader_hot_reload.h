@@ -0,0 +1,34 @@
+
+#ifndef SKELETON_RENDERER_SHADER_HOT_RELOAD_H
+#define SKELETON_RENDERER_SHADER_HOT_RELOAD_H 1
+
+#include <cstdint>
+
+// Watches the shader directory and reloads shaders while the application runs
+// Edited GLSL is compiled to SPIR-V on a background thread, and the resulting binary is loaded
+//   and reflected there as well
+// Affected pipelines are rebuilt on the SklPipelineBuilder's workers, programs keep rendering
+//   with their old pipeline until the new one is ready and is swapped in between frames
+// Shaders whose bindings, block layouts, push constants, or inputs change can't be swapped in
+//   and are skipped
+class SklShaderHotReload
+{
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Starts watching _directory, recompiling with _compiler
+  // A null _compiler uses glslc from the Vulkan SDK, or from the path if the SDK isn't set
+  static void Initialize(const char* _directory = "res/Shaders", const char* _compiler = nullptr);
+  // Stops watching and releases reloaded shaders that were never swapped in
+  static void Shutdown();
+
+  // Swaps in reloaded shaders and finished pipelines, call between frames on the render thread
+  static void ApplyPending();
+
+  // Retrieves the number of rebuilt pipelines swapped in after reloads
+  static uint32_t GetReloadCount();
+
+}; // class SklShaderHotReload
+
+#endif // !SKELETON_RENDERER_SHADER_HOT_RELOAD_H
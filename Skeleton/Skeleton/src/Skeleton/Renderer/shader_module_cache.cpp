@@ -0,0 +1,116 @@
+#include "pch.h"
+#include "skeleton/renderer/shader_module_cache.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "skeleton/renderer/vulkan_context.h"
+#include "skeleton/core/debug_tools.h"
+
+namespace
+{
+  struct sklCachedModule_t
+  {
+    VkShaderModule module;
+    uint32_t references;
+  };
+
+  struct sklShaderModuleCacheState_t
+  {
+    std::mutex lock;
+    // Keyed by the binary's contents
+    std::unordered_map<std::string, sklCachedModule_t> modules;
+    // Finds a module's entry when it is released, keys of an unordered_map do not move
+    std::unordered_map<VkShaderModule, const std::string*> keys;
+  };
+
+  sklShaderModuleCacheState_t& GetState()
+  {
+    static sklShaderModuleCacheState_t state;
+    return state;
+  }
+}
+
+void SklShaderModuleCache::Shutdown()
+{
+  sklShaderModuleCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+
+  if (!state.modules.empty())
+  {
+    SKL_PRINT_WARNING("Shader Module Cache", "%u modules were still referenced at shutdown",
+                      static_cast<uint32_t>(state.modules.size()));
+  }
+
+  for (auto& m : state.modules)
+  {
+    vkDestroyShaderModule(vulkanContext.device, m.second.module, nullptr);
+  }
+  state.modules.clear();
+  state.keys.clear();
+}
+
+VkShaderModule SklShaderModuleCache::Acquire(const std::vector<char>& _code)
+{
+  sklShaderModuleCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+
+  std::string key(_code.data(), _code.size());
+  auto cached = state.modules.find(key);
+  if (cached != state.modules.end())
+  {
+    cached->second.references++;
+    return cached->second.module;
+  }
+
+  VkShaderModuleCreateInfo createInfo = {};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize = _code.size();
+  createInfo.pCode = reinterpret_cast<const uint32_t*>(_code.data());
+
+  VkShaderModule module;
+  SKL_ASSERT_VK(vkCreateShaderModule(vulkanContext.device, &createInfo, nullptr, &module),
+                "Failed to create shader module");
+
+  auto inserted = state.modules.emplace(std::move(key), sklCachedModule_t{ module, 1 });
+  state.keys[module] = &inserted.first->first;
+  return module;
+}
+
+void SklShaderModuleCache::AddReference(VkShaderModule _module)
+{
+  sklShaderModuleCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+
+  auto key = state.keys.find(_module);
+  if (key != state.keys.end())
+  {
+    state.modules[*key->second].references++;
+  }
+}
+
+void SklShaderModuleCache::Release(VkShaderModule _module)
+{
+  sklShaderModuleCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+
+  auto key = state.keys.find(_module);
+  if (key == state.keys.end())
+    return;
+
+  auto cached = state.modules.find(*key->second);
+  if (--cached->second.references > 0)
+    return;
+
+  vkDestroyShaderModule(vulkanContext.device, _module, nullptr);
+  state.keys.erase(key);
+  state.modules.erase(cached);
+}
+
+uint32_t SklShaderModuleCache::GetModuleCount()
+{
+  sklShaderModuleCacheState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  return static_cast<uint32_t>(state.modules.size());
+}
@@ -0,0 +1,36 @@
+
+#ifndef SKELETON_RENDERER_SHADER_MODULE_CACHE_H
+#define SKELETON_RENDERER_SHADER_MODULE_CACHE_H 1
+
+#include <cstdint>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+// Owns every shader module and shares them between their users
+// Modules are keyed by their SPIR-V's contents, so identical binaries only create one module
+// Shaders and the pipelines built from them each hold a reference, a module is destroyed once
+//   its last reference is released
+class SklShaderModuleCache
+{
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Destroys every module, warning about any still referenced
+  static void Shutdown();
+
+  // Retrieves the module for a SPIR-V binary, creating it if it is new
+  // The caller holds a reference to the module until it releases it
+  static VkShaderModule Acquire(const std::vector<char>& _code);
+  // Adds a reference to a module retrieved from Acquire
+  static void AddReference(VkShaderModule _module);
+  // Removes a reference, destroying the module if it was the last
+  static void Release(VkShaderModule _module);
+
+  // Retrieves the number of live modules
+  static uint32_t GetModuleCount();
+
+}; // class SklShaderModuleCache
+
+#endif // !SKELETON_RENDERER_SHADER_MODULE_CACHE_H
@@ -4,10 +4,75 @@
 
 #include <string>
 #include <inttypes.h>
+#include <chrono>
+#include <algorithm>
 
 #include "skeleton/renderer/render_backend.h"
 #include "skeleton/core/file_system.h"
 #include "skeleton/core/vertex.h"
+#include "skeleton/core/profiler.h"
+#include "skeleton/renderer/pipeline_cache.h"
+#include "skeleton/renderer/pipeline_builder.h"
+#include "skeleton/renderer/descriptor_cache.h"
+#include "skeleton/renderer/bindless.h"
+#include "skeleton/renderer/shader_module_cache.h"
+
+namespace
+{
+  // Reads a field of a pipeline settings word as an index
+  uint32_t SettingsField(uint64_t _settings, uint64_t _bits)
+  {
+    uint32_t shift = 0;
+    while (((_bits >> shift) & 1) == 0)
+      shift++;
+    return static_cast<uint32_t>((_settings & _bits) >> shift);
+  }
+
+  VkCullModeFlags CullModeOf(uint64_t _settings)
+  {
+    static const VkCullModeFlags modes[] = { VK_CULL_MODE_NONE, VK_CULL_MODE_FRONT_BIT,
+        VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_AND_BACK };
+    return modes[SettingsField(_settings, Skl_Cull_Mode_Bits)];
+  }
+
+  VkFrontFace FrontFaceOf(uint64_t _settings)
+  {
+    return (_settings & Skl_Front_Face_Clockwise) ? VK_FRONT_FACE_CLOCKWISE :
+                                                     VK_FRONT_FACE_COUNTER_CLOCKWISE;
+  }
+
+  VkCompareOp DepthCompareOf(uint64_t _settings)
+  {
+    static const VkCompareOp compares[] = { VK_COMPARE_OP_LESS, VK_COMPARE_OP_LESS_OR_EQUAL,
+        VK_COMPARE_OP_EQUAL, VK_COMPARE_OP_GREATER, VK_COMPARE_OP_GREATER_OR_EQUAL,
+        VK_COMPARE_OP_NOT_EQUAL, VK_COMPARE_OP_ALWAYS, VK_COMPARE_OP_NEVER };
+    return compares[SettingsField(_settings, Skl_Depth_Compare_Bits)];
+  }
+
+  VkPrimitiveTopology TopologyOf(uint64_t _settings)
+  {
+    static const VkPrimitiveTopology topologies[] = { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN,
+        VK_PRIMITIVE_TOPOLOGY_LINE_LIST, VK_PRIMITIVE_TOPOLOGY_LINE_STRIP,
+        VK_PRIMITIVE_TOPOLOGY_POINT_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST };
+    return topologies[SettingsField(_settings, Skl_Topology_Bits)];
+  }
+
+  VkPolygonMode PolygonModeOf(uint64_t _settings)
+  {
+    static const VkPolygonMode modes[] = { VK_POLYGON_MODE_FILL, VK_POLYGON_MODE_LINE,
+        VK_POLYGON_MODE_POINT, VK_POLYGON_MODE_FILL };
+    return modes[SettingsField(_settings, Skl_Polygon_Mode_Bits)];
+  }
+
+  // Samples are stored as log2(count) + 1, leaving 0 for the render pass's count
+  VkSampleCountFlagBits SamplesOf(uint64_t _settings)
+  {
+    uint32_t field = SettingsField(_settings, Skl_Samples_Bits);
+    return static_cast<VkSampleCountFlagBits>(field ? (1u << (field - 1)) : 1u);
+  }
+}
 
 VkPipeline shaderProgram_t::GetPipeline(VkShaderModule _vertMod, VkShaderModule _fragMod)
 {
@@ -16,26 +81,64 @@ VkPipeline shaderProgram_t::GetPipeline(VkShaderModule _vertMod, VkShaderModule
     return pipeline;
   }
 
-  pipeline = CreatePipeline(_vertMod, _fragMod, pipelineLayout, pipelineSettingsFlags);
+  if (!pendingPipeline.valid())
+  {
+    pipelineState = GetPipelineState(_vertMod, _fragMod, pipelineSettingsFlags);
+    pendingPipeline = SklPipelineBuilder::Submit(pipelineState, pipelineLayout);
+  }
+
+  SKL_PROFILE_ZONE("Wait For Pipeline");
+  pipeline = pendingPipeline.get();
+  pendingPipeline = {};
   return pipeline;
 }
 
+VkPipeline shaderProgram_t::GetPipeline(VkShaderModule _vertMod, VkShaderModule _fragMod,
+                                        uint64_t _features)
+{
+  _features &= featureMask;
+  if (_features == defaultFeatures)
+  {
+    return GetPipeline(_vertMod, _fragMod);
+  }
+
+  sklPipelineVariant_t& variant = variants[_features];
+  if (variant.pipeline != VK_NULL_HANDLE)
+  {
+    return variant.pipeline;
+  }
+
+  if (!variant.pendingPipeline.valid())
+  {
+    variant.state = GetPipelineState(_vertMod, _fragMod, pipelineSettingsFlags, featureMask,
+                                     _features);
+    variant.pendingPipeline = SklPipelineBuilder::Submit(variant.state, pipelineLayout);
+  }
+
+  SKL_PROFILE_ZONE("Wait For Pipeline");
+  variant.pipeline = variant.pendingPipeline.get();
+  variant.pendingPipeline = {};
+  return variant.pipeline;
+}
+
 uint32_t GetShaderProgram(const char* _name, sklShaderStageFlags _stages,
                           uint64_t _pipelineSettings /*= Skl_Pipeline_Default_Settings*/)
 {
-  for (uint32_t i = 0; i < vulkanContext.shaderPrograms.size(); i++)
+  std::string key(_name);
+  key.append("#").append(std::to_string(_stages)).append("#");
+  key.append(std::to_string(_pipelineSettings));
+
+  auto existing = vulkanContext.shaderProgramLookup.find(key);
+  if (existing != vulkanContext.shaderProgramLookup.end())
   {
-    shaderProgram_t& prog = vulkanContext.shaderPrograms[i];
-    if (prog.pipelineSettingsFlags == _pipelineSettings && std::strcmp(_name, prog.name) == 0)
-    {
-      return i;
-    }
+    return existing->second;
   }
 
   uint32_t index = static_cast<uint32_t>(vulkanContext.shaderPrograms.size());
   SKL_PRINT_SIMPLE("Creating new program for \"%s\"(%"PRIu64") at %u",
                    _name, _pipelineSettings, index);
   CreateShaderProgram(_name, _stages, _pipelineSettings);
+  vulkanContext.shaderProgramLookup[key] = index;
   return index;
 }
 
@@ -59,34 +162,158 @@ void CreateShaderProgram(const char* _name, sklShaderStageFlags _stages,
   prog.vertIdx = vertIdx;
   prog.fragIdx = fragIdx;
   CreateDescriptorSetLayout(prog);
+
+  // Boolean specialization constants are the program's feature toggles
+  for (uint32_t index : { vertIdx, fragIdx })
+  {
+    if (index == -1)
+      continue;
+
+    for (const sklReflectedSpecConstant_t& constant :
+         vulkanContext.shaders[index].reflection.specConstants)
+    {
+      if (!constant.isBool)
+        continue;
+      if (constant.id >= 64)
+      {
+        SKL_PRINT_WARNING("Shader Program", "\"%s\" can't toggle \"%s\", its constant_id is 64+",
+                          _name, constant.name.c_str());
+        continue;
+      }
+
+      prog.featureMask |= 1ull << constant.id;
+      if (constant.defaultValue)
+        prog.defaultFeatures |= 1ull << constant.id;
+    }
+  }
+
+  if (vertIdx != -1 && fragIdx != -1)
+  {
+    prog.pipelineState = GetPipelineState(vulkanContext.shaders[vertIdx].module,
+                                          vulkanContext.shaders[fragIdx].module,
+                                          _pipelineSettings);
+    prog.pendingPipeline = SklPipelineBuilder::Submit(prog.pipelineState, prog.pipelineLayout);
+  }
   vulkanContext.shaderPrograms.push_back(prog);
 }
 
-VkPipeline CreatePipeline(VkShaderModule _vertModule, VkShaderModule _fragModule,
-                          VkPipelineLayout _pipeLayout, uint64_t _pipelineSettings)
+uint64_t GetShaderFeature(uint32_t _programIndex, const char* _name)
+{
+  const shaderProgram_t& program = vulkanContext.shaderPrograms[_programIndex];
+  for (uint32_t index : { program.vertIdx, program.fragIdx })
+  {
+    if (index == -1)
+      continue;
+
+    for (const sklReflectedSpecConstant_t& constant :
+         vulkanContext.shaders[index].reflection.specConstants)
+    {
+      if (constant.name == _name && constant.isBool && constant.id < 64)
+        return 1ull << constant.id;
+    }
+  }
+
+  SKL_PRINT_WARNING("Shader Program", "\"%s\" has no feature \"%s\"", program.name, _name);
+  return 0;
+}
+
+void PrewarmShaderVariants(uint32_t _programIndex, const std::vector<uint64_t>& _featureSets)
+{
+  shaderProgram_t& program = vulkanContext.shaderPrograms[_programIndex];
+  if (program.vertIdx == -1 || program.fragIdx == -1)
+    return;
+
+  for (uint64_t features : _featureSets)
+  {
+    features &= program.featureMask;
+    if (features == program.defaultFeatures || program.variants.count(features))
+      continue;
+
+    sklPipelineVariant_t& variant = program.variants[features];
+    variant.state = GetPipelineState(vulkanContext.shaders[program.vertIdx].module,
+                                     vulkanContext.shaders[program.fragIdx].module,
+                                     program.pipelineSettingsFlags, program.featureMask,
+                                     features);
+    variant.pendingPipeline = SklPipelineBuilder::Submit(variant.state, program.pipelineLayout);
+  }
+}
+
+sklPipelineState_t GetPipelineState(VkShaderModule _vertModule, VkShaderModule _fragModule,
+                                    uint64_t _pipelineSettings, uint64_t _featureMask /*= 0*/,
+                                    uint64_t _features /*= 0*/)
+{
+  sklPipelineState_t state = {};
+  state.vertModule = _vertModule;
+  state.fragModule = _fragModule;
+  state.featureMask = _featureMask;
+  state.features = _features & _featureMask;
+
+  // Vertex format
+  //=================================================
+  state.vertexStride = vertex_t::GetBindingDescription().stride;
+  state.vertexAttributes = 0;
+  for (const auto& attrib : vertex_t::GetAttributeDescriptions())
+  {
+    uint64_t packed = (uint64_t(attrib.location) << 48) ^ (uint64_t(attrib.format) << 24) ^
+                      attrib.offset;
+    state.vertexAttributes = state.vertexAttributes * 31 + std::hash<uint64_t>()(packed);
+  }
+
+  // Fixed-function state
+  //=================================================
+  state.settings = _pipelineSettings;
+
+  if ((state.settings & Skl_Polygon_Mode_Bits) != Skl_Polygon_Mode_Fill &&
+      !vulkanContext.gpu.features.fillModeNonSolid)
+  {
+    SKL_PRINT_WARNING("Shader Program", "Lines and points are unsupported, filling instead");
+    state.settings &= ~uint64_t(Skl_Polygon_Mode_Bits);
+  }
+
+  // Render pass compatibility
+  //=================================================
+  state.colorFormat = vulkanContext.renderPassColorFormat;
+  state.depthFormat = vulkanContext.renderPassDepthFormat;
+
+  uint64_t passSamples = 1;
+  while ((1u << (passSamples - 1)) < static_cast<uint32_t>(vulkanContext.renderPassSamples))
+    passSamples++;
+  uint64_t samples = (state.settings & Skl_Samples_Bits) >> 16;
+
+  // A pipeline must match its render pass's sample count to be used within it
+  if (samples != 0 && samples != passSamples)
+  {
+    SKL_PRINT_WARNING("Shader Program",
+                      "%u samples requested but the render pass uses %u, using the render pass's",
+                      1u << (samples - 1), static_cast<uint32_t>(vulkanContext.renderPassSamples));
+    samples = 0;
+  }
+
+  // Stored explicitly so pipelines for different render passes are told apart
+  if (samples == 0)
+  {
+    state.settings &= ~uint64_t(Skl_Samples_Bits);
+    state.settings |= passSamples << 16;
+  }
+
+  return state;
+}
+
+VkPipeline CreatePipeline(const sklPipelineState_t& _state, VkPipelineLayout _pipeLayout)
 {
+  SKL_PROFILE_FUNCTION();
+
   // Initialize all VkCreateInfo structs
 
   // Viewport State
   //=================================================
-  VkViewport viewport;
-  viewport.x = 0;
-  viewport.y = 0;
-  viewport.width = (float)vulkanContext.renderExtent.width;
-  viewport.height = (float)vulkanContext.renderExtent.height;
-  viewport.minDepth = 0;
-  viewport.maxDepth = 1;
-
-  VkRect2D scissor = {};
-  scissor.extent = vulkanContext.renderExtent;
-  scissor.offset = { 0, 0 };
-
+  // The viewport and scissor are dynamic, so pipelines are independent of the render extent
   VkPipelineViewportStateCreateInfo viewportStateInfo = {};
   viewportStateInfo.sType =VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
   viewportStateInfo.scissorCount = 1;
-  viewportStateInfo.pScissors = &scissor;
+  viewportStateInfo.pScissors = nullptr;
   viewportStateInfo.viewportCount = 1;
-  viewportStateInfo.pViewports = &viewport;
+  viewportStateInfo.pViewports = nullptr;
 
   // Vert Input State
   //=================================================
@@ -105,53 +332,60 @@ VkPipeline CreatePipeline(VkShaderModule _vertModule, VkShaderModule _fragModule
   //=================================================
   VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateInfo = {};
   inputAssemblyStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-  inputAssemblyStateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  inputAssemblyStateInfo.topology = TopologyOf(_state.settings);
   inputAssemblyStateInfo.primitiveRestartEnable = VK_FALSE;
 
   // Rasterizer
   //=================================================
   VkPipelineRasterizationStateCreateInfo rasterStateInfo = {};
   rasterStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-  rasterStateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-  rasterStateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+  rasterStateInfo.polygonMode = PolygonModeOf(_state.settings);
+  rasterStateInfo.frontFace = FrontFaceOf(_state.settings);
   //rasterStateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
   rasterStateInfo.rasterizerDiscardEnable = VK_TRUE;
   rasterStateInfo.lineWidth = 1.f;
   rasterStateInfo.depthBiasEnable = VK_FALSE;
   rasterStateInfo.depthClampEnable = VK_FALSE;
   rasterStateInfo.rasterizerDiscardEnable = VK_FALSE;
-
-  switch (_pipelineSettings & Skl_Cull_Mode_Bits)
-  {
-  case Skl_Cull_Mode_None:  rasterStateInfo.cullMode = VK_CULL_MODE_NONE;           break;
-  case Skl_Cull_Mode_Back:  rasterStateInfo.cullMode = VK_CULL_MODE_BACK_BIT;       break;
-  case Skl_Cull_Mode_Front: rasterStateInfo.cullMode = VK_CULL_MODE_FRONT_BIT;      break;
-  case Skl_Cull_Mode_Both:  rasterStateInfo.cullMode = VK_CULL_MODE_FRONT_AND_BACK; break;
-  }
+  rasterStateInfo.cullMode = CullModeOf(_state.settings);
 
   // Multisample State
   //=================================================
   VkPipelineMultisampleStateCreateInfo multisampleStateInfo = {};
   multisampleStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  multisampleStateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  multisampleStateInfo.rasterizationSamples = SamplesOf(_state.settings);
   multisampleStateInfo.sampleShadingEnable = VK_FALSE;
 
   // Depth State
   //=================================================
   VkPipelineDepthStencilStateCreateInfo depthStateInfo = {};
   depthStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-  depthStateInfo.depthTestEnable = VK_TRUE;
-  depthStateInfo.depthWriteEnable = VK_TRUE;
-  depthStateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+  depthStateInfo.depthTestEnable = (_state.settings & Skl_Depth_Test_Disable) ? VK_FALSE : VK_TRUE;
+  depthStateInfo.depthWriteEnable =
+      (_state.settings & Skl_Depth_Write_Disable) ? VK_FALSE : VK_TRUE;
+  depthStateInfo.depthCompareOp = DepthCompareOf(_state.settings);
   depthStateInfo.back.compareOp = VK_COMPARE_OP_ALWAYS;
   depthStateInfo.depthBoundsTestEnable = VK_FALSE;
 
   // Color Blend State
   //=================================================
   VkPipelineColorBlendAttachmentState blendAttachmentState = {};
-  blendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                                        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-  blendAttachmentState.blendEnable = VK_FALSE;
+  if ((_state.settings & Skl_Color_Write_Disable) == 0)
+  {
+    blendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  }
+
+  uint64_t blend = _state.settings & Skl_Blend_Bits;
+  blendAttachmentState.blendEnable = (blend != Skl_Blend_None) ? VK_TRUE : VK_FALSE;
+  blendAttachmentState.srcColorBlendFactor =
+      (blend == Skl_Blend_Premultiplied) ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_SRC_ALPHA;
+  blendAttachmentState.dstColorBlendFactor =
+      (blend == Skl_Blend_Additive) ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+  blendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+  blendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  blendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+  blendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
 
   VkPipelineColorBlendStateCreateInfo blendStateInfo = {};
   blendStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -161,24 +395,63 @@ VkPipeline CreatePipeline(VkShaderModule _vertModule, VkShaderModule _fragModule
 
   // Dynamic states
   //=================================================
+  std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT,
+                                                VK_DYNAMIC_STATE_SCISSOR };
+  if (vulkanContext.extendedDynamicState)
+  {
+    dynamicStates.push_back(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+    dynamicStates.push_back(VK_DYNAMIC_STATE_FRONT_FACE_EXT);
+    dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT);
+    dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT);
+    dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT);
+  }
+
   VkPipelineDynamicStateCreateInfo dynamicStateInfo = {};
   dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-  dynamicStateInfo.dynamicStateCount = 0;
-  dynamicStateInfo.pDynamicStates = nullptr;
+  dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+  dynamicStateInfo.pDynamicStates = dynamicStates.data();
+
+  // Shader features
+  //=================================================
+  // Both stages get every feature, a stage ignores entries for constants it doesn't declare
+  std::vector<VkSpecializationMapEntry> featureEntries;
+  std::vector<VkBool32> featureValues;
+  for (uint32_t id = 0; id < 64; id++)
+  {
+    if ((_state.featureMask & (1ull << id)) == 0)
+      continue;
+
+    VkSpecializationMapEntry entry = {};
+    entry.constantID = id;
+    entry.offset = static_cast<uint32_t>(featureValues.size() * sizeof(VkBool32));
+    entry.size = sizeof(VkBool32);
+    featureEntries.push_back(entry);
+    featureValues.push_back((_state.features & (1ull << id)) ? VK_TRUE : VK_FALSE);
+  }
+
+  VkSpecializationInfo specializationInfo = {};
+  specializationInfo.mapEntryCount = static_cast<uint32_t>(featureEntries.size());
+  specializationInfo.pMapEntries = featureEntries.data();
+  specializationInfo.dataSize = featureValues.size() * sizeof(VkBool32);
+  specializationInfo.pData = featureValues.data();
+  const VkSpecializationInfo* specialization =
+      featureEntries.empty() ? nullptr : &specializationInfo;
 
   // Shader modules
   //=================================================
   VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
   vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-  vertShaderStageInfo.module = _vertModule;
+  vertShaderStageInfo.module = _state.vertModule;
   vertShaderStageInfo.pName = "main";
+  vertShaderStageInfo.pSpecializationInfo = specialization;
 
   VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
   fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  fragShaderStageInfo.module = _fragModule;
+  fragShaderStageInfo.module = _state.fragModule;
   fragShaderStageInfo.pName = "main";
+  fragShaderStageInfo.pSpecializationInfo = specialization;
 
   VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
@@ -202,33 +475,58 @@ VkPipeline CreatePipeline(VkShaderModule _vertModule, VkShaderModule _fragModule
   createInfo.renderPass = vulkanContext.renderPass;
 
   VkPipeline tmpPipeline = VK_NULL_HANDLE;
+  auto compileStart = std::chrono::steady_clock::now();
   SKL_ASSERT_VK(
-      vkCreateGraphicsPipelines(vulkanContext.device, nullptr, 1,
+      vkCreateGraphicsPipelines(vulkanContext.device, SklPipelineCache::Get(), 1,
                                 &createInfo, nullptr, &tmpPipeline),
       "Failed to create graphics pipeline");
-
-  vkDestroyShaderModule(vulkanContext.device, _vertModule, nullptr);
-  vkDestroyShaderModule(vulkanContext.device, _fragModule, nullptr);
+  SklPipelineCache::RecordCreation(std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - compileStart).count());
 
   return tmpPipeline;
 }
 
+void SetDynamicPipelineState(VkCommandBuffer _command, const sklPipelineState_t& _state)
+{
+  vulkanContext.vkCmdSetCullModeEXT(_command, CullModeOf(_state.settings));
+  vulkanContext.vkCmdSetFrontFaceEXT(_command, FrontFaceOf(_state.settings));
+  vulkanContext.vkCmdSetDepthTestEnableEXT(_command,
+      (_state.settings & Skl_Depth_Test_Disable) ? VK_FALSE : VK_TRUE);
+  vulkanContext.vkCmdSetDepthWriteEnableEXT(_command,
+      (_state.settings & Skl_Depth_Write_Disable) ? VK_FALSE : VK_TRUE);
+  vulkanContext.vkCmdSetDepthCompareOpEXT(_command, DepthCompareOf(_state.settings));
+}
+
+void PushDrawConstants(VkCommandBuffer _command, const shaderProgram_t& _program,
+                       const void* _data, uint32_t _size)
+{
+  const VkPushConstantRange& range = _program.pushConstantRange;
+  if (range.size == 0 || _size <= range.offset)
+    return;
+
+  // _data mirrors the whole block, so the range's bytes start at its offset
+  const char* rangeData = static_cast<const char*>(_data) + range.offset;
+  vkCmdPushConstants(_command, _program.pipelineLayout, range.stageFlags, range.offset,
+                     std::min(_size - range.offset, range.size), rangeData);
+}
+
 uint32_t GetShader(const char* _name, sklShaderStageFlags _stage)
 {
-  for (uint32_t i = 0; i < vulkanContext.shaders.size(); i++)
+  std::string key(_name);
+  key.append("#").append(std::to_string(_stage));
+
+  auto existing = vulkanContext.shaderLookup.find(key);
+  if (existing != vulkanContext.shaderLookup.end())
   {
-    shader_t& shader = vulkanContext.shaders[i];
-    if (std::strcmp(shader.name, _name) == 0 && shader.stage == _stage)
-    {
-      LoadShader(i);
-      return i;
-    }
+    LoadShader(existing->second);
+    return existing->second;
   }
 
   shader_t shader(_name);
   shader.stage = _stage;
   uint32_t index = static_cast<uint32_t>(vulkanContext.shaders.size());
   vulkanContext.shaders.push_back(shader);
+  vulkanContext.shaderLookup[key] = index;
 
   LoadShader(index);
   return index;
@@ -245,157 +543,258 @@ void LoadShader(shader_t& _shader)
   // Construct shader directories from its name
   std::string shaderDirectory = "res\\Shaders\\";
   shaderDirectory.append(_shader.name);
-  std::string layoutDirectory(shaderDirectory);
 
   switch (_shader.stage)
   {
   case Skl_Shader_Vert_Stage:
     shaderDirectory.append(".vspv");
-    layoutDirectory.append(".vlayout");
     break;
   case Skl_Shader_Frag_Stage:
     shaderDirectory.append(".fspv");
-    layoutDirectory.append(".flayout");
     break;
   case Skl_Shader_Comp_Stage:
     shaderDirectory.append(".cspv");
-    layoutDirectory.append(".flayout");
     break;
   }
 
-  // Load and create shader module
+  // Load the binary once, shaders with identical binaries share a module
   std::vector<char> shaderSource = LoadFile(shaderDirectory.c_str());
-  VkShaderModuleCreateInfo moduleCreateInfo = {};
-  moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-  moduleCreateInfo.codeSize = shaderSource.size();
-  moduleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(shaderSource.data());
-
-  SKL_ASSERT_VK(
-    vkCreateShaderModule(vulkanContext.device, &moduleCreateInfo, nullptr, &_shader.module),
-    "Failed to create shader module");
+  if (shaderSource.empty())
+  {
+    SKL_LOG(SKL_ERROR, "Failed to load shader binary \"%s\"", shaderDirectory.c_str());
+    throw std::runtime_error("Failed to load shader binary");
+  }
+  _shader.module = SklShaderModuleCache::Acquire(shaderSource);
 
-  ExtractShaderBindings(layoutDirectory.c_str(), _shader);
+  // Bindings, push constants, and inputs are read from the binary itself
+  _shader.reflection = SklShaderReflection::Reflect(shaderSource);
+  if (!_shader.reflection.valid)
+  {
+    SklShaderModuleCache::Release(_shader.module);
+    _shader.module = VK_NULL_HANDLE;
+    SKL_LOG(SKL_ERROR, "Failed to reflect \"%s\"", shaderDirectory.c_str());
+    throw std::runtime_error("Failed to reflect shader");
+  }
 }
 
-// TODO : Make this function a lot more robust
-void ExtractShaderBindings(const char* _layoutDirectory, shader_t& _shader)
+namespace
 {
-  std::vector<char> layoutSource = LoadFile(_layoutDirectory);
-  std::string layout(layoutSource.data());
-  uint32_t i = 0;
-  while (layout[i] == 'b' || layout[i] == 's')
+  // Checks that a vertex shader's inputs can be fed from vertex_t
+  void ValidateVertexInputs(const shaderProgram_t& _program, const shader_t& _shader)
+  {
+    std::vector<VkVertexInputAttributeDescription> attributes =
+        vertex_t::GetAttributeDescriptions();
+
+    for (const sklReflectedInput_t& input : _shader.reflection.inputs)
+    {
+      auto attribute = std::find_if(attributes.begin(), attributes.end(),
+          [&input](const VkVertexInputAttributeDescription& _attribute)
+      {
+        return _attribute.location == input.location;
+      });
+
+      if (attribute == attributes.end() || attribute->format != input.format)
+      {
+        SKL_LOG(SKL_ERROR, "%s input \"%s\" at location %u does not match the vertex format",
+                _program.name, input.name.c_str(), input.location);
+        throw std::runtime_error("Shader inputs do not match the vertex format");
+      }
+    }
+  }
+
+  // Adds a stage's bindings to the program's, merging bindings declared by several stages
+  void MergeBindings(const shaderProgram_t& _program, const sklShaderReflection_t& _reflection,
+                     std::vector<sklReflectedBinding_t>& _bindings)
   {
-    switch (layout[i])
+    for (const sklReflectedBinding_t& binding : _reflection.bindings)
     {
-      // buffer
-    case 'b':
-      _shader.bindings.push_back(Skl_Binding_Buffer);
-      break;
-      // sampler
-    case 's':
-      _shader.bindings.push_back(Skl_Binding_Sampler);
-      break;
-      // push constant
-      //case 'p':
-      //	break;
+      // Programs own a single descriptor set
+      if (binding.set != 0)
+      {
+        SKL_LOG(SKL_ERROR, "%s binding \"%s\" uses set %u, only set 0 is supported",
+                _program.name, binding.name.c_str(), binding.set);
+        throw std::runtime_error("Shader uses an unsupported descriptor set");
+      }
+
+      auto existing = std::find_if(_bindings.begin(), _bindings.end(),
+          [&binding](const sklReflectedBinding_t& _other)
+      {
+        return _other.binding == binding.binding;
+      });
+
+      if (existing == _bindings.end())
+      {
+        _bindings.push_back(binding);
+      }
+      else if (existing->type != binding.type || existing->count != binding.count)
+      {
+        SKL_LOG(SKL_ERROR, "%s stages disagree on the type of binding %u",
+                _program.name, binding.binding);
+        throw std::runtime_error("Shader stages declare conflicting bindings");
+      }
+      else
+      {
+        existing->stages |= binding.stages;
+      }
     }
-    i++;
   }
 }
 
 void CreateDescriptorSetLayout(shaderProgram_t& _program)
 {
-  std::vector<VkDescriptorSetLayoutBinding> bindings;
-  VkDescriptorSetLayoutBinding binding = {};
-  binding.descriptorCount = 1;
-  binding.pImmutableSamplers = nullptr;
-
-  uint32_t bindingIndex = 0; // Tracks what binding is being set across shader types
+  std::vector<sklReflectedBinding_t> bindings;
+  std::vector<sklReflectedMember_t> pushMembers;
+  _program.pushConstantRange = {};
 
-  // Create binding information for each shader type
-  binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-  if (_program.vertIdx != -1)
+  // Gather each stage's bindings and push constants
+  //=================================================
+  uint32_t stageIndices[3] = { _program.vertIdx, _program.fragIdx, _program.compIdx };
+  for (uint32_t i = 0; i < 3; i++)
   {
-    shader_t& shader = vulkanContext.shaders[_program.vertIdx];
+    if (stageIndices[i] == -1)
+      continue;
+
+    const sklShaderReflection_t& reflection = vulkanContext.shaders[stageIndices[i]].reflection;
+    MergeBindings(_program, reflection, bindings);
 
-    for (uint32_t i = 0; i < shader.bindings.size(); i++)
+    // Every stage reading push constants shares one range
+    const VkPushConstantRange& push = reflection.pushConstants;
+    if (push.size > 0)
     {
-      switch (shader.bindings[i])
+      VkPushConstantRange& range = _program.pushConstantRange;
+      uint32_t end = std::max(range.offset + range.size, push.offset + push.size);
+      range.offset = (range.size == 0) ? push.offset : std::min(range.offset, push.offset);
+      range.size = end - range.offset;
+      range.stageFlags |= push.stageFlags;
+    }
+    for (const sklReflectedMember_t& member : reflection.pushConstantMembers)
+    {
+      bool known = std::any_of(pushMembers.begin(), pushMembers.end(),
+          [&member](const sklReflectedMember_t& _other)
       {
-      case Skl_Binding_Buffer:
-        binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; break;
-      case Skl_Binding_Sampler:
-        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; break;
-      }
-      binding.binding = bindingIndex++;
-      bindings.push_back(binding);
-      _program.bindings.push_back(shader.bindings[i]);
+        return _other.offset == member.offset;
+      });
+      if (!known)
+        pushMembers.push_back(member);
     }
   }
 
-  binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-  if (_program.fragIdx != -1)
+  if (_program.vertIdx != -1)
   {
-    shader_t& shader = vulkanContext.shaders[_program.fragIdx];
+    ValidateVertexInputs(_program, vulkanContext.shaders[_program.vertIdx]);
+  }
 
-    for (uint32_t i = 0; i < shader.bindings.size(); i++)
+  std::sort(bindings.begin(), bindings.end(),
+            [](const sklReflectedBinding_t& _a, const sklReflectedBinding_t& _b)
+  {
+    return _a.binding < _b.binding;
+  });
+  std::sort(pushMembers.begin(), pushMembers.end(),
+            [](const sklReflectedMember_t& _a, const sklReflectedMember_t& _b)
+  {
+    return _a.offset < _b.offset;
+  });
+
+  // Bindless programs index the global set, their bindings only describe what to push
+  // Each pushed index is a uint whose name ends in what it indexes, "Buffer" for the buffer
+  //   array and "Texture" for the texture array, anything else is rejected
+  // Indices are pushed packed from offset 0, so member k must sit at offset 4k
+  // The bindless layout's push constants hold resource indices, so per-draw data is unavailable
+  if (vulkanContext.bindless)
+  {
+    for (const sklReflectedBinding_t& binding : bindings)
     {
-      switch (shader.bindings[i])
+      bool isGlobalArray =
+          (binding.binding == 0 && binding.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) ||
+          (binding.binding == 1 && binding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+      if (!isGlobalArray)
       {
-      case Skl_Binding_Buffer:
-        binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; break;
-      case Skl_Binding_Sampler:
-        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; break;
+        SKL_LOG(SKL_ERROR, "%s binding \"%s\" is not part of the bindless set",
+                _program.name, binding.name.c_str());
+        throw std::runtime_error("Shader is not written for bindless rendering");
       }
-      binding.binding = bindingIndex++;
-      bindings.push_back(binding);
-      _program.bindings.push_back(shader.bindings[i]);
     }
-  }
 
-  binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-  if (_program.compIdx != -1)
-  {
-    shader_t& shader = vulkanContext.shaders[_program.compIdx];
+    if (pushMembers.size() > SKL_BINDLESS_MAX_INDICES)
+    {
+      SKL_LOG(SKL_ERROR, "%s pushes %u bindless indices, at most %u are supported",
+              _program.name, static_cast<uint32_t>(pushMembers.size()),
+              SKL_BINDLESS_MAX_INDICES);
+      throw std::runtime_error("Shader pushes too many bindless indices");
+    }
 
-    for (uint32_t i = 0; i < shader.bindings.size(); i++)
+    _program.bindings.clear();
+    auto endsWith = [](const std::string& _name, const std::string& _suffix)
+    {
+      return _name.size() > _suffix.size() &&
+             _name.compare(_name.size() - _suffix.size(), _suffix.size(), _suffix) == 0;
+    };
+    for (const sklReflectedMember_t& member : pushMembers)
     {
-      switch (shader.bindings[i])
+      bool isBuffer = endsWith(member.name, "Buffer");
+      bool isTexture = endsWith(member.name, "Texture");
+      if ((!isBuffer && !isTexture) || member.size != sizeof(uint32_t))
+      {
+        SKL_LOG(SKL_ERROR, "%s push constant \"%s\" must be a uint ending in Buffer or Texture",
+                _program.name, member.name.c_str());
+        throw std::runtime_error("Shader pushes an unrecognized bindless index");
+      }
+
+      uint32_t expectedOffset = static_cast<uint32_t>(_program.bindings.size() * sizeof(uint32_t));
+      if (member.offset != expectedOffset)
       {
-      case Skl_Binding_Buffer:
-        binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; break;
-      case Skl_Binding_Sampler:
-        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; break;
+        SKL_LOG(SKL_ERROR, "%s push constant \"%s\" is at offset %u, expected %u",
+                _program.name, member.name.c_str(), member.offset, expectedOffset);
+        throw std::runtime_error("Shader's bindless indices are not tightly packed");
       }
-      binding.binding = bindingIndex++;
-      bindings.push_back(binding);
-      _program.bindings.push_back(shader.bindings[i]);
+      _program.bindings.push_back(isBuffer ? Skl_Binding_Buffer : Skl_Binding_Sampler);
     }
-  }
 
-  VkDescriptorSetLayoutCreateInfo createInfo = {};
-  createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-  createInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-  createInfo.pBindings = bindings.data();
-  SKL_PRINT("ShaderProgram", "%s has %u bindings", _program.name,
-            static_cast<uint32_t>(bindings.size()));
+    SKL_PRINT("ShaderProgram", "%s pushes %u bindless indices", _program.name,
+              static_cast<uint32_t>(_program.bindings.size()));
 
-  SKL_ASSERT_VK(vkCreateDescriptorSetLayout(vulkanContext.device, &createInfo,
-                                            nullptr, &_program.descriptorSetLayout),
-                "Failed to create descriptor set layout");
+    _program.reflectedBindings.clear();
+    _program.pushConstantRange = {};
+    _program.descriptorSetLayout = SklBindless::GetSetLayout();
+    _program.pipelineLayout = SklBindless::GetPipelineLayout();
+    return;
+  }
 
-  // Pipeline Layout
+  // Regular programs bind one buffer or texture per binding
   //=================================================
-  VkPipelineLayoutCreateInfo layoutInfo = {};
-  layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  layoutInfo.setLayoutCount = 1;
-  layoutInfo.pSetLayouts = &_program.descriptorSetLayout;
-  layoutInfo.pushConstantRangeCount = 0;
-  layoutInfo.pPushConstantRanges = nullptr;
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  _program.bindings.clear();
+  for (const sklReflectedBinding_t& binding : bindings)
+  {
+    bool isBuffer = binding.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ||
+                    binding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    if ((!isBuffer && binding.type != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) ||
+        binding.count != 1)
+    {
+      SKL_LOG(SKL_ERROR, "%s binding \"%s\" must be a single buffer or sampled image",
+              _program.name, binding.name.c_str());
+      throw std::runtime_error("Shader uses an unsupported binding");
+    }
 
-  SKL_ASSERT_VK(
-    vkCreatePipelineLayout(vulkanContext.device, &layoutInfo, nullptr, &_program.pipelineLayout),
-    "Failed to create pipeline layout");
+    VkDescriptorSetLayoutBinding layoutBinding = {};
+    layoutBinding.binding = binding.binding;
+    layoutBinding.descriptorType = binding.type;
+    layoutBinding.descriptorCount = binding.count;
+    layoutBinding.stageFlags = binding.stages;
+    layoutBinding.pImmutableSamplers = nullptr;
+    layoutBindings.push_back(layoutBinding);
+
+    _program.bindings.push_back(isBuffer ? Skl_Binding_Buffer : Skl_Binding_Sampler);
+  }
+  _program.reflectedBindings = bindings;
+
+  SKL_PRINT("ShaderProgram", "%s has %u bindings and %u bytes of push constants", _program.name,
+            static_cast<uint32_t>(layoutBindings.size()), _program.pushConstantRange.size);
+
+  // Programs with the same bindings share layouts, keeping their pipelines layout-compatible
+  _program.descriptorSetLayout = SklDescriptorCache::GetSetLayout(layoutBindings);
+  _program.pipelineLayout = SklDescriptorCache::GetPipelineLayout(_program.descriptorSetLayout,
+                                                                  _program.pushConstantRange);
 }
 
 size_t PadBufferDataForShader(size_t _original)
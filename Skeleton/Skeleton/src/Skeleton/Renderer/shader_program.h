@@ -3,9 +3,14 @@
 #define SKELETON_RENDERER_SHADER_PROGRAM_H 1
 
 #include <vector>
+#include <future>
+#include <functional>
+#include <unordered_map>
 
 #include "vulkan/vulkan.h"
 
+#include "skeleton/renderer/shader_reflection.h"
+
 //=================================================
 // PARALLEL PROGRAMS / SHADERS
 //=================================================
@@ -32,9 +37,10 @@ typedef enum sklShaderBindingFlagBits
   Skl_Binding_Max_Count
 }sklShaderBindingFlagBits;
 
+// Fields packed into a pipeline's 64 bit settings word
+// A field left at 0 uses Vulkan's usual default, so settings only need the fields they change
 typedef enum sklPipelineSettingFlagBits
 {
-  // TODO : Implement options for all pipeline settings
   // Polygon cull mode
   Skl_Cull_Mode_None  = (0 << 0),
   Skl_Cull_Mode_Front = (1 << 0),
@@ -42,10 +48,137 @@ typedef enum sklPipelineSettingFlagBits
   Skl_Cull_Mode_Both  = (3 << 0),
   Skl_Cull_Mode_Bits  = (3 << 0),
 
+  // Winding of front-facing triangles
+  Skl_Front_Face_Counter_Clockwise = (0 << 2),
+  Skl_Front_Face_Clockwise         = (1 << 2),
+  Skl_Front_Face_Bits              = (1 << 2),
+
+  // Depth testing and writing are enabled unless disabled
+  Skl_Depth_Test_Disable  = (1 << 3),
+  Skl_Depth_Write_Disable = (1 << 4),
+
+  // Comparison a fragment's depth must pass
+  Skl_Depth_Compare_Less             = (0 << 5),
+  Skl_Depth_Compare_Less_Or_Equal    = (1 << 5),
+  Skl_Depth_Compare_Equal            = (2 << 5),
+  Skl_Depth_Compare_Greater          = (3 << 5),
+  Skl_Depth_Compare_Greater_Or_Equal = (4 << 5),
+  Skl_Depth_Compare_Not_Equal        = (5 << 5),
+  Skl_Depth_Compare_Always           = (6 << 5),
+  Skl_Depth_Compare_Never            = (7 << 5),
+  Skl_Depth_Compare_Bits             = (7 << 5),
+
+  // Fields set while recording when vulkanContext.extendedDynamicState is enabled
+  Skl_Pipeline_Dynamic_Bits = (0xff << 0),
+
+  // Polygon rasterization, lines and points fill instead if fillModeNonSolid is unsupported
+  Skl_Polygon_Mode_Fill  = (0 << 8),
+  Skl_Polygon_Mode_Line  = (1 << 8),
+  Skl_Polygon_Mode_Point = (2 << 8),
+  Skl_Polygon_Mode_Bits  = (3 << 8),
+
+  // Primitive topology
+  Skl_Topology_Triangle_List  = (0 << 10),
+  Skl_Topology_Triangle_Strip = (1 << 10),
+  Skl_Topology_Triangle_Fan   = (2 << 10),
+  Skl_Topology_Line_List      = (3 << 10),
+  Skl_Topology_Line_Strip     = (4 << 10),
+  Skl_Topology_Point_List     = (5 << 10),
+  Skl_Topology_Bits           = (7 << 10),
+
+  // Color blending
+  Skl_Blend_None          = (0 << 13),
+  Skl_Blend_Alpha         = (1 << 13),  // src * srcAlpha + dst * (1 - srcAlpha)
+  Skl_Blend_Additive      = (2 << 13),  // src * srcAlpha + dst
+  Skl_Blend_Premultiplied = (3 << 13),  // src + dst * (1 - srcAlpha)
+  Skl_Blend_Bits          = (3 << 13),
+
+  // Leaves the color attachment untouched, for depth-only passes
+  Skl_Color_Write_Disable = (1 << 15),
+
+  // Rasterization samples, a count differing from the render pass falls back to the pass's
+  Skl_Samples_Render_Pass = (0 << 16),  // Resolved to the current render pass's samples
+  Skl_Samples_1           = (1 << 16),
+  Skl_Samples_2           = (2 << 16),
+  Skl_Samples_4           = (3 << 16),
+  Skl_Samples_8           = (4 << 16),
+  Skl_Samples_16          = (5 << 16),
+  Skl_Samples_32          = (6 << 16),
+  Skl_Samples_64          = (7 << 16),
+  Skl_Samples_Bits        = (7 << 16),
+
   // Default values for each setting
-  Skl_Pipeline_Default_Settings = Skl_Cull_Mode_Front
+  Skl_Pipeline_Default_Settings = Skl_Cull_Mode_Front,
+
+  // Common combinations
+  // Writes depth only, ahead of the shaded pass
+  Skl_Pipeline_Depth_Prepass_Settings = Skl_Pipeline_Default_Settings | Skl_Color_Write_Disable,
+  // Shades only the fragments a depth prepass left visible
+  Skl_Pipeline_After_Prepass_Settings =
+      Skl_Pipeline_Default_Settings | Skl_Depth_Write_Disable | Skl_Depth_Compare_Equal,
+  // Blends over what is already drawn without hiding what is drawn after it
+  Skl_Pipeline_Transparent_Settings =
+      Skl_Cull_Mode_None | Skl_Depth_Write_Disable | Skl_Blend_Alpha,
+  // Outlines every triangle
+  Skl_Pipeline_Wireframe_Settings = Skl_Cull_Mode_None | Skl_Polygon_Mode_Line
 }sklPipelineSettingFlagBits;
 
+// Everything that determines a graphics pipeline, programs with equal states share a pipeline
+struct sklPipelineState_t
+{
+  // Shaders
+  VkShaderModule vertModule;
+  VkShaderModule fragModule;
+
+  // Vertex format
+  uint32_t vertexStride;
+  size_t vertexAttributes;  // Hash of every attribute's location, format, and offset
+
+  // Fixed-function state as sklPipelineSettingFlagBits
+  // Resolved against the device and render pass, so equal settings always mean equal state
+  uint64_t settings;
+
+  // Render pass compatibility
+  VkFormat colorFormat;
+  VkFormat depthFormat;
+
+  // Shader features, one bit per boolean specialization constant by its constant_id
+  uint64_t featureMask;  // Constants that are specialized, the rest keep their defaults
+  uint64_t features;     // Values of the specialized constants
+
+  bool operator==(const sklPipelineState_t& _other) const
+  {
+    return vertModule == _other.vertModule && fragModule == _other.fragModule &&
+           vertexStride == _other.vertexStride && vertexAttributes == _other.vertexAttributes &&
+           settings == _other.settings && colorFormat == _other.colorFormat &&
+           depthFormat == _other.depthFormat && featureMask == _other.featureMask &&
+           features == _other.features;
+  }
+};
+
+// Used to map pipeline states to their pipelines
+namespace std {
+  template<> struct hash<sklPipelineState_t> {
+    size_t operator()(const sklPipelineState_t& _state) const {
+      size_t seed = 0;
+      auto combine = [&seed](uint64_t _value)
+      {
+        seed ^= hash<uint64_t>()(_value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+      };
+      combine(reinterpret_cast<uint64_t>(_state.vertModule));
+      combine(reinterpret_cast<uint64_t>(_state.fragModule));
+      combine(_state.vertexStride);
+      combine(_state.vertexAttributes);
+      combine(_state.settings);
+      combine(_state.colorFormat);
+      combine(_state.depthFormat);
+      combine(_state.featureMask);
+      combine(_state.features);
+      return seed;
+    }
+  };
+}
+
 // Stores basic shader information for use in shaderProgram_t
 struct shader_t
 {
@@ -57,8 +190,17 @@ struct shader_t
   const char* name;
   sklShaderStageFlags stage;
   VkShaderModule module;
-  // buffer components
-  std::vector<sklShaderBindingFlags> bindings;
+  // Bindings, push constants, inputs, and specialization constants declared by the shader's SPIR-V
+  sklShaderReflection_t reflection;
+};
+
+// A pipeline compiled with a program's shader features set to something other than their defaults
+struct sklPipelineVariant_t
+{
+  VkPipeline pipeline;  // Owned by the SklPipelineBuilder
+  sklPipelineState_t state;
+  // Valid while the pipeline is compiling on the SklPipelineBuilder's workers
+  std::shared_future<VkPipeline> pendingPipeline;
 };
 
 // Program to run in parallel on the GPU
@@ -66,12 +208,17 @@ struct shaderProgram_t
 {
   shaderProgram_t(const char* _name) :
       name(_name), pipelineSettingsFlags(Skl_Pipeline_Default_Settings), vertIdx(-1), fragIdx(-1),
-      compIdx(-1), pipeline(VK_NULL_HANDLE), descriptorSet(VK_NULL_HANDLE),
-      descriptorSetLayout(VK_NULL_HANDLE), pipelineLayout(VK_NULL_HANDLE) {}
+      compIdx(-1), pipeline(VK_NULL_HANDLE), descriptorSetLayout(VK_NULL_HANDLE),
+      pipelineLayout(VK_NULL_HANDLE), pushConstantRange(), pipelineState(), featureMask(0),
+      defaultFeatures(0) {}
 
   // Retrieves or creates a graphicsPipeline
   // based on the given shaders and the shaderProgram's pipeline settings
+  // Waits for the pipeline to finish compiling if it is still in the SklPipelineBuilder
   VkPipeline GetPipeline(VkShaderModule _vertMod, VkShaderModule _fragMod);
+  // Retrieves or creates the pipeline for a set of shader features
+  // Features the program's shaders don't declare are ignored
+  VkPipeline GetPipeline(VkShaderModule _vertMod, VkShaderModule _fragMod, uint64_t _features);
 
   const char* name;
   uint64_t pipelineSettingsFlags;
@@ -80,21 +227,61 @@ struct shaderProgram_t
   uint32_t fragIdx;
   uint32_t compIdx;
 
+  // What each descriptor binds, or what each pushed index refers to when rendering bindless
   std::vector<sklShaderBindingFlags> bindings;
+  // The bindings of every stage merged and sorted by binding, empty when rendering bindless
+  std::vector<sklReflectedBinding_t> reflectedBindings;
+  // Owned by the SklDescriptorCache, shared with programs that have the same bindings
   VkDescriptorSetLayout descriptorSetLayout;
-  VkDescriptorSet descriptorSet;
   VkPipelineLayout pipelineLayout;
-  VkPipeline pipeline;
+  // Per-draw data shared by every stage that reads push constants, size is 0 if none do
+  VkPushConstantRange pushConstantRange;
+  VkPipeline pipeline;  // Owned by the SklPipelineBuilder, may be shared with other programs
+  sklPipelineState_t pipelineState;  // The state pipelineSettingsFlags resolved to
+  // Valid while the pipeline is compiling on the SklPipelineBuilder's workers
+  std::shared_future<VkPipeline> pendingPipeline;
+
+  // Boolean specialization constants declared by the shaders, one bit per constant_id
+  uint64_t featureMask;
+  // The features' declared values, the features pipeline is compiled with
+  uint64_t defaultFeatures;
+  // Pipelines for every other feature set used, keyed by the features they enable
+  std::unordered_map<uint64_t, sklPipelineVariant_t> variants;
 };
 
-// Creates a graphicsPipeline based on the given shaders and pipelineSettingsFlags
-VkPipeline CreatePipeline(VkShaderModule _vertModule, VkShaderModule _fragModule,
-                          VkPipelineLayout _pipeLayout, uint64_t _pipelineSettingsBits);
+// Resolves shaders and pipelineSettingsFlags into a complete pipeline state
+// Vertex format and render pass compatibility are taken from the current renderer
+// Features in _featureMask are specialized to their values in _features
+sklPipelineState_t GetPipelineState(VkShaderModule _vertModule, VkShaderModule _fragModule,
+                                    uint64_t _pipelineSettings, uint64_t _featureMask = 0,
+                                    uint64_t _features = 0);
+
+// Creates a graphicsPipeline from a complete pipeline state
+VkPipeline CreatePipeline(const sklPipelineState_t& _state, VkPipelineLayout _pipeLayout);
+
+// Records the parts of a pipeline state that are set dynamically
+// Only needed when vulkanContext.extendedDynamicState is enabled
+void SetDynamicPipelineState(VkCommandBuffer _command, const sklPipelineState_t& _state);
+
+// Records per-draw data into the program's push constant range
+// _data is laid out from offset 0, only the bytes the range covers are recorded
+// Nothing is recorded if the program has no range or _data ends before it
+void PushDrawConstants(VkCommandBuffer _command, const shaderProgram_t& _program,
+                       const void* _data, uint32_t _size);
 
 // Finds or creates a shaderProgram with the given information
+// New programs begin compiling their pipeline in the background immediately
 uint32_t GetShaderProgram(const char* _name, sklShaderStageFlags _stages,
                           uint64_t _pipelineSettings = Skl_Pipeline_Default_Settings);
 
+// Retrieves the bit of a shader feature declared as `layout(constant_id = N) const bool`
+// Returns 0 if none of the program's shaders declare it
+uint64_t GetShaderFeature(uint32_t _programIndex, const char* _name);
+
+// Begins compiling a program's pipeline for each feature set in the background
+// Variants that are not prewarmed are compiled when they are first drawn
+void PrewarmShaderVariants(uint32_t _programIndex, const std::vector<uint64_t>& _featureSets);
+
 // Creates a new shaderProgram and its shaders with the given information
 void CreateShaderProgram(const char* _name, sklShaderStageFlags _stages,
                          uint64_t _pipelineSettings = Skl_Pipeline_Default_Settings);
@@ -102,14 +289,13 @@ void CreateShaderProgram(const char* _name, sklShaderStageFlags _stages,
 // Retrieves the index of a shader from the VulkanContext
 uint32_t GetShader(const char* _name, sklShaderStageFlags _stage);
 
-// Loads a shader file from disk and extracts its bindings
+// Loads a shader file from disk and reflects its bindings
 void LoadShader(uint32_t _index);
 void LoadShader(shader_t& _shader);
 
-// Retrieves the shader's bindings and puts them into the shader_t
-void ExtractShaderBindings(const char* _layoutDirectory, shader_t& _shader);
-
-// Gathers bindings from the program's shaders and creates a descriptorSetLayout and pipelineLayout
+// Merges the bindings and push constants of the program's shaders and retrieves its
+//   descriptorSetLayout and pipelineLayout from the SklDescriptorCache
+// Throws if the shaders disagree, or don't match the vertex format or bindless set
 void CreateDescriptorSetLayout(shaderProgram_t& _program);
 
 // Pads a buffer to fit the GPU's memory alignment
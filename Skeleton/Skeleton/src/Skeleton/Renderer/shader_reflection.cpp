@@ -0,0 +1,576 @@
+
+#include "pch.h"
+#include "skeleton/renderer/shader_reflection.h"
+
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+#include "skeleton/core/debug_tools.h"
+
+namespace
+{
+  // SPIR-V values used by reflection, as numbered in the SPIR-V specification
+  enum : uint32_t
+  {
+    Spv_Magic = 0x07230203,
+    Spv_Header_Words = 5,
+
+    // Opcodes
+    Spv_Op_Name = 5,
+    Spv_Op_Member_Name = 6,
+    Spv_Op_Entry_Point = 15,
+    Spv_Op_Type_Bool = 20,
+    Spv_Op_Type_Int = 21,
+    Spv_Op_Type_Float = 22,
+    Spv_Op_Type_Vector = 23,
+    Spv_Op_Type_Matrix = 24,
+    Spv_Op_Type_Image = 25,
+    Spv_Op_Type_Sampler = 26,
+    Spv_Op_Type_Sampled_Image = 27,
+    Spv_Op_Type_Array = 28,
+    Spv_Op_Type_Runtime_Array = 29,
+    Spv_Op_Type_Struct = 30,
+    Spv_Op_Type_Pointer = 32,
+    Spv_Op_Constant = 43,
+    Spv_Op_Spec_Constant_True = 48,
+    Spv_Op_Spec_Constant_False = 49,
+    Spv_Op_Spec_Constant = 50,
+    Spv_Op_Variable = 59,
+    Spv_Op_Decorate = 71,
+    Spv_Op_Member_Decorate = 72,
+
+    // Decorations
+    Spv_Decoration_Spec_Id = 1,
+    Spv_Decoration_Buffer_Block = 3,
+    Spv_Decoration_Array_Stride = 6,
+    Spv_Decoration_Matrix_Stride = 7,
+    Spv_Decoration_Built_In = 11,
+    Spv_Decoration_Location = 30,
+    Spv_Decoration_Binding = 33,
+    Spv_Decoration_Descriptor_Set = 34,
+    Spv_Decoration_Offset = 35,
+
+    // Storage classes
+    Spv_Storage_Uniform_Constant = 0,
+    Spv_Storage_Input = 1,
+    Spv_Storage_Uniform = 2,
+    Spv_Storage_Push_Constant = 9,
+    Spv_Storage_Storage_Buffer = 12,
+
+    // Execution models
+    Spv_Model_Vertex = 0,
+    Spv_Model_Fragment = 4,
+    Spv_Model_GL_Compute = 5,
+
+    // Image dimensions
+    Spv_Dim_Buffer = 5,
+    Spv_Dim_Subpass_Data = 6,
+
+    Spv_None = ~0u
+  };
+
+  // Everything reflection needs to know about a single SPIR-V id
+  struct sklSpvId_t
+  {
+    uint32_t opcode = 0;
+    const uint32_t* words = nullptr;  // The instruction that defines the id
+    uint32_t wordCount = 0;
+
+    std::string name;
+    uint32_t set = 0;
+    uint32_t binding = Spv_None;
+    uint32_t location = Spv_None;
+    uint32_t specId = Spv_None;
+    uint32_t arrayStride = 0;
+    bool bufferBlock = false;
+    bool builtIn = false;
+
+    std::vector<std::string> memberNames;
+    std::vector<uint32_t> memberOffsets;
+    std::vector<uint32_t> memberMatrixStrides;
+    bool builtInMember = false;
+  };
+
+  // Reads a nul-terminated literal string packed into words
+  std::string ReadString(const uint32_t* _words, uint32_t _wordCount)
+  {
+    const char* characters = reinterpret_cast<const char*>(_words);
+    size_t length = 0;
+    while (length < _wordCount * 4 && characters[length] != '\0')
+      length++;
+    return std::string(characters, length);
+  }
+
+  // Grows a member list so _member can be indexed
+  template<typename T>
+  T& MemberAt(std::vector<T>& _members, uint32_t _member)
+  {
+    if (_members.size() <= _member)
+      _members.resize(_member + 1);
+    return _members[_member];
+  }
+
+  class SpvModule
+  {
+  public:
+    std::vector<sklSpvId_t> ids;
+
+    const sklSpvId_t* Get(uint32_t _id) const
+    {
+      return (_id < ids.size() && ids[_id].opcode != 0) ? &ids[_id] : nullptr;
+    }
+
+    // Bytes a value of the given type occupies in a buffer
+    uint32_t TypeSize(uint32_t _type, uint32_t _matrixStride = 0) const
+    {
+      const sklSpvId_t* type = Get(_type);
+      if (type == nullptr)
+        return 0;
+
+      switch (type->opcode)
+      {
+      case Spv_Op_Type_Bool:
+        return 4;
+      case Spv_Op_Type_Int:
+      case Spv_Op_Type_Float:
+        return type->words[2] / 8;
+      case Spv_Op_Type_Vector:
+        return type->words[3] * TypeSize(type->words[2]);
+      case Spv_Op_Type_Matrix:
+        return type->words[3] * (_matrixStride ? _matrixStride : TypeSize(type->words[2]));
+      case Spv_Op_Type_Array:
+      {
+        uint32_t stride = type->arrayStride ? type->arrayStride : TypeSize(type->words[2]);
+        return ArrayLength(type->words[3]) * stride;
+      }
+      case Spv_Op_Type_Struct:
+      {
+        uint32_t size = 0;
+        for (uint32_t i = 2; i < type->wordCount; i++)
+        {
+          uint32_t member = i - 2;
+          uint32_t offset = member < type->memberOffsets.size() ? type->memberOffsets[member] : 0;
+          uint32_t stride =
+              member < type->memberMatrixStrides.size() ? type->memberMatrixStrides[member] : 0;
+          size = std::max(size, offset + TypeSize(type->words[i], stride));
+        }
+        return size;
+      }
+      default:
+        // Runtime arrays and opaque types take no space of their own
+        return 0;
+      }
+    }
+
+    // Value of the constant holding an array's length
+    uint32_t ArrayLength(uint32_t _constant) const
+    {
+      const sklSpvId_t* constant = Get(_constant);
+      return (constant != nullptr && constant->opcode == Spv_Op_Constant) ? constant->words[3] : 1;
+    }
+
+    // Lists the members of a block along with their offsets and sizes
+    std::vector<sklReflectedMember_t> Members(const sklSpvId_t& _struct) const
+    {
+      std::vector<sklReflectedMember_t> members;
+      for (uint32_t i = 2; i < _struct.wordCount; i++)
+      {
+        uint32_t index = i - 2;
+        sklReflectedMember_t member = {};
+        member.name = index < _struct.memberNames.size() ? _struct.memberNames[index] : "";
+        member.offset = index < _struct.memberOffsets.size() ? _struct.memberOffsets[index] : 0;
+        uint32_t stride =
+            index < _struct.memberMatrixStrides.size() ? _struct.memberMatrixStrides[index] : 0;
+        member.size = TypeSize(_struct.words[i], stride);
+        members.push_back(member);
+      }
+      return members;
+    }
+
+    // Format of a vertex attribute holding the given type
+    VkFormat InputFormat(uint32_t _type) const
+    {
+      const sklSpvId_t* type = Get(_type);
+      if (type == nullptr)
+        return VK_FORMAT_UNDEFINED;
+
+      uint32_t componentCount = 1;
+      if (type->opcode == Spv_Op_Type_Vector)
+      {
+        componentCount = type->words[3];
+        type = Get(type->words[2]);
+        if (type == nullptr)
+          return VK_FORMAT_UNDEFINED;
+      }
+
+      // Only 32 bit components are used by the renderer's vertex formats
+      if ((type->opcode != Spv_Op_Type_Float && type->opcode != Spv_Op_Type_Int) ||
+          type->words[2] != 32 || componentCount < 1 || componentCount > 4)
+      {
+        return VK_FORMAT_UNDEFINED;
+      }
+
+      static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT,
+          VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+      static const VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT,
+          VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+      static const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT,
+          VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+      if (type->opcode == Spv_Op_Type_Float)
+        return floatFormats[componentCount - 1];
+      return type->words[3] ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+    }
+  };
+
+  struct sklShaderReflectionState_t
+  {
+    std::mutex lock;
+    // Keyed by the binary itself, shaders are small and this keeps lookups exact
+    std::unordered_map<std::string, sklShaderReflection_t> reflections;
+  };
+
+  sklShaderReflectionState_t& GetState()
+  {
+    static sklShaderReflectionState_t state;
+    return state;
+  }
+}
+
+const sklShaderReflection_t& SklShaderReflection::Reflect(const std::vector<char>& _code)
+{
+  sklShaderReflectionState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+
+  std::string key(_code.data(), _code.size());
+  auto cached = state.reflections.find(key);
+  if (cached != state.reflections.end())
+  {
+    return cached->second;
+  }
+
+  sklShaderReflection_t& reflection = state.reflections[key];
+  // The binary is copied into words, a char vector's data is not guaranteed to be aligned
+  std::vector<uint32_t> words(_code.size() / 4);
+  if (!words.empty())
+  {
+    std::memcpy(words.data(), _code.data(), words.size() * 4);
+  }
+  Parse(words.data(), words.size(), reflection);
+  return reflection;
+}
+
+void SklShaderReflection::ClearCache()
+{
+  sklShaderReflectionState_t& state = GetState();
+  std::lock_guard<std::mutex> guard(state.lock);
+  state.reflections.clear();
+}
+
+bool SklShaderReflection::Parse(const uint32_t* _code, size_t _wordCount,
+                                sklShaderReflection_t& _reflection)
+{
+  _reflection = {};
+  if (_wordCount < Spv_Header_Words || _code[0] != Spv_Magic)
+  {
+    SKL_LOG(SKL_ERROR, "Shader is not a SPIR-V binary");
+    return false;
+  }
+
+  SpvModule module;
+  module.ids.resize(_code[3]);  // The header's id bound
+  std::vector<uint32_t> variables;
+  std::vector<uint32_t> specConstants;
+
+  // Ids are validated against the bound before being indexed
+  auto at = [&module](uint32_t _id) -> sklSpvId_t*
+  {
+    return _id < module.ids.size() ? &module.ids[_id] : nullptr;
+  };
+
+  // Gather ids, names, and decorations
+  //=================================================
+  size_t position = Spv_Header_Words;
+  while (position < _wordCount)
+  {
+    const uint32_t* words = _code + position;
+    uint32_t opcode = words[0] & 0xffff;
+    uint32_t wordCount = words[0] >> 16;
+    if (wordCount == 0 || position + wordCount > _wordCount)
+    {
+      SKL_LOG(SKL_ERROR, "Shader has a malformed instruction at word %zu", position);
+      return false;
+    }
+    position += wordCount;
+
+    switch (opcode)
+    {
+    case Spv_Op_Entry_Point:
+    {
+      // Only the first entry point is reflected
+      if (!_reflection.entryPoint.empty() || wordCount < 4)
+        break;
+
+      switch (words[1])
+      {
+      case Spv_Model_Vertex:    _reflection.stage = VK_SHADER_STAGE_VERTEX_BIT;   break;
+      case Spv_Model_Fragment:  _reflection.stage = VK_SHADER_STAGE_FRAGMENT_BIT; break;
+      case Spv_Model_GL_Compute: _reflection.stage = VK_SHADER_STAGE_COMPUTE_BIT; break;
+      default:
+        SKL_LOG(SKL_ERROR, "Shader uses unsupported execution model %u", words[1]);
+        return false;
+      }
+      _reflection.entryPoint = ReadString(words + 3, wordCount - 3);
+    } break;
+    case Spv_Op_Name:
+    {
+      if (wordCount >= 3 && at(words[1]))
+        at(words[1])->name = ReadString(words + 2, wordCount - 2);
+    } break;
+    case Spv_Op_Member_Name:
+    {
+      if (wordCount >= 4 && at(words[1]))
+        MemberAt(at(words[1])->memberNames, words[2]) = ReadString(words + 3, wordCount - 3);
+    } break;
+    case Spv_Op_Decorate:
+    {
+      sklSpvId_t* target = wordCount >= 3 ? at(words[1]) : nullptr;
+      if (target == nullptr)
+        break;
+
+      uint32_t value = wordCount >= 4 ? words[3] : 0;
+      switch (words[2])
+      {
+      case Spv_Decoration_Spec_Id:        target->specId = value; break;
+      case Spv_Decoration_Buffer_Block:   target->bufferBlock = true; break;
+      case Spv_Decoration_Array_Stride:   target->arrayStride = value; break;
+      case Spv_Decoration_Built_In:       target->builtIn = true; break;
+      case Spv_Decoration_Location:       target->location = value; break;
+      case Spv_Decoration_Binding:        target->binding = value; break;
+      case Spv_Decoration_Descriptor_Set: target->set = value; break;
+      }
+    } break;
+    case Spv_Op_Member_Decorate:
+    {
+      sklSpvId_t* target = wordCount >= 4 ? at(words[1]) : nullptr;
+      if (target == nullptr)
+        break;
+
+      uint32_t value = wordCount >= 5 ? words[4] : 0;
+      switch (words[3])
+      {
+      case Spv_Decoration_Offset:
+        MemberAt(target->memberOffsets, words[2]) = value; break;
+      case Spv_Decoration_Matrix_Stride:
+        MemberAt(target->memberMatrixStrides, words[2]) = value; break;
+      case Spv_Decoration_Built_In:
+        target->builtInMember = true; break;
+      }
+    } break;
+    case Spv_Op_Type_Bool:
+    case Spv_Op_Type_Int:
+    case Spv_Op_Type_Float:
+    case Spv_Op_Type_Vector:
+    case Spv_Op_Type_Matrix:
+    case Spv_Op_Type_Image:
+    case Spv_Op_Type_Sampler:
+    case Spv_Op_Type_Sampled_Image:
+    case Spv_Op_Type_Array:
+    case Spv_Op_Type_Runtime_Array:
+    case Spv_Op_Type_Struct:
+    case Spv_Op_Type_Pointer:
+    {
+      if (wordCount >= 2 && at(words[1]))
+      {
+        at(words[1])->opcode = opcode;
+        at(words[1])->words = words;
+        at(words[1])->wordCount = wordCount;
+      }
+    } break;
+    case Spv_Op_Constant:
+    case Spv_Op_Variable:
+    case Spv_Op_Spec_Constant:
+    {
+      if (wordCount >= 4 && at(words[2]))
+      {
+        at(words[2])->opcode = opcode;
+        at(words[2])->words = words;
+        at(words[2])->wordCount = wordCount;
+        if (opcode == Spv_Op_Variable)
+          variables.push_back(words[2]);
+        else if (opcode == Spv_Op_Spec_Constant)
+          specConstants.push_back(words[2]);
+      }
+    } break;
+    case Spv_Op_Spec_Constant_True:
+    case Spv_Op_Spec_Constant_False:
+    {
+      if (wordCount >= 3 && at(words[2]))
+      {
+        at(words[2])->opcode = opcode;
+        at(words[2])->words = words;
+        at(words[2])->wordCount = wordCount;
+        specConstants.push_back(words[2]);
+      }
+    } break;
+    }
+  }
+
+  if (_reflection.entryPoint.empty())
+  {
+    SKL_LOG(SKL_ERROR, "Shader has no entry point");
+    return false;
+  }
+
+  // Interpret each variable by its storage class
+  //=================================================
+  for (uint32_t id : variables)
+  {
+    const sklSpvId_t& variable = module.ids[id];
+    uint32_t storage = variable.words[3];
+    const sklSpvId_t* pointer = module.Get(variable.words[1]);
+    if (pointer == nullptr || pointer->opcode != Spv_Op_Type_Pointer)
+      continue;
+
+    const sklSpvId_t* type = module.Get(pointer->words[3]);
+    if (type == nullptr)
+      continue;
+
+    switch (storage)
+    {
+    case Spv_Storage_Uniform_Constant:
+    case Spv_Storage_Uniform:
+    case Spv_Storage_Storage_Buffer:
+    {
+      sklReflectedBinding_t binding = {};
+      binding.name = variable.name;
+      binding.set = variable.set;
+      binding.binding = variable.binding;
+      binding.stages = _reflection.stage;
+      binding.count = 1;
+
+      // Arrays of descriptors are unwrapped to their element type
+      while (type != nullptr && (type->opcode == Spv_Op_Type_Array ||
+                                 type->opcode == Spv_Op_Type_Runtime_Array))
+      {
+        binding.count = (type->opcode == Spv_Op_Type_Array) ?
+            binding.count * module.ArrayLength(type->words[3]) : 0;
+        type = module.Get(type->words[2]);
+      }
+      if (type == nullptr || variable.binding == Spv_None)
+        continue;
+
+      switch (type->opcode)
+      {
+      case Spv_Op_Type_Sampled_Image:
+        binding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; break;
+      case Spv_Op_Type_Sampler:
+        binding.type = VK_DESCRIPTOR_TYPE_SAMPLER; break;
+      case Spv_Op_Type_Image:
+      {
+        uint32_t dim = type->words[3];
+        bool storageImage = type->words[7] == 2;
+        if (dim == Spv_Dim_Subpass_Data)
+          binding.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        else if (dim == Spv_Dim_Buffer)
+          binding.type = storageImage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER :
+                                        VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        else
+          binding.type = storageImage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE :
+                                        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+      } break;
+      case Spv_Op_Type_Struct:
+      {
+        // Older compilers mark storage buffers as uniform buffer blocks
+        bool storageBuffer = storage == Spv_Storage_Storage_Buffer || type->bufferBlock;
+        binding.type = storageBuffer ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER :
+                                       VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        binding.blockSize = module.TypeSize(pointer->words[3]);
+        binding.members = module.Members(*type);
+        if (binding.name.empty())
+          binding.name = type->name;
+      } break;
+      default:
+        continue;
+      }
+
+      _reflection.bindings.push_back(binding);
+    } break;
+    case Spv_Storage_Push_Constant:
+    {
+      if (type->opcode != Spv_Op_Type_Struct)
+        continue;
+
+      _reflection.pushConstantMembers = module.Members(*type);
+      uint32_t begin = ~0u;
+      uint32_t end = 0;
+      for (const sklReflectedMember_t& member : _reflection.pushConstantMembers)
+      {
+        begin = std::min(begin, member.offset);
+        end = std::max(end, member.offset + member.size);
+      }
+      if (end > 0)
+      {
+        _reflection.pushConstants.stageFlags = _reflection.stage;
+        _reflection.pushConstants.offset = begin;
+        _reflection.pushConstants.size = end - begin;
+      }
+    } break;
+    case Spv_Storage_Input:
+    {
+      if (_reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || variable.builtIn ||
+          type->builtInMember || variable.location == Spv_None)
+      {
+        continue;
+      }
+
+      sklReflectedInput_t input = {};
+      input.name = variable.name;
+      input.location = variable.location;
+      input.format = module.InputFormat(pointer->words[3]);
+      _reflection.inputs.push_back(input);
+    } break;
+    }
+  }
+
+  // Only constants given a constant_id can be specialized, the rest are derived from them
+  //=================================================
+  for (uint32_t id : specConstants)
+  {
+    const sklSpvId_t& constant = module.ids[id];
+    if (constant.specId == Spv_None)
+      continue;
+
+    sklReflectedSpecConstant_t specConstant = {};
+    specConstant.name = constant.name;
+    specConstant.id = constant.specId;
+    specConstant.isBool = constant.opcode != Spv_Op_Spec_Constant;
+    specConstant.size = specConstant.isBool ? 4 : module.TypeSize(constant.words[1]);
+    if (constant.opcode == Spv_Op_Spec_Constant_True)
+      specConstant.defaultValue = 1;
+    else if (constant.opcode == Spv_Op_Spec_Constant)
+      specConstant.defaultValue = constant.words[3];
+    _reflection.specConstants.push_back(specConstant);
+  }
+
+  std::sort(_reflection.bindings.begin(), _reflection.bindings.end(),
+            [](const sklReflectedBinding_t& _a, const sklReflectedBinding_t& _b)
+  {
+    return (_a.set != _b.set) ? _a.set < _b.set : _a.binding < _b.binding;
+  });
+  std::sort(_reflection.inputs.begin(), _reflection.inputs.end(),
+            [](const sklReflectedInput_t& _a, const sklReflectedInput_t& _b)
+  {
+    return _a.location < _b.location;
+  });
+  std::sort(_reflection.specConstants.begin(), _reflection.specConstants.end(),
+            [](const sklReflectedSpecConstant_t& _a, const sklReflectedSpecConstant_t& _b)
+  {
+    return _a.id < _b.id;
+  });
+
+  _reflection.valid = true;
+  return true;
+}
@@ -0,0 +1,83 @@
+
+#ifndef SKELETON_RENDERER_SHADER_REFLECTION_H
+#define SKELETON_RENDERER_SHADER_REFLECTION_H 1
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+// A member of a buffer block or push constant block
+struct sklReflectedMember_t
+{
+  std::string name;
+  uint32_t offset;
+  uint32_t size;
+};
+
+// A descriptor declared by a shader
+struct sklReflectedBinding_t
+{
+  std::string name;
+  uint32_t set;
+  uint32_t binding;
+  VkDescriptorType type;
+  uint32_t count;               // Array size, 0 for runtime-sized arrays
+  VkShaderStageFlags stages;    // Stages that declare this binding
+  uint32_t blockSize;           // Bytes in a buffer's block, 0 for images and samplers
+  std::vector<sklReflectedMember_t> members;  // Members of a buffer's block
+};
+
+// An input of a vertex shader
+struct sklReflectedInput_t
+{
+  std::string name;
+  uint32_t location;
+  VkFormat format;  // VK_FORMAT_UNDEFINED for types a single attribute can't hold
+};
+
+// A specialization constant, its value is chosen when a pipeline is created
+struct sklReflectedSpecConstant_t
+{
+  std::string name;
+  uint32_t id;            // The constant_id it is declared with
+  uint32_t size;          // Bytes its value occupies, booleans are a VkBool32
+  bool isBool;            // Booleans are usable as shader feature toggles
+  uint32_t defaultValue;  // The value it has if not specialized, the low word for 64 bit types
+};
+
+// Everything a shader declares that its pipeline layout and vertex format have to match
+struct sklShaderReflection_t
+{
+  bool valid = false;
+  VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+  std::string entryPoint;
+  std::vector<sklReflectedBinding_t> bindings;  // Sorted by set, then binding
+  VkPushConstantRange pushConstants = {};       // Size is 0 if the shader has none
+  std::vector<sklReflectedMember_t> pushConstantMembers;
+  std::vector<sklReflectedInput_t> inputs;      // Vertex shaders only, sorted by location
+  std::vector<sklReflectedSpecConstant_t> specConstants;  // Sorted by id
+};
+
+// Reads descriptor, push constant, vertex input, and specialization constant declarations
+//   directly from SPIR-V
+// Only the decorations and types the renderer needs are interpreted, everything else is skipped
+class SklShaderReflection
+{
+  //=================================================
+  // Functions
+  //=================================================
+public:
+  // Reflects a SPIR-V binary, results are cached by the binary's contents
+  // The result's valid flag is false if the binary could not be parsed
+  static const sklShaderReflection_t& Reflect(const std::vector<char>& _code);
+  // Reflects a SPIR-V binary without caching, returns false if it could not be parsed
+  static bool Parse(const uint32_t* _code, size_t _wordCount,
+                    sklShaderReflection_t& _reflection);
+  // Forgets every cached reflection
+  static void ClearCache();
+
+}; // class SklShaderReflection
+
+#endif // !SKELETON_RENDERER_SHADER_REFLECTION_H
@@ -2,12 +2,16 @@
 #ifndef SKELETON_RENDERER_VULKAN_CONTEXT_H
 #define SKELETON_RENDERER_VULKAN_CONTEXT_H 1
 
+#include <string>
+#include <unordered_map>
+
 #include "vulkan/vulkan.h"
 
 #include "skeleton/renderer/shader_program.h"
 #include "skeleton/core/mesh.h"
 #include "skeleton/core/debug_tools.h"
 #include "skeleton/renderer/image.h"
+#include "skeleton/renderer/descriptor_cache.h"
 
 // A buffer and its device memory
 struct sklBuffer_t
@@ -16,6 +20,14 @@ struct sklBuffer_t
   VkDeviceMemory memory;
 };
 
+// Per-draw data pushed as constants to programs whose shaders declare a push range
+// Matches the push_constant block of the default shaders
+struct sklDrawConstants_t
+{
+  glm::mat4 model;
+  uint32_t materialIndex;
+};
+
 // A bound object with all information needed for rendering
 struct sklRenderable_t
 {
@@ -23,6 +35,20 @@ struct sklRenderable_t
   uint32_t shaderProgramIndex;
   std::vector<sklBuffer_t*> buffers;
   std::vector<sklImage_t*> images;
+  // Binds this renderable's buffers and images to its shaderProgram
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  // What descriptorSet binds, used to build sets that replace some of it for a frame
+  std::vector<sklDescriptorResource_t> descriptorResources;
+  // Bound in place of descriptorSet for the current frame only, see Renderer::SetFrameTextures()
+  VkDescriptorSet frameDescriptorSet = VK_NULL_HANDLE;
+  // Indices of this renderable's buffers and images in the bindless set, in binding order
+  // Pushed as constants in place of binding descriptorSet when rendering bindless
+  std::vector<uint32_t> bindlessIndices;
+  // Pushed with each draw, updating it needs no buffer writes
+  sklDrawConstants_t drawConstants = { glm::mat4(1.f), 0 };
+  // Shader features the renderable's pipeline variant enables, see GetShaderFeature()
+  // Starts as its shaderProgram's defaults
+  uint64_t shaderFeatures = 0;
 
   // TODO : CreateBuffer()/CreateImage()
 };
@@ -58,9 +84,29 @@ struct SklVulkanContext_t
 
   std::vector<shader_t> shaders;
   std::vector<shaderProgram_t> shaderPrograms;
+  // Indices into shaders and shaderPrograms keyed by name, stages, and settings
+  std::unordered_map<std::string, uint32_t> shaderLookup;
+  std::unordered_map<std::string, uint32_t> shaderProgramLookup;
 
   VkExtent2D renderExtent;
   VkRenderPass renderPass;
+  // Attachment formats of renderPass, pipelines work with any pass that shares them
+  VkFormat renderPassColorFormat;
+  VkFormat renderPassDepthFormat;
+  VkSampleCountFlagBits renderPassSamples;
+
+  // Cull and depth state are set while recording rather than baked into pipelines
+  // Requires VK_EXT_extended_dynamic_state, the commands below are loaded when it is enabled
+  bool extendedDynamicState;
+  PFN_vkCmdSetCullModeEXT vkCmdSetCullModeEXT;
+  PFN_vkCmdSetFrontFaceEXT vkCmdSetFrontFaceEXT;
+  PFN_vkCmdSetDepthTestEnableEXT vkCmdSetDepthTestEnableEXT;
+  PFN_vkCmdSetDepthWriteEnableEXT vkCmdSetDepthWriteEnableEXT;
+  PFN_vkCmdSetDepthCompareOpEXT vkCmdSetDepthCompareOpEXT;
+
+  // Textures and per-object data are indexed from one global set instead of bound per draw
+  // Requires VK_EXT_descriptor_indexing, programs must use shaders written for it
+  bool bindless;
 
   std::vector<sklRenderable_t> renderables;
 